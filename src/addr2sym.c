@@ -0,0 +1,170 @@
+#include "include/addr2sym.h"
+#include "include/symidx.h"
+
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct queries // Struct of arrays, one entry per input line
+{
+    uint64_t *addr;
+    uint32_t *line; // Input line of addr once sorted
+    uint32_t *sym; // Result per input line, SYM_NONE or A2S_BAD
+    size_t n;
+    size_t cap;
+};
+
+static char *read_all(FILE *in, size_t *size)
+{
+    size_t cap = A2S_READ_CHUNK;
+    size_t len = 0;
+    char *buf = malloc(cap);
+
+    while (buf)
+    {
+        len += fread(buf + len, 1, cap - len, in);
+        if (len < cap)
+            break;
+        char *tmp = realloc(buf, 2 * cap);
+        if (!tmp)
+        {
+            free(buf);
+            return NULL;
+        }
+        buf = tmp;
+        cap *= 2;
+    }
+    if (buf && ferror(in))
+    {
+        perror("Cannot read the addresses");
+        free(buf);
+        return NULL;
+    }
+    *size = len;
+    return buf;
+}
+
+static int push_query(struct queries *q, uint64_t addr, int bad)
+{
+    if (q->n == q->cap)
+    {
+        size_t cap = q->cap ? 2 * q->cap : 4096;
+        uint64_t *addr_arr = realloc(q->addr, cap * sizeof(*addr_arr));
+        if (addr_arr)
+            q->addr = addr_arr;
+        uint32_t *line = realloc(q->line, cap * sizeof(*line));
+        if (line)
+            q->line = line;
+        uint32_t *sym = realloc(q->sym, cap * sizeof(*sym));
+        if (sym)
+            q->sym = sym;
+        if (!addr_arr || !line || !sym || cap > UINT32_MAX)
+            return -1;
+        q->cap = cap;
+    }
+    q->addr[q->n] = addr;
+    q->line[q->n] = (uint32_t)q->n;
+    q->sym[q->n] = bad ? A2S_BAD : SYM_NONE;
+    q->n++;
+    return 0;
+}
+
+static int parse_queries(struct queries *q, const char *s, const char *end)
+{
+    while (s < end)
+    {
+        const char *eol = memchr(s, '\n', (size_t)(end - s));
+        if (!eol)
+            eol = end;
+        while (s < eol && (*s == ' ' || *s == '\t'))
+            s++;
+
+        uint64_t addr = 0;
+        int bad = parse_hex_u64(&s, eol, &addr)
+            || (s < eol && *s != ' ' && *s != '\t' && *s != '\r');
+        if (push_query(q, addr, bad))
+            return -1;
+        s = eol + 1;
+    }
+    return 0;
+}
+
+// Sorted queries against the sorted index: a single forward merge
+static void resolve(struct queries *q, const struct sym_index *idx)
+{
+    size_t k = 0; // Functions starting at or before the current address
+
+    for (size_t i = 0; i < q->n; i++)
+    {
+        uint64_t addr = q->addr[i];
+        uint32_t line = q->line[i];
+
+        if (q->sym[line] == A2S_BAD)
+            continue;
+        while (k < idx->n && idx->start[k] <= addr)
+            k++;
+        if (k && addr < idx->end[k - 1])
+            q->sym[line] = idx->id[k - 1];
+    }
+}
+
+static void free_queries(struct queries *q)
+{
+    free(q->addr);
+    free(q->line);
+    free(q->sym);
+}
+
+int addr2sym(FILE *out, FILE *in, const struct elf_bin *bin)
+{
+    const struct sym_list *lst = &bin->syms;
+    struct queries q = { 0 };
+    struct sym_index idx;
+    size_t size = 0;
+    char *text = read_all(in, &size);
+    int ret = -1;
+
+    if (!text || parse_queries(&q, text, text + size)
+        || symidx_build(&idx, lst))
+    {
+        fprintf(stderr, "[-] Out of memory reading the addresses\n");
+        free(text);
+        free_queries(&q);
+        return -1;
+    }
+
+    // Keep the input order aside, sort (address, line) pairs
+    uint64_t *in_order = malloc((q.n + 1) * sizeof(*in_order));
+    uint64_t *ktmp = malloc((q.n + 1) * sizeof(*ktmp));
+    uint32_t *vtmp = malloc((q.n + 1) * sizeof(*vtmp));
+    if (in_order && ktmp && vtmp)
+    {
+        memcpy(in_order, q.addr, q.n * sizeof(*in_order));
+        radix_sort_kv(q.addr, q.line, ktmp, vtmp, q.n);
+        resolve(&q, &idx);
+
+        for (size_t i = 0; i < q.n; i++)
+        {
+            uint32_t id = q.sym[i];
+            if (id == A2S_BAD)
+                fputs("??\n", out);
+            else if (id == SYM_NONE)
+                fprintf(out, "0x%" PRIx64 " ??\n", in_order[i]);
+            else
+                fprintf(out, "0x%" PRIx64 " %s+0x%" PRIx64 "\n", in_order[i],
+                        lst->items[id].name,
+                        in_order[i] - (uint64_t)lst->items[id].addr);
+        }
+        ret = 0;
+    }
+    else
+        fprintf(stderr, "[-] Out of memory sorting the addresses\n");
+
+    free(in_order);
+    free(ktmp);
+    free(vtmp);
+    symidx_free(&idx);
+    free_queries(&q);
+    free(text);
+    return ret;
+}
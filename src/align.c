@@ -0,0 +1,176 @@
+#include "include/align.h"
+#include "include/disas.h"
+
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Largest power of two dividing addr, capped to ALIGN_MAX
+static unsigned addr_align(uint64_t addr)
+{
+    unsigned a = 1;
+    while (a < ALIGN_MAX && !(addr & a))
+        a <<= 1;
+    return a;
+}
+
+// First half of a macro-fusible pair on Skylake: cmp, test, add, sub,
+// and, inc, dec (memory + immediate forms never fuse)
+static bool fusible(const struct asm_ins *ins)
+{
+    uint8_t op = ins->op;
+
+    if (ins->map != 1 || (ins->imm_size && ins_mem_operand(ins)))
+        return false;
+    if (op <= 0x05 || (op >= 0x20 && op <= 0x25) || (op >= 0x28 && op <= 0x2D)
+        || (op >= 0x38 && op <= 0x3D) || op == 0x84 || op == 0x85
+        || op == 0xA8 || op == 0xA9)
+        return true;
+    if (!ins->has_modrm)
+        return false;
+    if (op >= 0x80 && op <= 0x83) // Group 1: add /0, and /4, sub /5, cmp /7
+        return ins->reg == 0 || ins->reg == 4 || ins->reg == 5
+            || ins->reg == 7;
+    if (op == 0xF6 || op == 0xF7) // Group 3: test /0
+        return ins->reg == 0;
+    if (op == 0xFE || op == 0xFF) // Group 4/5: inc /0, dec /1
+        return ins->reg == 0 || ins->reg == 1;
+    return false;
+}
+
+// Crosses a 32-byte boundary or its last byte ends one
+static const char *jcc_hit(uint64_t start, uint64_t end)
+{
+    if (start / JCC_BOUNDARY != (end - 1) / JCC_BOUNDARY)
+        return "crosses";
+    if (end % JCC_BOUNDARY == 0)
+        return "ends on";
+    return NULL;
+}
+
+static int push_head(struct align_report *r, size_t n, uint64_t addr)
+{
+    if (n == r->cap)
+    {
+        size_t cap = r->cap ? 2 * r->cap : 64;
+        uint64_t *heads = realloc(r->heads, cap * sizeof(*heads));
+        if (!heads)
+            return -1;
+        r->heads = heads;
+        uint64_t *tmp = realloc(r->tmp, cap * sizeof(*tmp));
+        if (!tmp)
+            return -1;
+        r->tmp = tmp;
+        r->cap = cap;
+    }
+    r->heads[n] = addr;
+    return 0;
+}
+
+static void func_header(FILE *out, const struct sym_info *s, int *printed)
+{
+    if (!*printed)
+        fprintf(out, "%s <0x%" PRIx64 ">:\n", s->name, (uint64_t)s->addr);
+    *printed = 1;
+}
+
+void align_init(struct align_report *r)
+{
+    memset(r, 0, sizeof(*r));
+}
+
+int align_func(FILE *out, struct align_report *r, const struct sym_info *s)
+{
+    const uint8_t *p = s->bytes;
+    uint64_t start = s->addr;
+    uint64_t end = start + s->size;
+    uint64_t rip = start;
+    uint64_t prev = 0; // Address of the previous fusible instruction
+    int has_prev = 0;
+    size_t n_heads = 0;
+    int printed = 0;
+    char buf[INS_BUFSIZE];
+    struct asm_ins ins;
+
+    r->n_funcs++;
+    unsigned a = addr_align(start);
+    r->n_entries[a >= 64 ? 2 : a >= 32 ? 1 : a >= 16 ? 0 : 3]++;
+    if (a < ALIGN_WANT)
+    {
+        func_header(out, s, &printed);
+        fprintf(out, "  0x%08" PRIx64 "  entry      align %u\n", start, a);
+    }
+
+    while (rip < end)
+    {
+        size_t len = decode64(p + (rip - start), (size_t)(end - rip), &ins);
+        if (!len)
+            break;
+
+        enum ins_flow flow = ins_flow(&ins);
+        if (flow != FLOW_NONE && flow != FLOW_STOP)
+        {
+            int fused = flow == FLOW_JCC && has_prev;
+            uint64_t from = fused ? prev : rip;
+            const char *hit = jcc_hit(from, rip + len);
+
+            r->n_branches++;
+            if (hit)
+            {
+                r->jcc_hits++;
+                r->fused_hits += fused;
+                format_ins(buf, sizeof(buf), &ins);
+                func_header(out, s, &printed);
+                fprintf(out, "  0x%08" PRIx64 "  %-10s %2" PRIu64
+                        " bytes %s 32B boundary: %s\n",
+                        from, fused ? "fused jcc" : "branch",
+                        rip + len - from, hit, buf);
+            }
+
+            uint64_t target = ins_target(&ins, rip, len);
+            if ((flow == FLOW_JCC || flow == FLOW_JMP) && target <= rip
+                && target >= start && push_head(r, n_heads++, target))
+                return -1;
+        }
+
+        has_prev = fusible(&ins);
+        prev = rip;
+        rip += len;
+    }
+
+    // Loop heads: targets of backward branches, once each
+    radix_sort_u64(r->heads, r->tmp, n_heads);
+    for (size_t i = 0; i < n_heads; i++)
+    {
+        if (i && r->heads[i] == r->heads[i - 1])
+            continue;
+        r->n_heads++;
+        a = addr_align(r->heads[i]);
+        if (a >= ALIGN_WANT)
+            continue;
+        r->heads_low++;
+        func_header(out, s, &printed);
+        fprintf(out, "  0x%08" PRIx64 "  loop head  align %u\n", r->heads[i],
+                a);
+    }
+    return 0;
+}
+
+void align_summary(FILE *out, const struct align_report *r)
+{
+    fprintf(out,
+            "\n%zu functions: %zu entries 64B aligned, %zu 32B, %zu 16B, "
+            "%zu below 16B\n"
+            "%zu loop heads, %zu below 16B\n"
+            "%zu branches, %zu JCC erratum hits (%zu macro-fused)\n",
+            r->n_funcs, r->n_entries[2], r->n_entries[1], r->n_entries[0],
+            r->n_entries[3], r->n_heads, r->heads_low, r->n_branches,
+            r->jcc_hits, r->fused_hits);
+}
+
+void align_free(struct align_report *r)
+{
+    free(r->heads);
+    free(r->tmp);
+    memset(r, 0, sizeof(*r));
+}
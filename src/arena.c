@@ -0,0 +1,68 @@
+#include "include/arena.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+void arena_init(struct arena *a, size_t chunk_size)
+{
+    a->head = NULL;
+    a->chunk_size = chunk_size ? chunk_size : ARENA_CHUNK_SIZE;
+}
+
+void *arena_alloc(struct arena *a, size_t size)
+{
+    size = (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+
+    struct arena_chunk *c = a->head;
+    if (!c || c->size - c->used < size)
+    {
+        // Oversized requests get a chunk of their own
+        size_t cap = size > a->chunk_size ? size : a->chunk_size;
+        if (!(c = malloc(sizeof(*c) + cap)))
+            return NULL;
+        c->size = cap;
+        c->used = 0;
+        c->next = a->head;
+        a->head = c;
+    }
+
+    void *p = c->data + c->used;
+    c->used += size;
+    return p;
+}
+
+void *arena_calloc(struct arena *a, size_t n, size_t size)
+{
+    if (size && n > SIZE_MAX / size)
+        return NULL;
+
+    void *p = arena_alloc(a, n * size);
+    if (p)
+        memset(p, 0, n * size);
+    return p;
+}
+
+void arena_reset(struct arena *a)
+{
+    if (!a->head)
+        return;
+
+    struct arena_chunk *keep = a->head;
+    struct arena_chunk *c = keep->next;
+    while (c)
+    {
+        struct arena_chunk *next = c->next;
+        free(c);
+        c = next;
+    }
+    keep->next = NULL;
+    keep->used = 0;
+}
+
+void arena_free(struct arena *a)
+{
+    arena_reset(a);
+    free(a->head);
+    a->head = NULL;
+}
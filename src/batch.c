@@ -0,0 +1,522 @@
+#define _DEFAULT_SOURCE // open_memstream, rand_r, sysconf
+
+#include "include/batch.h"
+#include "include/disas.h"
+#include "include/parse_elf.h"
+#include "include/plt.h"
+#include "include/dataidx.h"
+#include "include/reloc.h"
+
+#include <errno.h>
+#include <elf.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+struct batch_file
+{
+    const char *path; // Owned by batch_run's path list
+    struct elf_bin *bin;
+    struct reloc_index rel; // ET_REL: .text relocations, read only once built
+    struct plt_map plt; // Otherwise imports, same
+    struct data_index data; // And symbols / sections by address, same
+    size_t n_chunks;
+    size_t chunks_left; // Under lock
+    char **out; // Per chunk output
+    size_t *out_len;
+    pthread_mutex_t lock;
+};
+
+struct task
+{
+    struct batch_file *file;
+    size_t first; // Function range of a chunk task
+    size_t count;
+    size_t chunk; // SIZE_MAX: load and split the file
+};
+
+struct deque // Owner pushes / pops the tail, thieves take the head
+{
+    struct task *items;
+    size_t head;
+    size_t tail;
+    size_t cap;
+    pthread_mutex_t lock;
+};
+
+struct pool
+{
+    struct deque *dq;
+    size_t n;
+    size_t pending; // Queued or running tasks, under lock
+    size_t epoch; // Bumped on every push, under lock: no lost wakeups
+    size_t failed;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    pthread_mutex_t out_lock; // Combined stream
+    const struct batch_opts *opts;
+};
+
+struct worker
+{
+    struct pool *pool;
+    size_t id;
+    unsigned seed; // Victim selection
+};
+
+static int dq_push(struct deque *d, struct task t)
+{
+    pthread_mutex_lock(&d->lock);
+    if (d->tail == d->cap)
+    {
+        // Compact, then grow
+        memmove(d->items, d->items + d->head,
+                (d->tail - d->head) * sizeof(*d->items));
+        d->tail -= d->head;
+        d->head = 0;
+        if (d->tail == d->cap)
+        {
+            size_t cap = d->cap ? 2 * d->cap : 64;
+            struct task *items = realloc(d->items, cap * sizeof(*items));
+            if (!items)
+            {
+                pthread_mutex_unlock(&d->lock);
+                return -1;
+            }
+            d->items = items;
+            d->cap = cap;
+        }
+    }
+    d->items[d->tail++] = t;
+    pthread_mutex_unlock(&d->lock);
+    return 0;
+}
+
+static int dq_take(struct deque *d, struct task *t, int steal)
+{
+    int ok = 0;
+    pthread_mutex_lock(&d->lock);
+    if (d->head < d->tail)
+    {
+        *t = steal ? d->items[d->head++] : d->items[--d->tail];
+        ok = 1;
+    }
+    pthread_mutex_unlock(&d->lock);
+    return ok;
+}
+
+static int submit(struct pool *p, size_t dq, struct task t)
+{
+    pthread_mutex_lock(&p->lock);
+    p->pending++;
+    pthread_mutex_unlock(&p->lock);
+    int err = dq_push(&p->dq[dq], t);
+
+    pthread_mutex_lock(&p->lock);
+    if (err)
+        p->pending--;
+    else
+    {
+        p->epoch++;
+        pthread_cond_signal(&p->cond);
+    }
+    pthread_mutex_unlock(&p->lock);
+    return err;
+}
+
+static void task_done(struct pool *p, int failed)
+{
+    pthread_mutex_lock(&p->lock);
+    p->failed += failed;
+    if (--p->pending == 0)
+        pthread_cond_broadcast(&p->cond);
+    pthread_mutex_unlock(&p->lock);
+}
+
+// Own tail first, then the head of the other deques from a random one
+static int find_task(struct worker *w, struct task *t)
+{
+    struct pool *p = w->pool;
+    if (dq_take(&p->dq[w->id], t, 0))
+        return 1;
+    size_t start = (size_t)rand_r(&w->seed) % p->n;
+    for (size_t k = 0; k < p->n; k++)
+    {
+        size_t v = (start + k) % p->n;
+        if (v != w->id && dq_take(&p->dq[v], t, 1))
+            return 1;
+    }
+    return 0;
+}
+
+static void file_free(struct batch_file *f)
+{
+    for (size_t i = 0; i < f->n_chunks; i++)
+        free(f->out[i]);
+    free(f->out);
+    free(f->out_len);
+    reloc_index_free(&f->rel);
+    plt_map_free(&f->plt);
+    dataidx_free(&f->data);
+    elf_free(&f->bin);
+    pthread_mutex_destroy(&f->lock);
+    free(f);
+}
+
+static FILE *open_output(const struct pool *p, const char *path)
+{
+    if (!p->opts->out_dir)
+        return stdout;
+
+    // /usr/lib/x.so -> OUT_DIR/usr_lib_x.so.txt
+    size_t len = strlen(p->opts->out_dir) + strlen(path) + 8;
+    char *name = malloc(len);
+    if (!name)
+        return NULL;
+    size_t n = (size_t)snprintf(name, len, "%s/", p->opts->out_dir);
+    for (const char *s = path; *s; s++)
+        if (*s != '/' || n > strlen(p->opts->out_dir) + 1)
+            name[n++] = *s == '/' ? '_' : *s;
+    strcpy(name + n, ".txt");
+
+    FILE *f = fopen(name, "w");
+    if (!f)
+        perror(name);
+    free(name);
+    return f;
+}
+
+// Last chunk of a file: emit every chunk in order, then release the file
+static int file_finish(struct pool *p, struct batch_file *f)
+{
+    if (!p->opts->out_dir)
+        pthread_mutex_lock(&p->out_lock);
+    FILE *out = open_output(p, f->path);
+    if (out)
+    {
+        fprintf(out, "=== %s (%zu functions)\n", f->path, f->bin->syms.count);
+        for (size_t i = 0; i < f->n_chunks; i++)
+            fwrite(f->out[i], 1, f->out_len[i], out);
+        if (out != stdout)
+            fclose(out);
+    }
+    if (!p->opts->out_dir)
+        pthread_mutex_unlock(&p->out_lock);
+    file_free(f);
+    return out ? 0 : -1;
+}
+
+static int run_chunk(struct pool *p, struct batch_file *f, size_t chunk,
+                     size_t first, size_t count)
+{
+    const struct sym_list *lst = &f->bin->syms;
+    FILE *mem = open_memstream(&f->out[chunk], &f->out_len[chunk]);
+    char buf[INS_BUFSIZE];
+    char label[INS_BUFSIZE];
+    struct disas_iter it;
+    struct asm_ins ins;
+
+    // A chunk always counts as done, or its file would never be written
+    for (size_t i = first; mem && i < first + count; i++)
+    {
+        const struct sym_info *s = &lst->items[i];
+        fprintf(mem, "\n%016" PRIx64 " <%s>:\n", (uint64_t)s->addr, s->name);
+        struct reloc_cursor rc = reloc_seek(&f->rel, s->addr);
+        disas_iter_init(&it, s->bytes, s->size, s->addr);
+        while (disas_next(&it, &ins) > 0)
+        {
+            format_ins(buf, sizeof(buf), &ins);
+            uint64_t target = ins_target(&ins, it.ins_rip, it.ins_len);
+            if (target
+                && (plt_label(label, sizeof(label), target, &f->plt)
+                    || dataidx_label(&f->data, target, label, sizeof(label))))
+                fprintf(mem, "%8" PRIx64 ":\t%s %s\n", it.ins_rip, buf,
+                        label);
+            else
+                fprintf(mem, "%8" PRIx64 ":\t%s\n", it.ins_rip, buf);
+            if (f->rel.n)
+                reloc_note(mem, it.ins_rip, it.ins_len, &rc);
+        }
+    }
+    if (mem)
+        fclose(mem);
+
+    pthread_mutex_lock(&f->lock);
+    size_t left = --f->chunks_left;
+    pthread_mutex_unlock(&f->lock);
+    int err = mem ? 0 : -1;
+    if (!left && file_finish(p, f))
+        err = -1;
+    return err;
+}
+
+// Load a file and split its functions into chunk tasks on our own deque
+static int run_file(struct worker *w, struct batch_file *f)
+{
+    const struct sym_list *lst;
+
+    enum io_backend io = w->pool->opts->io;
+    if (!(f->bin = elf_load_io(f->path, io == IO_URING ? IO_MMAP : io)))
+    {
+        fprintf(stderr, "[-] %s: %s\n", f->path, elf_strerror(errno));
+        goto error;
+    }
+    if (f->bin->ehdr->e_type == ET_REL
+        && reloc_index_build(&f->rel, f->bin, f->bin->text_index))
+        goto error;
+    if (f->bin->ehdr->e_type != ET_REL
+        && (plt_map_build(&f->plt, f->bin) || dataidx_build(&f->data, f->bin)))
+        goto error;
+    lst = &f->bin->syms;
+
+    size_t bytes = 0;
+    f->n_chunks = 1;
+    for (size_t i = 0; i < lst->count; i++)
+    {
+        if (bytes >= BATCH_CHUNK_BYTES)
+        {
+            f->n_chunks++;
+            bytes = 0;
+        }
+        bytes += lst->items[i].size;
+    }
+    f->out = calloc(f->n_chunks, sizeof(*f->out));
+    f->out_len = calloc(f->n_chunks, sizeof(*f->out_len));
+    if (!f->out || !f->out_len)
+        goto error;
+    f->chunks_left = f->n_chunks;
+
+    size_t chunk = 0;
+    size_t first = 0;
+    bytes = 0;
+    for (size_t i = 0; i <= lst->count; i++)
+    {
+        if (i < lst->count && bytes < BATCH_CHUNK_BYTES)
+        {
+            bytes += lst->items[i].size;
+            continue;
+        }
+        struct task t = { f, first, i - first, chunk++ };
+        // The last chunk runs right away, so does one that cannot queue
+        if (chunk == f->n_chunks)
+            return run_chunk(w->pool, f, t.chunk, t.first, t.count);
+        if (submit(w->pool, w->id, t)
+            && run_chunk(w->pool, f, t.chunk, t.first, t.count))
+            fprintf(stderr, "[-] %s: lost the output of a chunk\n",
+                    f->path);
+        first = i;
+        bytes = i < lst->count ? lst->items[i].size : 0;
+    }
+    return 0;
+
+error:
+    fprintf(stderr, "[-] %s: skipped\n", f->path);
+    file_free(f);
+    return -1;
+}
+
+static void *worker_main(void *arg)
+{
+    struct worker *w = arg;
+    struct pool *p = w->pool;
+    struct task t;
+
+    for (;;)
+    {
+        pthread_mutex_lock(&p->lock);
+        size_t seen = p->epoch;
+        pthread_mutex_unlock(&p->lock);
+
+        if (find_task(w, &t))
+        {
+            int err = t.chunk == SIZE_MAX
+                ? run_file(w, t.file)
+                : run_chunk(p, t.file, t.chunk, t.first, t.count);
+            task_done(p, err != 0);
+            continue;
+        }
+
+        // Sleep unless something was pushed since the search started
+        pthread_mutex_lock(&p->lock);
+        if (p->pending == 0)
+        {
+            pthread_mutex_unlock(&p->lock);
+            return NULL;
+        }
+        if (p->epoch == seen)
+            pthread_cond_wait(&p->cond, &p->lock);
+        pthread_mutex_unlock(&p->lock);
+    }
+}
+
+static int is_elf64_file(const char *path)
+{
+    unsigned char ident[EI_NIDENT];
+    int fd = open(path, O_RDONLY);
+    if (fd == -1)
+        return 0;
+    ssize_t n = read(fd, ident, sizeof(ident));
+    close(fd);
+    return n == (ssize_t)sizeof(ident) && memcmp(ident, ELFMAG, SELFMAG) == 0
+        && ident[EI_CLASS] == ELFCLASS64;
+}
+
+struct path_list
+{
+    char **items;
+    size_t n;
+    size_t cap;
+};
+
+static int add_path(struct path_list *l, const char *path)
+{
+    if (l->n == l->cap)
+    {
+        size_t cap = l->cap ? 2 * l->cap : 64;
+        char **items = realloc(l->items, cap * sizeof(*items));
+        if (!items)
+            return -1;
+        l->items = items;
+        l->cap = cap;
+    }
+    if (!(l->items[l->n] = xstrdup(path)))
+        return -1;
+    l->n++;
+    return 0;
+}
+
+static void free_paths(struct path_list *l)
+{
+    for (size_t i = 0; i < l->n; i++)
+        free(l->items[i]);
+    free(l->items);
+}
+
+struct prefetch
+{
+    char **paths;
+    size_t n;
+};
+
+static void *prefetch_main(void *arg)
+{
+    struct prefetch *pf = arg;
+    io_prefetch(pf->paths, pf->n);
+    return NULL;
+}
+
+static int collect(const char *path, void *data)
+{
+    return is_elf64_file(path) ? add_path(data, path) : 0;
+}
+
+int batch_run(const struct batch_opts *opts, char **paths, size_t n_paths)
+{
+    struct path_list files = { NULL, 0, 0 };
+    for (size_t i = 0; i < n_paths; i++)
+        if (walk_files(paths[i], collect, &files))
+        {
+            fprintf(stderr, "[-] Out of memory listing inputs\n");
+            free_paths(&files);
+            return -1;
+        }
+
+    if (opts->out_dir && mkdir(opts->out_dir, 0755) == -1 && errno != EEXIST)
+    {
+        perror(opts->out_dir);
+        free_paths(&files);
+        return -1;
+    }
+
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t n = opts->n_threads ? opts->n_threads : cpus > 0 ? (size_t)cpus : 1;
+    if (n > BATCH_MAX_THREADS)
+        n = BATCH_MAX_THREADS;
+
+    struct pool p = { 0 };
+    struct worker *w = calloc(n, sizeof(*w));
+    pthread_t *tids = calloc(n, sizeof(*tids));
+    p.dq = calloc(n, sizeof(*p.dq));
+    p.n = n;
+    p.opts = opts;
+    pthread_mutex_init(&p.lock, NULL);
+    pthread_cond_init(&p.cond, NULL);
+    pthread_mutex_init(&p.out_lock, NULL);
+    if (!w || !tids || !p.dq)
+    {
+        fprintf(stderr, "[-] Out of memory starting the pool\n");
+        free_paths(&files);
+        free(w);
+        free(tids);
+        free(p.dq);
+        return -1;
+    }
+    for (size_t i = 0; i < n; i++)
+        pthread_mutex_init(&p.dq[i].lock, NULL);
+
+    // File tasks dealt round robin, chunk tasks are spawned by their loader
+    size_t lost = 0;
+    for (size_t i = 0; i < files.n; i++)
+    {
+        struct batch_file *f = calloc(1, sizeof(*f));
+        if (!f)
+        {
+            lost++;
+            continue;
+        }
+        f->path = files.items[i];
+        pthread_mutex_init(&f->lock, NULL);
+        struct task t = { f, 0, 0, SIZE_MAX };
+        if (submit(&p, i % n, t))
+        {
+            lost++;
+            file_free(f);
+        }
+    }
+
+    // Owners pop their deque tail: files run roughly last to first
+    struct prefetch pf = { NULL, files.n };
+    pthread_t pf_tid;
+    int pf_run = opts->io == IO_URING
+        && (pf.paths = malloc(files.n * sizeof(*pf.paths)));
+    for (size_t i = 0; pf_run && i < files.n; i++)
+        pf.paths[i] = files.items[files.n - 1 - i];
+    if (pf_run && pthread_create(&pf_tid, NULL, prefetch_main, &pf))
+        pf_run = 0;
+
+    for (size_t i = 0; i < n; i++)
+    {
+        w[i] = (struct worker){ &p, i, (unsigned)i * 2654435761u + 1 };
+        if (pthread_create(&tids[i], NULL, worker_main, &w[i]))
+        {
+            perror("pthread_create");
+            n = i; // Joined below, the rest is drained by them
+            break;
+        }
+    }
+    if (!n)
+        worker_main(&(struct worker){ &p, 0, 1 });
+    for (size_t i = 0; i < n; i++)
+        pthread_join(tids[i], NULL);
+    if (pf_run)
+        pthread_join(pf_tid, NULL);
+    free(pf.paths);
+
+    for (size_t i = 0; i < p.n; i++)
+    {
+        free(p.dq[i].items);
+        pthread_mutex_destroy(&p.dq[i].lock);
+    }
+    pthread_mutex_destroy(&p.lock);
+    pthread_cond_destroy(&p.cond);
+    pthread_mutex_destroy(&p.out_lock);
+    free(p.dq);
+    free(w);
+    free(tids);
+    free_paths(&files);
+    fprintf(stderr, "[+] %zu files, %zu failed\n", files.n, p.failed + lost);
+    return (int)(p.failed + lost);
+}
@@ -0,0 +1,329 @@
+#include "include/callgraph.h"
+#include "include/disas.h"
+#include "include/symidx.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+struct got_slot // Statically known content of a pointer sized slot
+{
+    uint64_t addr;
+    uint64_t value;
+};
+
+struct edge_buf // Packed (caller << 32 | callee) pairs, one allocation
+{
+    uint64_t *e;
+    size_t n;
+    size_t cap;
+};
+
+static int cmp_slot(const void *a, const void *b)
+{
+    const struct got_slot *x = a;
+    const struct got_slot *y = b;
+    return (x->addr > y->addr) - (x->addr < y->addr);
+}
+
+/*
+ * GOT slots are filled at load time: take their value from RELA entries
+ * (R_X86_64_RELATIVE addend, or a defined symbol for GLOB_DAT/JUMP_SLOT/64)
+ */
+static struct got_slot *collect_slots(const struct elf_bin *bin, size_t *n)
+{
+    const char *buf = bin->f->content;
+    const Elf64_Shdr *sh = bin->shdrs;
+    size_t count = 0;
+
+    *n = 0;
+    for (Elf64_Half i = 0; i < bin->ehdr->e_shnum; i++)
+        if (sh[i].sh_type == SHT_RELA && sh[i].sh_entsize)
+            count += sh[i].sh_size / sh[i].sh_entsize;
+
+    struct got_slot *slots = malloc((count + 1) * sizeof(*slots));
+    if (!slots)
+        return NULL;
+
+    for (Elf64_Half i = 0; i < bin->ehdr->e_shnum; i++)
+    {
+        if (sh[i].sh_type != SHT_RELA || !sh[i].sh_entsize
+            || sh[i].sh_offset + sh[i].sh_size > bin->f->size
+            || file_need(bin->f, sh[i].sh_offset, sh[i].sh_size))
+            continue;
+
+        const Elf64_Rela *rel = (const Elf64_Rela *)(buf + sh[i].sh_offset);
+        size_t n_rel = sh[i].sh_size / sh[i].sh_entsize;
+        const Elf64_Shdr *link =
+            sh[i].sh_link < bin->ehdr->e_shnum ? &sh[sh[i].sh_link] : NULL;
+        if (link && file_need(bin->f, link->sh_offset, link->sh_size))
+            link = NULL;
+        const Elf64_Sym *syms =
+            link ? (const Elf64_Sym *)(buf + link->sh_offset) : NULL;
+        size_t n_syms = link ? link->sh_size / sizeof(Elf64_Sym) : 0;
+
+        for (size_t r = 0; r < n_rel; r++)
+        {
+            uint32_t type = ELF64_R_TYPE(rel[r].r_info);
+            uint32_t sym = ELF64_R_SYM(rel[r].r_info);
+            uint64_t value = 0;
+
+            if (type == R_X86_64_RELATIVE)
+                value = (uint64_t)rel[r].r_addend;
+            else if ((type == R_X86_64_GLOB_DAT || type == R_X86_64_JUMP_SLOT
+                      || type == R_X86_64_64)
+                     && sym && sym < n_syms && syms[sym].st_value)
+                value = syms[sym].st_value + (uint64_t)rel[r].r_addend;
+            else
+                continue;
+
+            slots[*n].addr = rel[r].r_offset;
+            slots[*n].value = value;
+            (*n)++;
+        }
+    }
+
+    qsort(slots, *n, sizeof(*slots), cmp_slot);
+    return slots;
+}
+
+static uint64_t slot_value(const struct got_slot *slots, size_t n,
+                           uint64_t addr)
+{
+    size_t lo = 0;
+    size_t hi = n;
+    while (lo < hi)
+    {
+        size_t mid = lo + (hi - lo) / 2;
+        if (slots[mid].addr < addr)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    return lo < n && slots[lo].addr == addr ? slots[lo].value : 0;
+}
+
+static int push_edge(struct edge_buf *eb, uint32_t src, uint32_t dst)
+{
+    if (eb->n == eb->cap)
+    {
+        size_t cap = eb->cap ? eb->cap * 2 : 1024;
+        uint64_t *tmp = realloc(eb->e, cap * sizeof(*tmp));
+        if (!tmp)
+            return -1;
+        eb->e = tmp;
+        eb->cap = cap;
+    }
+
+    eb->e[eb->n++] = (uint64_t)src << 32 | dst;
+    return 0;
+}
+
+// Decode every function once and record its resolvable call sites
+static int collect_calls(struct callgraph *cg, const struct elf_bin *bin,
+                         const struct sym_index *idx, struct edge_buf *eb)
+{
+    size_t n_slots = 0;
+    struct got_slot *slots = collect_slots(bin, &n_slots);
+    if (!slots)
+        return -1;
+
+    for (size_t f = 0; f < bin->syms.count; f++)
+    {
+        const struct sym_info *s = &bin->syms.items[f];
+        const uint8_t *p = s->bytes;
+        const uint8_t *end = p + s->size;
+        uint64_t rip = s->addr;
+        struct asm_ins ins;
+
+        while (p < end)
+        {
+            size_t n = decode64(p, (size_t)(end - p), &ins);
+            if (!n)
+                break;
+
+            enum ins_flow flow = ins_flow(&ins);
+            uint64_t target = 0;
+            if (flow == FLOW_CALL)
+                target = ins_target(&ins, rip, n);
+            else if (flow == FLOW_ICALL && ins_rip_relative(&ins))
+                target = slot_value(slots, n_slots, ins_target(&ins, rip, n));
+
+            if (flow == FLOW_CALL || flow == FLOW_ICALL)
+            {
+                uint32_t callee =
+                    target ? symidx_lookup(idx, target) : SYM_NONE;
+                if (callee == SYM_NONE)
+                    cg->n_unresolved++;
+                else if (push_edge(eb, (uint32_t)f, callee))
+                {
+                    free(slots);
+                    return -1;
+                }
+            }
+
+            p += n;
+            rip += n;
+        }
+    }
+
+    free(slots);
+    return 0;
+}
+
+int cg_build(struct callgraph *cg, const struct elf_bin *bin)
+{
+    struct sym_index idx;
+    struct edge_buf eb = { 0 };
+    size_t n = bin->syms.count;
+
+    memset(cg, 0, sizeof(*cg));
+    cg->n_nodes = n;
+    if (symidx_build(&idx, &bin->syms))
+        return -1;
+
+    int err = collect_calls(cg, bin, &idx, &eb);
+    symidx_free(&idx);
+    cg->n_sites = eb.n;
+
+    uint64_t *tmp = err ? NULL : malloc((eb.n + 1) * sizeof(*tmp));
+    cg->off = calloc(n + 1, sizeof(*cg->off));
+    cg->roff = calloc(n + 2, sizeof(*cg->roff));
+    if (err || !tmp || !cg->off || !cg->roff)
+        goto error;
+
+    // Sorted by caller then callee: duplicates are adjacent
+    radix_sort_u64(eb.e, tmp, eb.n);
+    size_t n_edges = 0;
+    for (size_t i = 0; i < eb.n; i++)
+        if (!i || eb.e[i] != eb.e[i - 1])
+            n_edges++;
+
+    cg->dst = malloc((n_edges + 1) * sizeof(*cg->dst));
+    cg->cnt = malloc((n_edges + 1) * sizeof(*cg->cnt));
+    cg->src = malloc((n_edges + 1) * sizeof(*cg->src));
+    if (!cg->dst || !cg->cnt || !cg->src)
+        goto error;
+
+    size_t e = 0;
+    for (size_t i = 0; i < eb.n; i++)
+    {
+        if (i && eb.e[i] == eb.e[i - 1])
+        {
+            cg->cnt[e - 1]++;
+            continue;
+        }
+        cg->dst[e] = (uint32_t)eb.e[i];
+        cg->cnt[e] = 1;
+        cg->off[(eb.e[i] >> 32) + 1]++;
+        cg->roff[(uint32_t)eb.e[i] + 2]++;
+        e++;
+    }
+    cg->n_edges = n_edges;
+    for (size_t i = 0; i < n; i++)
+    {
+        cg->off[i + 1] += cg->off[i];
+        cg->roff[i + 2] += cg->roff[i + 1];
+    }
+
+    // Reverse graph by counting sort on the callee, rows stay caller sorted
+    for (size_t caller = 0; caller < n; caller++)
+        for (uint32_t k = cg->off[caller]; k < cg->off[caller + 1]; k++)
+            cg->src[cg->roff[cg->dst[k] + 1]++] = (uint32_t)caller;
+
+    free(tmp);
+    free(eb.e);
+    return 0;
+
+error:
+    free(tmp);
+    free(eb.e);
+    cg_free(cg);
+    return -1;
+}
+
+void cg_free(struct callgraph *cg)
+{
+    free(cg->off);
+    free(cg->dst);
+    free(cg->cnt);
+    free(cg->roff);
+    free(cg->src);
+    memset(cg, 0, sizeof(*cg));
+}
+
+void cg_print_dot(FILE *out, const struct callgraph *cg,
+                  const struct sym_list *lst)
+{
+    fputs("digraph callgraph {\n", out);
+    for (size_t i = 0; i < cg->n_nodes; i++)
+        for (uint32_t k = cg->off[i]; k < cg->off[i + 1]; k++)
+        {
+            fprintf(out, "\t\"%s\" -> \"%s\"", lst->items[i].name,
+                    lst->items[cg->dst[k]].name);
+            if (cg->cnt[k] > 1)
+                fprintf(out, " [label=%u]", cg->cnt[k]);
+            fputs(";\n", out);
+        }
+    fputs("}\n", out);
+}
+
+int cg_write(const char *path, const struct callgraph *cg,
+             const struct sym_list *lst)
+{
+    uint32_t *names = malloc((cg->n_nodes + 1) * sizeof(*names));
+    if (!names)
+        return -1;
+
+    struct cg_hdr hdr = { .version = CG_VERSION,
+                          .n_nodes = cg->n_nodes,
+                          .n_edges = cg->n_edges };
+    memcpy(hdr.magic, CG_MAGIC, sizeof(hdr.magic));
+    for (size_t i = 0; i < cg->n_nodes; i++)
+    {
+        names[i] = (uint32_t)hdr.str_size;
+        hdr.str_size += strlen(lst->items[i].name) + 1;
+    }
+
+    FILE *fp = fopen(path, "wb");
+    if (!fp)
+    {
+        perror("Cannot open call graph file for writing");
+        free(names);
+        return -1;
+    }
+
+    int ok = fwrite(&hdr, sizeof(hdr), 1, fp) == 1
+        && fwrite(cg->off, sizeof(*cg->off), cg->n_nodes + 1, fp)
+            == cg->n_nodes + 1
+        && fwrite(cg->dst, sizeof(*cg->dst), cg->n_edges, fp) == cg->n_edges
+        && fwrite(cg->cnt, sizeof(*cg->cnt), cg->n_edges, fp) == cg->n_edges
+        && fwrite(names, sizeof(*names), cg->n_nodes, fp) == cg->n_nodes;
+    for (size_t i = 0; ok && i < cg->n_nodes; i++)
+        ok = fputs(lst->items[i].name, fp) >= 0 && putc('\0', fp) != EOF;
+
+    free(names);
+    if (fclose(fp) || !ok)
+    {
+        perror("Cannot write call graph file");
+        return -1;
+    }
+    return 0;
+}
+
+void cg_print_callees(FILE *out, const struct callgraph *cg,
+                      const struct sym_list *lst, uint32_t id)
+{
+    fprintf(out, "Callees of %s:\n", lst->items[id].name);
+    for (uint32_t k = cg->off[id]; k < cg->off[id + 1]; k++)
+        fprintf(out, "\t%s (%u call sites)\n", lst->items[cg->dst[k]].name,
+                cg->cnt[k]);
+}
+
+void cg_print_callers(FILE *out, const struct callgraph *cg,
+                      const struct sym_list *lst, uint32_t id)
+{
+    fprintf(out, "Callers of %s:\n", lst->items[id].name);
+    for (uint32_t k = cg->roff[id]; k < cg->roff[id + 1]; k++)
+        fprintf(out, "\t%s\n", lst->items[cg->src[k]].name);
+}
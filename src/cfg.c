@@ -0,0 +1,230 @@
+#include "include/cfg.h"
+#include "include/disas.h"
+
+#include <inttypes.h>
+#include <string.h>
+
+// Per byte marks of the function body
+#define MARK_INS 1 // An instruction starts here
+#define MARK_LEADER 2 // A basic block starts here (if MARK_INS)
+
+static const char *edge_names[] = { "fallthrough", "taken" };
+
+// Linear sweep, marks instruction starts and block leaders
+static void decode_all(struct cfg *cfg, uint8_t *mark)
+{
+    const uint8_t *p = cfg->bytes;
+    const uint8_t *end = p + cfg->size;
+    struct asm_ins ins;
+
+    mark[0] |= MARK_LEADER;
+    while (p < end)
+    {
+        size_t n = decode64(p, (size_t)(end - p), &ins);
+        if (!n)
+        {
+            cfg->truncated = true;
+            break;
+        }
+
+        uint32_t off = (uint32_t)(p - cfg->bytes);
+        struct cfg_ins *ci = &cfg->ins[cfg->n_ins++];
+        enum ins_flow flow = ins_flow(&ins);
+        ci->off = off;
+        ci->len = (uint8_t)n;
+        ci->flow = (uint8_t)flow;
+        ci->target = CFG_NONE;
+        mark[off] |= MARK_INS;
+
+        if (flow == FLOW_JCC || flow == FLOW_JMP)
+        {
+            uint64_t t = ins_target(&ins, cfg->addr + off, n) - cfg->addr;
+            if (t < cfg->size)
+            {
+                ci->target = (uint32_t)t;
+                mark[t] |= MARK_LEADER;
+            }
+        }
+        if (flow != FLOW_NONE && flow != FLOW_CALL && flow != FLOW_ICALL)
+            mark[off + n] |= MARK_LEADER;
+        p += n;
+    }
+}
+
+static int add_edge(struct cfg *cfg, uint32_t from, uint32_t to, uint8_t kind)
+{
+    if (to == CFG_NONE)
+        return 0;
+
+    cfg->edges[cfg->n_edges++] = (struct cfg_edge){ from, to, kind };
+    return 1;
+}
+
+static void link_blocks(struct cfg *cfg)
+{
+    for (uint32_t b = 0; b < cfg->n_blocks; b++)
+    {
+        struct cfg_block *blk = &cfg->blocks[b];
+        const struct cfg_ins *last = &cfg->ins[blk->first_ins + blk->n_ins - 1];
+        uint32_t next = b + 1 < cfg->n_blocks ? b + 1 : CFG_NONE;
+        uint32_t taken = last->target == CFG_NONE
+            ? CFG_NONE
+            : cfg_block_at(cfg, cfg->addr + last->target);
+
+        blk->first_succ = cfg->n_edges;
+        switch (last->flow)
+        {
+        case FLOW_JCC:
+            if (!add_edge(cfg, b, taken, EDGE_TAKEN))
+                blk->exits = true;
+            add_edge(cfg, b, next, EDGE_FALLTHROUGH);
+            break;
+        case FLOW_JMP:
+            if (!add_edge(cfg, b, taken, EDGE_TAKEN))
+                blk->exits = true; // Tail call or jump into another function
+            break;
+        case FLOW_RET:
+        case FLOW_IJMP:
+            blk->exits = true;
+            break;
+        case FLOW_STOP:
+            break;
+        default: // Plain instruction followed by a leader
+            if (!add_edge(cfg, b, next, EDGE_FALLTHROUGH))
+                blk->exits = true;
+            break;
+        }
+        blk->n_succ = cfg->n_edges - blk->first_succ;
+    }
+}
+
+// In edges grouped by destination (counting sort on the edge list)
+static void link_preds(struct cfg *cfg)
+{
+    for (uint32_t e = 0; e < cfg->n_edges; e++)
+        cfg->blocks[cfg->edges[e].to].n_pred++;
+
+    uint32_t sum = 0;
+    for (uint32_t b = 0; b < cfg->n_blocks; b++)
+    {
+        cfg->blocks[b].first_pred = sum;
+        sum += cfg->blocks[b].n_pred;
+        cfg->blocks[b].n_pred = 0;
+    }
+
+    for (uint32_t e = 0; e < cfg->n_edges; e++)
+    {
+        struct cfg_block *dst = &cfg->blocks[cfg->edges[e].to];
+        cfg->preds[dst->first_pred + dst->n_pred++] = e;
+    }
+}
+
+struct cfg *cfg_build(struct arena *a, const uint8_t *bytes, size_t size,
+                      uint64_t addr)
+{
+    struct cfg *cfg = arena_calloc(a, 1, sizeof(*cfg));
+    uint8_t *mark = arena_calloc(a, size + 1, 1);
+    if (!cfg || !mark)
+        return NULL;
+
+    cfg->addr = addr;
+    cfg->bytes = bytes;
+    cfg->size = size;
+    if (!(cfg->ins = arena_alloc(a, (size + 1) * sizeof(*cfg->ins))))
+        return NULL;
+
+    decode_all(cfg, mark);
+
+    for (uint32_t i = 0; i < cfg->n_ins; i++)
+        if (mark[cfg->ins[i].off] & MARK_LEADER)
+            cfg->n_blocks++;
+
+    cfg->blocks = arena_calloc(a, cfg->n_blocks + 1, sizeof(*cfg->blocks));
+    cfg->edges = arena_alloc(a, (2 * cfg->n_blocks + 1) * sizeof(*cfg->edges));
+    cfg->preds = arena_alloc(a, (2 * cfg->n_blocks + 1) * sizeof(*cfg->preds));
+    if (!cfg->blocks || !cfg->edges || !cfg->preds)
+        return NULL;
+
+    uint32_t b = 0;
+    for (uint32_t i = 0; i < cfg->n_ins; i++)
+    {
+        const struct cfg_ins *ci = &cfg->ins[i];
+        if (mark[ci->off] & MARK_LEADER)
+        {
+            cfg->blocks[b].start = addr + ci->off;
+            cfg->blocks[b].first_ins = i;
+            b++;
+        }
+        cfg->blocks[b - 1].n_ins++;
+        cfg->blocks[b - 1].end = addr + ci->off + ci->len;
+    }
+
+    link_blocks(cfg);
+    link_preds(cfg);
+    return cfg;
+}
+
+uint32_t cfg_block_at(const struct cfg *cfg, uint64_t addr)
+{
+    uint32_t lo = 0;
+    uint32_t hi = cfg->n_blocks;
+    while (lo < hi)
+    {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (cfg->blocks[mid].start < addr)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    return lo < cfg->n_blocks && cfg->blocks[lo].start == addr ? lo : CFG_NONE;
+}
+
+void cfg_print(FILE *out, const struct cfg *cfg)
+{
+    cfg_print_notes(out, cfg, NULL, NULL);
+}
+
+void cfg_print_notes(FILE *out, const struct cfg *cfg, cfg_note_fn note,
+                     void *data)
+{
+    struct asm_ins ins;
+
+    for (uint32_t b = 0; b < cfg->n_blocks; b++)
+    {
+        const struct cfg_block *blk = &cfg->blocks[b];
+
+        fprintf(out, "bb%" PRIu32 " <0x%" PRIx64 ">:", b, blk->start);
+        if (blk->n_pred)
+        {
+            fputs("\tpreds:", out);
+            for (uint32_t k = 0; k < blk->n_pred; k++)
+                fprintf(out, " bb%" PRIu32,
+                        cfg->edges[cfg->preds[blk->first_pred + k]].from);
+        }
+        if (note)
+            note(out, cfg, b, data);
+        putc('\n', out);
+
+        for (uint32_t i = blk->first_ins; i < blk->first_ins + blk->n_ins; i++)
+        {
+            const uint8_t *p = cfg->bytes + cfg->ins[i].off;
+            decode64(p, cfg->ins[i].len, &ins);
+            print_asm_ins(out, p, cfg->ins[i].len, &ins,
+                          cfg->addr + cfg->ins[i].off);
+        }
+
+        fputs("\t->", out);
+        for (uint32_t k = 0; k < blk->n_succ; k++)
+        {
+            const struct cfg_edge *e = &cfg->edges[blk->first_succ + k];
+            fprintf(out, " bb%" PRIu32 " (%s)", e->to, edge_names[e->kind]);
+        }
+        if (blk->exits)
+            fputs(" exit", out);
+        fputs("\n\n", out);
+    }
+
+    if (cfg->truncated)
+        fputs("Decoding error, CFG truncated\n", out);
+}
@@ -0,0 +1,294 @@
+#include "include/cost.h"
+#include "include/disas.h"
+#include "include/opcodes.h"
+
+#include <inttypes.h>
+#include <string.h>
+
+#define P(n) (1u << (n))
+
+typedef char cost_classes_check[CC_COUNT == COST_CLASSES ? 1 : -1];
+
+static const char *const skl_ports[] = { "p0", "p1", "p2", "p3",
+                                         "p4", "p5", "p6", "p7" };
+static const char *const zen2_ports[] = { "alu0", "alu1", "alu2", "alu3",
+                                          "agu0", "agu1", "agu2", "fp0",
+                                          "fp1",  "fp2",  "fp3" };
+static const char *const generic_ports[] = { "alu0", "alu1", "alu2",
+                                             "alu3", "load", "store" };
+
+// Intel Skylake client (also a fair model of Coffee/Comet Lake)
+static const struct uarch skl = {
+    "skl", "Intel Skylake", 4, 8, skl_ports, 5,
+    P(2) | P(3), P(2) | P(3) | P(7), P(4),
+    {
+        [CC_DEFAULT] = { 1, 1, 1, P(0) | P(1) | P(5) | P(6) },
+        [CC_ALU] = { 1, 1, 1, P(0) | P(1) | P(5) | P(6) },
+        [CC_MOV] = { 1, 1, 1, P(0) | P(1) | P(5) | P(6) },
+        [CC_LEA] = { 1, 1, 1, P(1) | P(5) },
+        [CC_SHIFT] = { 1, 1, 1, P(0) | P(6) },
+        [CC_SHIFT_CL] = { 2, 3, 1, P(0) | P(6) },
+        [CC_SHLD] = { 3, 1, 1, P(1) },
+        [CC_SHLD_CL] = { 4, 4, 1, P(0) | P(1) | P(5) | P(6) },
+        [CC_IMUL] = { 3, 1, 1, P(1) },
+        [CC_DIV] = { 26, 10, 6, P(0) },
+        [CC_BRANCH] = { 1, 1, 1, P(0) | P(6) },
+        [CC_CALL] = { 2, 2, 1, P(6) },
+        [CC_RET] = { 2, 1, 1, P(6) },
+        [CC_PUSH] = { 1, 1, 1, P(0) | P(1) | P(5) | P(6) },
+        [CC_POP] = { 1, 1, 1, P(0) | P(1) | P(5) | P(6) },
+        [CC_CMOV] = { 1, 1, 1, P(0) | P(6) },
+        [CC_XCHG] = { 2, 3, 1, P(0) | P(1) | P(5) | P(6) },
+        [CC_STRING] = { 4, 4, 1, P(0) | P(1) | P(5) | P(6) },
+        [CC_SYSTEM] = { 25, 20, 1, P(0) | P(1) | P(5) | P(6) },
+        [CC_NOP] = { 0, 1, 0, 0 },
+        [CC_X87] = { 3, 1, 1, P(0) | P(1) },
+        [CC_VEC_ALU] = { 1, 1, 1, P(0) | P(1) | P(5) },
+        [CC_VEC_MOV] = { 1, 1, 1, P(0) | P(1) | P(5) },
+        [CC_VEC_SHUF] = { 1, 1, 1, P(5) },
+        [CC_VEC_MUL] = { 5, 1, 1, P(0) | P(1) },
+        [CC_FP_ADD] = { 4, 1, 1, P(0) | P(1) },
+        [CC_FP_MUL] = { 4, 1, 1, P(0) | P(1) },
+        [CC_FP_DIV] = { 11, 1, 3, P(0) },
+        [CC_FP_CVT] = { 4, 2, 1, P(0) | P(1) | P(5) },
+    },
+};
+
+// AMD Zen 2: 4 ALUs, 3 AGUs (2 loads + 1 store per cycle), 4 FP pipes
+static const struct uarch zen2 = {
+    "zen2", "AMD Zen 2", 5, 11, zen2_ports, 4,
+    P(4) | P(5), P(6), P(6),
+    {
+        [CC_DEFAULT] = { 1, 1, 1, P(0) | P(1) | P(2) | P(3) },
+        [CC_ALU] = { 1, 1, 1, P(0) | P(1) | P(2) | P(3) },
+        [CC_MOV] = { 1, 1, 1, P(0) | P(1) | P(2) | P(3) },
+        [CC_LEA] = { 1, 1, 1, P(0) | P(1) | P(2) | P(3) },
+        [CC_SHIFT] = { 1, 1, 1, P(1) | P(2) },
+        [CC_SHIFT_CL] = { 1, 1, 1, P(1) | P(2) },
+        [CC_SHLD] = { 4, 6, 1, P(0) | P(1) | P(2) | P(3) },
+        [CC_SHLD_CL] = { 4, 7, 1, P(0) | P(1) | P(2) | P(3) },
+        [CC_IMUL] = { 3, 1, 1, P(1) },
+        [CC_DIV] = { 20, 2, 14, P(2) },
+        [CC_BRANCH] = { 1, 1, 1, P(0) | P(3) },
+        [CC_CALL] = { 2, 2, 1, P(0) | P(3) },
+        [CC_RET] = { 2, 1, 1, P(0) | P(3) },
+        [CC_PUSH] = { 1, 1, 1, P(0) | P(1) | P(2) | P(3) },
+        [CC_POP] = { 1, 1, 1, P(0) | P(1) | P(2) | P(3) },
+        [CC_CMOV] = { 1, 1, 1, P(0) | P(1) | P(2) | P(3) },
+        [CC_XCHG] = { 2, 2, 1, P(0) | P(1) | P(2) | P(3) },
+        [CC_STRING] = { 4, 4, 1, P(0) | P(1) | P(2) | P(3) },
+        [CC_SYSTEM] = { 30, 20, 1, P(0) | P(1) | P(2) | P(3) },
+        [CC_NOP] = { 0, 1, 0, 0 },
+        [CC_X87] = { 5, 1, 1, P(7) | P(8) },
+        [CC_VEC_ALU] = { 1, 1, 1, P(7) | P(8) | P(9) | P(10) },
+        [CC_VEC_MOV] = { 1, 1, 1, P(7) | P(8) | P(9) | P(10) },
+        [CC_VEC_SHUF] = { 1, 1, 1, P(8) | P(9) },
+        [CC_VEC_MUL] = { 4, 1, 1, P(7) },
+        [CC_FP_ADD] = { 3, 1, 1, P(9) | P(10) },
+        [CC_FP_MUL] = { 3, 1, 1, P(7) | P(8) },
+        [CC_FP_DIV] = { 10, 1, 3, P(10) },
+        [CC_FP_CVT] = { 4, 1, 1, P(10) },
+    },
+};
+
+// Idealized 4-wide core: useful as a machine independent baseline
+static const struct uarch generic = {
+    "generic", "Generic 4-wide", 4, 6, generic_ports, 4,
+    P(4), P(5), P(5),
+    {
+        [CC_DEFAULT] = { 1, 1, 1, P(0) | P(1) | P(2) | P(3) },
+        [CC_ALU] = { 1, 1, 1, P(0) | P(1) | P(2) | P(3) },
+        [CC_MOV] = { 1, 1, 1, P(0) | P(1) | P(2) | P(3) },
+        [CC_LEA] = { 1, 1, 1, P(0) | P(1) | P(2) | P(3) },
+        [CC_SHIFT] = { 1, 1, 1, P(0) | P(1) | P(2) | P(3) },
+        [CC_SHIFT_CL] = { 2, 2, 1, P(0) | P(1) | P(2) | P(3) },
+        [CC_SHLD] = { 3, 1, 1, P(1) },
+        [CC_SHLD_CL] = { 4, 4, 1, P(0) | P(1) | P(2) | P(3) },
+        [CC_IMUL] = { 3, 1, 1, P(1) },
+        [CC_DIV] = { 25, 1, 20, P(0) },
+        [CC_BRANCH] = { 1, 1, 1, P(0) | P(3) },
+        [CC_CALL] = { 2, 2, 1, P(0) | P(3) },
+        [CC_RET] = { 2, 1, 1, P(0) | P(3) },
+        [CC_PUSH] = { 1, 1, 1, P(0) | P(1) | P(2) | P(3) },
+        [CC_POP] = { 1, 1, 1, P(0) | P(1) | P(2) | P(3) },
+        [CC_CMOV] = { 1, 1, 1, P(0) | P(1) | P(2) | P(3) },
+        [CC_XCHG] = { 2, 2, 1, P(0) | P(1) | P(2) | P(3) },
+        [CC_STRING] = { 4, 4, 1, P(0) | P(1) | P(2) | P(3) },
+        [CC_SYSTEM] = { 25, 20, 1, P(0) | P(1) | P(2) | P(3) },
+        [CC_NOP] = { 0, 1, 0, 0 },
+        [CC_X87] = { 3, 1, 1, P(0) | P(1) },
+        [CC_VEC_ALU] = { 1, 1, 1, P(0) | P(1) | P(2) },
+        [CC_VEC_MOV] = { 1, 1, 1, P(0) | P(1) | P(2) },
+        [CC_VEC_SHUF] = { 1, 1, 1, P(2) },
+        [CC_VEC_MUL] = { 4, 1, 1, P(0) | P(1) },
+        [CC_FP_ADD] = { 3, 1, 1, P(0) | P(1) },
+        [CC_FP_MUL] = { 4, 1, 1, P(0) | P(1) },
+        [CC_FP_DIV] = { 12, 1, 4, P(0) },
+        [CC_FP_CVT] = { 4, 1, 1, P(0) | P(1) },
+    },
+};
+
+static const struct uarch *const uarchs[] = { &skl, &zen2, &generic };
+
+const struct uarch *uarch_find(const char *name)
+{
+    for (size_t i = 0; i < sizeof(uarchs) / sizeof(*uarchs); i++)
+        if (strcmp(uarchs[i]->name, name) == 0)
+            return uarchs[i];
+    return NULL;
+}
+
+void uarch_list(FILE *out)
+{
+    fputs("Available models:\n", out);
+    for (size_t i = 0; i < sizeof(uarchs) / sizeof(*uarchs); i++)
+        fprintf(out, "\t%-8s %s\n", uarchs[i]->name, uarchs[i]->desc);
+}
+
+void cost_init(struct block_cost *bc)
+{
+    memset(bc, 0, sizeof(*bc));
+}
+
+// Greedy port binding: each uop goes to the least loaded eligible port
+static void bind_uops(const struct uarch *u, struct block_cost *bc,
+                      uint16_t ports, unsigned uops, unsigned occ)
+{
+    for (unsigned k = 0; k < uops && ports; k++)
+    {
+        int best = -1;
+        for (int p = 0; p < u->n_ports; p++)
+            if ((ports & P(p))
+                && (best < 0 || bc->port_load[p] < bc->port_load[best]))
+                best = p;
+        bc->port_load[best] += occ;
+    }
+}
+
+static bool is_rm(uint8_t type)
+{
+    return type == OT_RM || (type >= OT_RM8 && type <= OT_RMZ);
+}
+
+static void add_ins(const struct uarch *u, struct block_cost *bc,
+                    const struct asm_ins *ins)
+{
+    uint8_t cls = ins_cost_class(ins);
+    const struct op_cost *c = &u->cost[cls];
+    bool mem = ins_mem_operand(ins) && cls != CC_LEA && cls != CC_NOP;
+    bool store = mem && ins->op_desc && ins->op_desc->operand_count
+        && is_rm(ins->op_desc->operand_types[0]);
+    bool load = mem && (!store || cls != CC_MOV); // RMW loads too
+    uint32_t lat = c->lat;
+
+    bc->n_ins++;
+    bc->uops += c->uops + load + 2 * store;
+    bind_uops(u, bc, c->ports, c->uops, c->occ);
+    if (load)
+    {
+        bind_uops(u, bc, u->load_ports, 1, 1);
+        lat += u->load_lat;
+    }
+    if (store)
+    {
+        bind_uops(u, bc, u->sta_ports, 1, 1);
+        bind_uops(u, bc, u->std_ports, 1, 1);
+    }
+
+    // Register dependency chain: sources are every register operand and
+    // the address registers, the first register operand is the destination
+    uint32_t start = 0;
+    uint32_t srcs = ins_mem_regs(ins);
+    for (int i = 0; i < 3; i++)
+    {
+        int r = ins_operand_reg(ins, i);
+        if (r >= 0 && !(i == 0 && (cls == CC_MOV || cls == CC_LEA)))
+            srcs |= 1u << r;
+    }
+    for (int r = 0; r < COST_NREGS; r++)
+        if ((srcs & P(r)) && bc->ready[r] > start)
+            start = bc->ready[r];
+
+    int dst = store ? -1 : ins_operand_reg(ins, 0);
+    if (dst >= 0)
+        bc->ready[dst] = start + lat;
+    if (start + lat > bc->latency)
+        bc->latency = start + lat;
+}
+
+void cost_add(const struct uarch *u, struct block_cost *bc, const uint8_t *p,
+              size_t size)
+{
+    const uint8_t *end = p + size;
+    struct asm_ins ins;
+
+    while (p < end)
+    {
+        size_t n = decode64(p, (size_t)(end - p), &ins);
+        if (!n)
+            break;
+        add_ins(u, bc, &ins);
+        p += n;
+    }
+}
+
+void cost_finish(const struct uarch *u, struct block_cost *bc)
+{
+    bc->issue = (double)bc->uops / u->width;
+    bc->busiest = 0;
+    for (int p = 1; p < u->n_ports; p++)
+        if (bc->port_load[p] > bc->port_load[bc->busiest])
+            bc->busiest = p;
+    bc->port = bc->port_load[bc->busiest];
+    bc->cycles = bc->issue > bc->port ? bc->issue : bc->port;
+}
+
+static void print_cost(FILE *out, const struct uarch *u,
+                       const struct block_cost *bc)
+{
+    fprintf(out, "~%.2f cyc/iter (%" PRIu32 " uops, issue %.2f, %s %.2f, "
+            "dep chain %" PRIu32 ")",
+            bc->cycles, bc->uops, bc->issue, u->port_names[bc->busiest],
+            bc->port, bc->latency);
+}
+
+void cost_note(FILE *out, const struct cfg *cfg, uint32_t block, void *data)
+{
+    const struct uarch *u = data;
+    const struct cfg_block *blk = &cfg->blocks[block];
+    struct block_cost bc;
+
+    cost_init(&bc);
+    cost_add(u, &bc, cfg->bytes + (blk->start - cfg->addr),
+             (size_t)(blk->end - blk->start));
+    cost_finish(u, &bc);
+    putc('\t', out);
+    print_cost(out, u, &bc);
+}
+
+void cost_print_loops(FILE *out, const struct uarch *u, const struct cfg *cfg,
+                      const struct loop_info *li)
+{
+    if (!li->n_loops)
+        return;
+    fprintf(out, "Loop estimates (%s, every body block executed once):\n",
+            u->desc);
+    for (uint32_t l = 0; l < li->n_loops; l++)
+    {
+        const struct loop *lp = &li->loops[l];
+        struct block_cost bc;
+
+        cost_init(&bc);
+        for (uint32_t i = 0; i < lp->n_blocks; i++)
+        {
+            const struct cfg_block *blk = &cfg->blocks[lp->blocks[i]];
+            cost_add(u, &bc, cfg->bytes + (blk->start - cfg->addr),
+                     (size_t)(blk->end - blk->start));
+        }
+        cost_finish(u, &bc);
+        fprintf(out, "%*sL%" PRIu32 ": ", (int)(2 * lp->depth), "", l);
+        print_cost(out, u, &bc);
+        putc('\n', out);
+    }
+    putc('\n', out);
+}
@@ -0,0 +1,196 @@
+#include "include/dataidx.h"
+
+#include <elf.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int is_string_section(const char *name, const Elf64_Shdr *sh)
+{
+    return sh->sh_type == SHT_PROGBITS && !(sh->sh_flags & SHF_EXECINSTR)
+        && ((sh->sh_flags & SHF_STRINGS)
+            || (name && strncmp(name, ".rodata", 7) == 0));
+}
+
+static int build_sections(struct data_index *idx, const struct elf_bin *bin)
+{
+    const Elf64_Shdr *sh = bin->shdrs;
+    size_t n = bin->ehdr->e_shnum;
+
+    idx->sec_start = malloc((n + 1) * sizeof(*idx->sec_start));
+    idx->sec_end = malloc((n + 1) * sizeof(*idx->sec_end));
+    idx->sec_name = malloc((n + 1) * sizeof(*idx->sec_name));
+    idx->sec_str = malloc((n + 1) * sizeof(*idx->sec_str));
+    if (!idx->sec_start || !idx->sec_end || !idx->sec_name || !idx->sec_str)
+        return -1;
+
+    // Few and already in address order in linked files: insertion sort
+    for (size_t i = 0; i < n; i++)
+    {
+        if (!(sh[i].sh_flags & SHF_ALLOC) || !sh[i].sh_size
+            || (sh[i].sh_flags & SHF_TLS))
+            continue;
+        const char *name = elf_section_name(bin, &sh[i]);
+        // Mapped here, lookups from several threads must not map anything
+        const uint8_t *str =
+            is_string_section(name, &sh[i]) ? elf_section_data(bin, &sh[i])
+                                            : NULL;
+        size_t j = idx->n_sec++;
+        for (; j && idx->sec_start[j - 1] > sh[i].sh_addr; j--)
+        {
+            idx->sec_start[j] = idx->sec_start[j - 1];
+            idx->sec_end[j] = idx->sec_end[j - 1];
+            idx->sec_name[j] = idx->sec_name[j - 1];
+            idx->sec_str[j] = idx->sec_str[j - 1];
+        }
+        idx->sec_start[j] = sh[i].sh_addr;
+        idx->sec_end[j] = sh[i].sh_addr + sh[i].sh_size;
+        idx->sec_name[j] = name ? name : "?";
+        idx->sec_str[j] = str;
+    }
+    return 0;
+}
+
+static int keep_symbol(const Elf64_Sym *s, size_t str_size)
+{
+    unsigned type = ELF64_ST_TYPE(s->st_info);
+    return (type == STT_OBJECT || type == STT_FUNC || type == STT_NOTYPE)
+        && s->st_shndx != SHN_UNDEF && s->st_shndx < SHN_LORESERVE
+        && s->st_value && s->st_name && s->st_name < str_size;
+}
+
+static int build_symbols(struct data_index *idx, const struct elf_bin *bin)
+{
+    const Elf64_Shdr *symtab = bin->impsec ? bin->impsec->symtab : NULL;
+    const Elf64_Shdr *strtab = bin->impsec ? bin->impsec->strtab : NULL;
+    const Elf64_Sym *syms = symtab ? elf_section_data(bin, symtab) : NULL;
+    const char *str = strtab ? elf_section_data(bin, strtab) : NULL;
+    size_t count = syms && str ? symtab->sh_size / sizeof(Elf64_Sym) : 0;
+
+    uint32_t *id = malloc((count + 1) * sizeof(*id)); // Symbol table index
+    uint64_t *ktmp = malloc((count + 1) * sizeof(*ktmp));
+    uint32_t *vtmp = malloc((count + 1) * sizeof(*vtmp));
+    idx->start = malloc((count + 1) * sizeof(*idx->start));
+    idx->end = malloc((count + 1) * sizeof(*idx->end));
+    idx->name = malloc((count + 1) * sizeof(*idx->name));
+    int err = !id || !ktmp || !vtmp || !idx->start || !idx->end || !idx->name;
+
+    size_t n = 0;
+    for (size_t i = 0; i < count && !err; i++)
+        if (keep_symbol(&syms[i], strtab->sh_size))
+        {
+            idx->start[n] = syms[i].st_value;
+            id[n++] = i;
+        }
+    if (!err)
+    {
+        radix_sort_kv(idx->start, id, ktmp, vtmp, n);
+        for (size_t i = 0; i < n; i++)
+        {
+            const Elf64_Sym *s = &syms[id[i]];
+            idx->end[i] = s->st_value + (s->st_size ? s->st_size : 1);
+            idx->name[i] = str + s->st_name;
+        }
+        idx->n = n;
+    }
+    free(id);
+    free(ktmp);
+    free(vtmp);
+    return err ? -1 : 0;
+}
+
+int dataidx_build(struct data_index *idx, const struct elf_bin *bin)
+{
+    memset(idx, 0, sizeof(*idx));
+    if (build_sections(idx, bin) || build_symbols(idx, bin))
+    {
+        dataidx_free(idx);
+        return -1;
+    }
+    return 0;
+}
+
+void dataidx_free(struct data_index *idx)
+{
+    free(idx->start);
+    free(idx->end);
+    free(idx->name);
+    free(idx->sec_start);
+    free(idx->sec_end);
+    free(idx->sec_name);
+    free(idx->sec_str);
+    memset(idx, 0, sizeof(*idx));
+}
+
+// Index of the last interval starting at or before addr, n if none
+static size_t last_before(const uint64_t *start, size_t n, uint64_t addr)
+{
+    size_t lo = 0;
+    size_t hi = n;
+    while (lo < hi)
+    {
+        size_t mid = lo + (hi - lo) / 2;
+        if (start[mid] <= addr)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo ? lo - 1 : n;
+}
+
+// Quoted, C escaped, only for NUL terminated printable text
+static int preview(char *buf, size_t cap, const uint8_t *p, size_t avail)
+{
+    char tmp[2 * DATAIDX_PREVIEW + 8];
+    size_t len = 0;
+    size_t i = 0;
+    for (; i < avail && p[i]; i++)
+    {
+        uint8_t c = p[i];
+        const char *esc = c == '\n' ? "\\n"
+            : c == '\t'             ? "\\t"
+            : c == '"'              ? "\\\""
+            : c == '\\'             ? "\\\\"
+                                    : NULL;
+        if (!esc && (c < 0x20 || c > 0x7E))
+            return 0;
+        if (i == DATAIDX_PREVIEW)
+            break;
+        if (esc)
+        {
+            memcpy(tmp + len, esc, 2);
+            len += 2;
+        }
+        else
+            tmp[len++] = c;
+    }
+    if (!i || (i == avail))
+        return 0;
+    tmp[len] = '\0';
+    return snprintf(buf, cap, " \"%s%s\"", tmp,
+                    i == DATAIDX_PREVIEW ? "..." : "");
+}
+
+int dataidx_label(const struct data_index *idx, uint64_t addr, char *buf,
+                  size_t cap)
+{
+    size_t s = last_before(idx->sec_start, idx->n_sec, addr);
+    if (s < idx->n_sec && addr >= idx->sec_end[s])
+        s = idx->n_sec;
+    size_t y = last_before(idx->start, idx->n, addr);
+    if (y < idx->n && addr >= idx->end[y])
+        y = idx->n;
+    if (s == idx->n_sec && y == idx->n)
+        return 0;
+
+    const char *name = y < idx->n ? idx->name[y] : idx->sec_name[s];
+    uint64_t off = addr - (y < idx->n ? idx->start[y] : idx->sec_start[s]);
+    int len = off ? snprintf(buf, cap, "<%s+0x%" PRIx64 ">", name, off)
+                  : snprintf(buf, cap, "<%s>", name);
+    if (len > 0 && (size_t)len < cap && s < idx->n_sec && idx->sec_str[s])
+        preview(buf + len, cap - len,
+                idx->sec_str[s] + (addr - idx->sec_start[s]),
+                idx->sec_end[s] - addr);
+    return 1;
+}
@@ -0,0 +1,240 @@
+#include "include/diff.h"
+#include "include/disas.h"
+#include "include/hash.h"
+
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct ins_line // One decoded instruction of a changed function
+{
+    uint64_t rip;
+    uint64_t hash;
+    char text[DIFF_COL + 1];
+};
+
+static int cmp_fn_name(const void *a, const void *b)
+{
+    const struct fn_ref *x = a;
+    const struct fn_ref *y = b;
+    int c = strcmp(x->sym->name, y->sym->name);
+    if (c)
+        return c;
+    return (x->sym->addr > y->sym->addr) - (x->sym->addr < y->sym->addr);
+}
+
+// Hash every function (decode only, nothing is formatted) and sort by name
+int fn_hashes_build(struct fn_hashes *h, const struct sym_list *lst)
+{
+    struct fn_ref *refs = malloc((lst->count + 1) * sizeof(*refs));
+    if (!refs)
+        return -1;
+
+    for (size_t i = 0; i < lst->count; i++)
+    {
+        refs[i].sym = &lst->items[i];
+        refs[i].hash = func_hash(lst->items[i].bytes, lst->items[i].size);
+    }
+    qsort(refs, lst->count, sizeof(*refs), cmp_fn_name);
+
+    h->ref = refs;
+    h->n = lst->count;
+    return 0;
+}
+
+void fn_hashes_free(struct fn_hashes *h)
+{
+    free(h->ref);
+    h->ref = NULL;
+    h->n = 0;
+}
+
+static size_t decode_lines(const struct sym_info *sym, struct ins_line **out)
+{
+    const uint8_t *p = sym->bytes;
+    const uint8_t *end = p + sym->size;
+    struct ins_line *lines = malloc((sym->size + 1) * sizeof(*lines));
+    size_t n = 0;
+    struct asm_ins ins;
+
+    *out = lines;
+    if (!lines)
+        return 0;
+
+    while (p < end)
+    {
+        size_t len = decode64(p, (size_t)(end - p), &ins);
+        if (!len)
+            break;
+
+        lines[n].rip = sym->addr + (uint64_t)(p - sym->bytes);
+        lines[n].hash = ins_hash(&ins);
+        format_ins(lines[n].text, sizeof(lines[n].text), &ins);
+        n++;
+        p += len;
+    }
+
+    return n;
+}
+
+static void print_row(FILE *out, const struct ins_line *l, char mark,
+                      const struct ins_line *r)
+{
+    if (l)
+        fprintf(out, "%8" PRIx64 "  %-*s", l->rip, DIFF_COL, l->text);
+    else
+        fprintf(out, "%8s  %-*s", "", DIFF_COL, "");
+
+    fprintf(out, " %c ", mark);
+
+    if (r)
+        fprintf(out, "%8" PRIx64 "  %s\n", r->rip, r->text);
+    else
+        putc('\n', out);
+}
+
+// LCS of the instruction hash sequences, suffix lengths in a (na+1)*(nb+1)
+// table so the walk below can go forwards
+static uint32_t *lcs_table(const struct ins_line *a, size_t na,
+                           const struct ins_line *b, size_t nb)
+{
+    size_t w = nb + 1;
+    uint32_t *t = calloc((na + 1) * w, sizeof(*t));
+    if (!t)
+        return NULL;
+
+    for (size_t i = na; i-- > 0;)
+        for (size_t j = nb; j-- > 0;)
+        {
+            if (a[i].hash == b[j].hash)
+                t[i * w + j] = t[(i + 1) * w + j + 1] + 1;
+            else
+            {
+                uint32_t down = t[(i + 1) * w + j];
+                uint32_t right = t[i * w + j + 1];
+                t[i * w + j] = down > right ? down : right;
+            }
+        }
+
+    return t;
+}
+
+static void side_by_side(FILE *out, const struct sym_info *old_sym,
+                         const struct sym_info *new_sym)
+{
+    struct ins_line *a = NULL;
+    struct ins_line *b = NULL;
+    size_t na = decode_lines(old_sym, &a);
+    size_t nb = decode_lines(new_sym, &b);
+    uint32_t *t = NULL;
+    size_t w = nb + 1;
+
+    if (a && b && (uint64_t)(na + 1) * w <= DIFF_LCS_MAX)
+        t = lcs_table(a, na, b, nb);
+
+    size_t i = 0;
+    size_t j = 0;
+    while (i < na || j < nb)
+    {
+        if (i < na && j < nb && a[i].hash == b[j].hash)
+            print_row(out, &a[i++], ' ', &b[j++]);
+        else if (i < na && j < nb
+                 && (!t || t[(i + 1) * w + j + 1] == t[i * w + j]))
+            print_row(out, &a[i++], '|', &b[j++]); // Both sides replaced
+        else if (j >= nb || (i < na && t[(i + 1) * w + j] >= t[i * w + j + 1]))
+            print_row(out, &a[i++], '<', NULL);
+        else
+            print_row(out, NULL, '>', &b[j++]);
+    }
+
+    free(t);
+    free(a);
+    free(b);
+}
+
+int bin_diff(FILE *out, const struct elf_bin *old_bin,
+             const struct elf_bin *new_bin)
+{
+    fprintf(out, "--- %s\n+++ %s\n", old_bin->f->name, new_bin->f->name);
+    return sym_diff(out, &old_bin->syms, &new_bin->syms);
+}
+
+int sym_diff(FILE *out, const struct sym_list *lo, const struct sym_list *ln)
+{
+    struct fn_hashes a = { NULL, 0 };
+    struct fn_hashes b = { NULL, 0 };
+    int ret = -1;
+
+    if (!fn_hashes_build(&a, lo) && !fn_hashes_build(&b, ln))
+        ret = hashed_diff(out, &a, &b);
+    fn_hashes_free(&a);
+    fn_hashes_free(&b);
+    return ret;
+}
+
+int hashed_diff(FILE *out, const struct fn_hashes *ha,
+                const struct fn_hashes *hb)
+{
+    const struct fn_ref *a = ha->ref;
+    const struct fn_ref *b = hb->ref;
+    size_t n_max = ha->n < hb->n ? hb->n : ha->n;
+    struct fn_ref *changed = malloc((n_max + 1) * 2 * sizeof(*changed));
+
+    if (!changed)
+        return -1;
+
+    size_t same = 0;
+    size_t n_changed = 0;
+    size_t added = 0;
+    size_t removed = 0;
+    size_t i = 0;
+    size_t j = 0;
+    while (i < ha->n || j < hb->n)
+    {
+        int c = i >= ha->n ? 1
+            : j >= hb->n   ? -1
+                           : strcmp(a[i].sym->name, b[j].sym->name);
+        if (c < 0)
+        {
+            fprintf(out, "- %s\n", a[i++].sym->name);
+            removed++;
+        }
+        else if (c > 0)
+        {
+            fprintf(out, "+ %s\n", b[j++].sym->name);
+            added++;
+        }
+        else
+        {
+            if (a[i].hash == b[j].hash)
+                same++;
+            else
+            {
+                fprintf(out,
+                        "~ %s (0x%" PRIx64 ", %zu bytes -> 0x%" PRIx64
+                        ", %zu bytes)\n",
+                        a[i].sym->name, (uint64_t)a[i].sym->addr,
+                        a[i].sym->size, (uint64_t)b[j].sym->addr,
+                        b[j].sym->size);
+                changed[2 * n_changed] = a[i];
+                changed[2 * n_changed + 1] = b[j];
+                n_changed++;
+            }
+            i++;
+            j++;
+        }
+    }
+
+    fprintf(out, "\n%zu unchanged, %zu changed, %zu added, %zu removed\n",
+            same, n_changed, added, removed);
+
+    // Only changed functions are ever formatted
+    for (size_t k = 0; k < n_changed; k++)
+    {
+        fprintf(out, "\n~ %s\n", changed[2 * k].sym->name);
+        side_by_side(out, changed[2 * k].sym, changed[2 * k + 1].sym);
+    }
+
+    free(changed);
+    return 0;
+}
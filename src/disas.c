@@ -9,39 +9,6 @@
 #include <stdio.h>
 #include <string.h>
 
-struct asm_ins
-{
-    // Prefixes / mode
-    bool has_66, has_67;
-    bool lock, rep, repne;
-    uint8_t rex; // 0100WRXB, byte extension
-    uint8_t rex_w, rex_r, rex_x, rex_b;
-    int op_size; // 16/32/64 (Z-width)
-    int addr_size;
-
-    // Opcode bytes
-    uint8_t map; // 1, 0x0F, 0x38, 0x3A
-    uint8_t op; // opcode byte in that map
-
-    const struct opcode_info *op_desc; // Custom opcode descriptor
-
-    // ModR/M / SIB
-    bool has_modrm, has_sib;
-    uint8_t modrm; // Operands encoding
-    uint8_t mod; // 2 bits, displacement size
-    uint8_t reg; // 3 bits, either opcode extension of register reference
-    uint8_t rm; // 3-bits, direct or indirect register operand (extended by REX)
-
-    uint8_t sib; // Memory addressing
-    uint8_t scale, index, base; // Addr = base + (index * scale) + disp
-
-    // Displacement / immediates
-    int disp_size;
-    int imm_size; // Size if encoded operands in instruction
-    int64_t disp; // sign-extended disp8/disp32
-    uint64_t imm; // raw immediate value TODO: use this
-};
-
 static const char *reg8_no_rex[16] = { "al",   "cl",   "dl",   "bl",
                                        "ah",   "ch",   "dh",   "bh",
                                        "r8b",  "r9b",  "r10b", "r11b",
@@ -157,7 +124,7 @@ static void format_mem(char *buf, size_t cap, const struct asm_ins *ins)
     const int aw = ins->addr_size;
 
     // case RIP-relative (!SIB && mod == 0 && rm=101)
-    if (!ins->has_sib && ins->mod != 3 && ((ins->rm & 7) == 5) && aw == 64)
+    if (!ins->has_sib && ins->mod == 0 && ((ins->rm & 7) == 5) && aw == 64)
     {
         if (ins->disp_size == 0)
             snprintf(buf, cap, "[rip]");
@@ -262,6 +229,18 @@ static const struct opcode_info *get_opcode_info(uint8_t op, uint8_t map)
     }
 }
 
+// Digit groups: ModR/M.reg picks the row for the opcode
+static const struct opcode_info *get_group_info(const struct asm_ins *ins)
+{
+    if (ins->op == 0xF6 || ins->op == 0xF7) // Group 3
+        return &group3_map[ins->op & 1][ins->reg & 7];
+    if (ins->op == 0xC0 || ins->op == 0xC1) // Group 2, count in imm8
+        return &group2_map[ins->op & 1][ins->reg & 7];
+    if (ins->op >= 0xD0 && ins->op <= 0xD3) // Group 2, count 1 or cl
+        return &group2_map[2 + (ins->op & 3)][ins->reg & 7];
+    return ins->op_desc;
+}
+
 static int width_from_kind(uint8_t kind, int z)
 {
     switch (kind)
@@ -286,10 +265,9 @@ static int width_from_kind(uint8_t kind, int z)
     }
 }
 
-static void print_operand_generic(const struct asm_ins *ins, uint8_t kind,
-                                  int idx)
+static int format_operand(char *buf, size_t cap, const struct asm_ins *ins,
+                          uint8_t kind)
 {
-    (void)idx;
     switch (kind)
     {
     case OT_REG:
@@ -312,8 +290,7 @@ static void print_operand_generic(const struct asm_ins *ins, uint8_t kind,
         }
         else
             regid = ins->reg;
-        printf("%s", reg_name(regid, w, ins->rex));
-        break;
+        return snprintf(buf, cap, "%s", reg_name(regid, w, ins->rex));
     }
 
     // r/m operand (depending on mod)
@@ -325,57 +302,64 @@ static void print_operand_generic(const struct asm_ins *ins, uint8_t kind,
     case OT_RMZ: {
         int w = width_from_kind(kind, ins->op_size);
         if (ins->mod == 3)
-            printf("%s", reg_name(ins->rm, w, ins->rex));
-        else
-        {
-            char mem[OP_BUFSIZE];
-            format_mem(mem, OP_BUFSIZE, ins);
-            printf("%s", mem);
-        }
-        break;
+            return snprintf(buf, cap, "%s", reg_name(ins->rm, w, ins->rex));
+
+        char mem[OP_BUFSIZE];
+        format_mem(mem, OP_BUFSIZE, ins);
+        return snprintf(buf, cap, "%s", mem);
     }
 
     // fixed registers
     case OT_AL:
-        printf("al");
-        break;
+        return snprintf(buf, cap, "al");
     case OT_AX:
-        printf("ax");
-        break;
+        return snprintf(buf, cap, "ax");
     case OT_EAX:
-        printf("eax");
-        break;
+        return snprintf(buf, cap, "eax");
     case OT_RAX:
-        printf("rax");
-        break;
+        return snprintf(buf, cap, "rax");
+    case OT_CL:
+        return snprintf(buf, cap, "cl");
 
     // immediates
     case OT_IMM8:
-        printf("0x%02" PRIx64, (uint64_t)(ins->imm & 0xff));
-        break;
+        return snprintf(buf, cap, "0x%02" PRIx64, (uint64_t)(ins->imm & 0xff));
     case OT_IMM16:
-        printf("0x%04" PRIx64, (uint64_t)(ins->imm & 0xffff));
-        break;
+        return snprintf(buf, cap, "0x%04" PRIx64,
+                        (uint64_t)(ins->imm & 0xffff));
     case OT_IMM32:
-        printf("0x%08" PRIx64, (uint64_t)(ins->imm & 0xffffffffULL));
-        break;
+        return snprintf(buf, cap, "0x%08" PRIx64,
+                        (uint64_t)(ins->imm & 0xffffffffULL));
     case OT_IMM64:
-        printf("0x%016" PRIx64, (uint64_t)ins->imm);
-        break;
+        return snprintf(buf, cap, "0x%016" PRIx64, (uint64_t)ins->imm);
 
     // rel8/rel32 (print as signed displacements)
     case OT_REL8:
-        printf(".+%d", (int8_t)ins->imm);
-        break;
+        return snprintf(buf, cap, ".+%d", (int8_t)ins->imm);
     case OT_REL32:
-        printf(".+%d", (int32_t)ins->imm);
-        break;
+        return snprintf(buf, cap, ".+%d", (int32_t)ins->imm);
     default:
-        printf("<?>");
-        break;
+        return snprintf(buf, cap, "<?>");
     }
 }
 
+// Comma separated operand list, returns the formatted length
+static size_t format_operands(char *buf, size_t cap, const struct asm_ins *ins)
+{
+    size_t len = 0;
+
+    for (int i = 0; i < ins->op_desc->operand_count && i < 3; i++)
+    {
+        if (i && len < cap)
+            len += (size_t)snprintf(buf + len, cap - len, ", ");
+        if (len < cap)
+            len += (size_t)format_operand(buf + len, cap - len, ins,
+                                          ins->op_desc->operand_types[i]);
+    }
+
+    return len < cap ? len : cap - 1;
+}
+
 static size_t resolve_prefixes(const uint8_t *p, struct asm_ins *ins,
                                size_t max)
 {
@@ -565,6 +549,8 @@ size_t decode64(const uint8_t *p, size_t max, struct asm_ins *ins)
         ins->has_modrm = true;
         ins->modrm = *p++;
         decode_modrm(ins);
+        if (ins->op_desc->modrm_kind == D && !ins->op_desc->mnemonic[0])
+            ins->op_desc = get_group_info(ins);
     }
 
     // SIB + displacement handling
@@ -614,40 +600,262 @@ size_t decode64(const uint8_t *p, size_t max, struct asm_ins *ins)
     return (size_t)(p - start);
 }
 
-static void print_asm_ins(const uint8_t *addr, size_t len,
-                          const struct asm_ins *ins, uint64_t rip)
+void disas_iter_init(struct disas_iter *it, const uint8_t *code, size_t size,
+                     uint64_t rip)
+{
+    it->p = code;
+    it->end = code + size;
+    it->rip = rip;
+    it->ins_bytes = NULL;
+    it->ins_rip = rip;
+    it->ins_len = 0;
+}
+
+int disas_next(struct disas_iter *it, struct asm_ins *ins)
+{
+    if (it->p >= it->end)
+        return 0;
+
+    size_t n = decode64(it->p, (size_t)(it->end - it->p), ins);
+    if (!n)
+        return -1;
+
+    it->ins_bytes = it->p;
+    it->ins_rip = it->rip;
+    it->ins_len = n;
+    it->p += n;
+    it->rip += n;
+    return 1;
+}
+
+bool ins_has_rel(const struct asm_ins *ins)
+{
+    if (!ins->op_desc)
+        return false;
+
+    for (int i = 0; i < ins->op_desc->operand_count && i < 3; i++)
+        if (ins->op_desc->operand_types[i] == OT_REL8
+            || ins->op_desc->operand_types[i] == OT_REL32)
+            return true;
+
+    return false;
+}
+
+bool ins_rip_relative(const struct asm_ins *ins)
+{
+    return ins->has_modrm && !ins->has_sib && ins->mod == 0
+        && (ins->rm & 7) == 5 && ins->addr_size == 64;
+}
+
+enum ins_flow ins_flow(const struct asm_ins *ins)
+{
+    if (ins->map == 0x0F)
+    {
+        if (ins->op >= 0x80 && ins->op <= 0x8F)
+            return FLOW_JCC;
+        return ins->op == 0x0B ? FLOW_STOP : FLOW_NONE; // ud2
+    }
+    if (ins->map != 1)
+        return FLOW_NONE;
+
+    if ((ins->op >= 0x70 && ins->op <= 0x7F)
+        || (ins->op >= 0xE0 && ins->op <= 0xE3))
+        return FLOW_JCC;
+
+    switch (ins->op)
+    {
+    case 0xE8:
+        return FLOW_CALL;
+    case 0xE9:
+    case 0xEB:
+        return FLOW_JMP;
+    case 0xC2:
+    case 0xC3:
+    case 0xCA:
+    case 0xCB:
+    case 0xCF:
+        return FLOW_RET;
+    case 0xCC:
+    case 0xF4:
+        return FLOW_STOP;
+    case 0xFF: // Group 5, the digit selects the operation
+        if (ins->reg == 2 || ins->reg == 3)
+            return FLOW_ICALL;
+        if (ins->reg == 4 || ins->reg == 5)
+            return FLOW_IJMP;
+        return FLOW_NONE;
+    default:
+        return FLOW_NONE;
+    }
+}
+
+uint64_t ins_target(const struct asm_ins *ins, uint64_t rip, size_t len)
+{
+    uint64_t next = rip + len;
+
+    if (ins_has_rel(ins))
+        return ins->imm_size == 1 ? next + (int64_t)(int8_t)ins->imm
+                                  : next + (int64_t)(int32_t)ins->imm;
+    if (ins_rip_relative(ins))
+        return next + ins->disp;
+    return 0;
+}
+
+uint8_t ins_cost_class(const struct asm_ins *ins)
+{
+    const uint8_t *table;
+    uint8_t def = CC_VEC_ALU;
+
+    if (!ins->op_desc || !ins->op_desc->mnemonic || !ins->op_desc->mnemonic[0])
+        return CC_ALU;
+
+    switch (ins->map)
+    {
+    case 1:
+        table = cost_class_prim;
+        def = CC_ALU;
+        break;
+    case 0x0F:
+        table = cost_class_0f;
+        break;
+    case 0x38:
+        table = cost_class_0f38;
+        break;
+    default:
+        table = cost_class_0f3a;
+        break;
+    }
+
+    if (ins->map == 1 && ins->op == 0xFF) // Group 5
+    {
+        if (ins->reg == 2 || ins->reg == 3)
+            return CC_CALL;
+        if (ins->reg == 4 || ins->reg == 5)
+            return CC_BRANCH;
+        return ins->reg == 6 ? CC_PUSH : CC_ALU;
+    }
+    if (ins->map == 1 && (ins->op == 0xF6 || ins->op == 0xF7)) // Group 3
+    {
+        if (ins->reg == 4 || ins->reg == 5)
+            return CC_IMUL;
+        return ins->reg >= 6 ? CC_DIV : CC_ALU;
+    }
+    if (ins->map == 1 && (ins->op == 0xD2 || ins->op == 0xD3)) // Group 2
+        return CC_SHIFT_CL;
+    if (ins->map == 1
+        && (ins->op == 0xC0 || ins->op == 0xC1 || ins->op == 0xD0
+            || ins->op == 0xD1))
+        return CC_SHIFT;
+
+    return table[ins->op] ? table[ins->op] : def;
+}
+
+int ins_operand_reg(const struct asm_ins *ins, int idx)
+{
+    if (!ins->op_desc || idx >= ins->op_desc->operand_count || idx >= 3)
+        return -1;
+
+    switch (ins->op_desc->operand_types[idx])
+    {
+    case OT_REG:
+    case OT_REG8:
+    case OT_REG16:
+    case OT_REG32:
+    case OT_REG64:
+    case OT_REGZ:
+        if (!ins->has_modrm)
+            return (ins->op & 7) | ((ins->rex & 0x1) ? 8 : 0);
+        return ins->reg;
+    case OT_RM:
+    case OT_RM8:
+    case OT_RM16:
+    case OT_RM32:
+    case OT_RM64:
+    case OT_RMZ:
+        return ins->mod == 3 ? ins->rm : -1;
+    case OT_AL:
+    case OT_AX:
+    case OT_EAX:
+    case OT_RAX:
+        return 0;
+    case OT_CL:
+        return 1;
+    default:
+        return -1;
+    }
+}
+
+bool ins_mem_operand(const struct asm_ins *ins)
+{
+    return ins->has_modrm && ins->mod != 3;
+}
+
+uint32_t ins_mem_regs(const struct asm_ins *ins)
+{
+    uint32_t regs = 0;
+
+    if (!ins_mem_operand(ins) || ins_rip_relative(ins))
+        return 0;
+    if (!ins->has_sib)
+        return 1u << ins->rm;
+
+    if (!(ins->mod == 0 && (ins->base & 7) == 5))
+        regs |= 1u << ins->base;
+    if (ins->index != 4) // REX.X extended index 12 (r12) is valid
+        regs |= 1u << ins->index;
+    return regs;
+}
+
+int format_ins(char *buf, size_t cap, const struct asm_ins *ins)
+{
+    if (!ins->op_desc || !ins->op_desc->mnemonic || !ins->op_desc->mnemonic[0])
+        return snprintf(buf, cap, "db 0x%02X", ins->op);
+
+    int len = snprintf(buf, cap, "%s", ins->op_desc->mnemonic);
+    if (ins->op_desc->operand_count == 0 || len < 0 || (size_t)len + 1 >= cap)
+        return len;
+
+    buf[len++] = ' ';
+    return len + (int)format_operands(buf + len, cap - len, ins);
+}
+
+void print_asm_ins(FILE *out, const uint8_t *addr, size_t len,
+                   const struct asm_ins *ins, uint64_t rip)
+{
+    print_asm_ins_label(out, addr, len, ins, rip, NULL);
+}
+
+void print_asm_ins_label(FILE *out, const uint8_t *addr, size_t len,
+                         const struct asm_ins *ins, uint64_t rip,
+                         const char *label)
 {
     // bytes column (8 bytes max)
-    printf("RIP: 0x%016" PRIx64 "\t", rip);
-    printf("%-16s", "");
+    fprintf(out, "RIP: 0x%016" PRIx64 "\t", rip);
+    fprintf(out, "%-16s", "");
     for (size_t i = 0; i < len && i < 8; i++)
-        printf("%02X ", addr[i]);
+        fprintf(out, "%02X ", addr[i]);
     for (size_t i = len; i < 8 && i < 8; i++)
-        printf("   ");
+        fputs("   ", out);
 
     // Mnemonic
     if (!ins->op_desc || !ins->op_desc->mnemonic || !ins->op_desc->mnemonic[0])
     {
-        printf("db 0x%02X\n", ins->op);
+        fprintf(out, "db 0x%02X\n", ins->op);
         return;
     }
-    printf(ANSI_COLOR_RED "%s", ins->op_desc->mnemonic);
-    printf(ANSI_COLOR_RESET "");
+    fprintf(out, ANSI_COLOR_RED "%s", ins->op_desc->mnemonic);
+    fputs(ANSI_COLOR_RESET "", out);
 
     // Operands
-    if (ins->op_desc->operand_count == 0)
+    if (ins->op_desc->operand_count != 0)
     {
-        putchar('\n');
-        return;
+        char ops[INS_BUFSIZE];
+        format_operands(ops, INS_BUFSIZE, ins);
+        fprintf(out, " %s", ops);
     }
-    putchar(' ');
-    for (int i = 0; i < ins->op_desc->operand_count; i++)
-    {
-        if (i)
-            printf(", ");
-        print_operand_generic(ins, ins->op_desc->operand_types[i], i);
-    }
-    putchar('\n');
+    if (label)
+        fprintf(out, " %s", label);
+    putc('\n', out);
 }
 
 /* Syntax
@@ -656,29 +864,41 @@ static void print_asm_ins(const uint8_t *addr, size_t len,
  */
 void disas(const uint8_t *ptr, size_t size, uint64_t start_rip)
 {
-    puts("Test parsing of bytes");
+    fdisas(stdout, ptr, size, start_rip);
+}
 
-    const uint8_t *p = ptr;
-    const uint8_t *end = ptr + size;
-    uint64_t rip = start_rip; // Track virtual address of instruction
-    struct asm_ins ins;
+void fdisas(FILE *out, const uint8_t *ptr, size_t size, uint64_t start_rip)
+{
+    struct disas_hooks none = { NULL, NULL, NULL, NULL };
+    fdisas_notes(out, ptr, size, start_rip, &none);
+}
 
-    while (p < end)
-    {
-        size_t n = decode64(p, (size_t)(end - p), &ins);
-        if (!n)
-        {
-            puts("Decoding error");
-            break;
-        }
+void fdisas_notes(FILE *out, const uint8_t *ptr, size_t size,
+                  uint64_t start_rip, const struct disas_hooks *hooks)
+{
+    fputs("Test parsing of bytes\n", out);
 
-        printf("Bytes parsed:");
-        for (size_t i = 0; i < n; i++)
-            printf(" 0x%02X", p[i]);
-        putchar('\n');
+    struct disas_iter it;
+    struct asm_ins ins;
+    int ret;
 
-        print_asm_ins(p, n, &ins, rip);
-        p += n;
-        rip += n;
+    disas_iter_init(&it, ptr, size, start_rip);
+    while ((ret = disas_next(&it, &ins)) > 0)
+    {
+        fputs("Bytes parsed:", out);
+        for (size_t i = 0; i < it.ins_len; i++)
+            fprintf(out, " 0x%02X", it.ins_bytes[i]);
+        putc('\n', out);
+
+        char label[INS_BUFSIZE];
+        uint64_t target = ins_target(&ins, it.ins_rip, it.ins_len);
+        int named = hooks->label && target
+            && hooks->label(label, sizeof(label), target, hooks->label_data);
+        print_asm_ins_label(out, it.ins_bytes, it.ins_len, &ins, it.ins_rip,
+                            named ? label : NULL);
+        if (hooks->note)
+            hooks->note(out, it.ins_rip, it.ins_len, hooks->note_data);
     }
+    if (ret < 0)
+        fputs("Decoding error\n", out);
 }
@@ -0,0 +1,364 @@
+#include "include/fprint.h"
+#include "include/disas.h"
+#include "include/hash.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+struct fp_match
+{
+    uint32_t query; // Function index in the queried binary
+    uint32_t rec; // Record index in the fingerprint index
+    uint32_t same; // Equal MinHash values (out of FP_K)
+};
+
+struct band_entry // Query side LSH bucket entry
+{
+    uint64_t key;
+    uint32_t query;
+    uint32_t next; // Chained entries for the same slot, UINT32_MAX ends
+};
+
+int fp_sign(const uint8_t *bytes, size_t size, uint16_t sig[FP_K],
+            uint32_t *n_ins)
+{
+    const uint8_t *p = bytes;
+    const uint8_t *end = bytes + size;
+    uint32_t mins[FP_K];
+    uint64_t win[FP_SHINGLE];
+    size_t n = 0;
+    struct asm_ins ins;
+
+    memset(mins, 0xFF, sizeof(mins));
+    while (p < end)
+    {
+        size_t len = decode64(p, (size_t)(end - p), &ins);
+        if (!len)
+            break;
+        p += len;
+
+        win[n++ % FP_SHINGLE] = ins_hash(&ins);
+        if (n < FP_SHINGLE)
+            continue;
+
+        // Shingle of the last FP_SHINGLE instructions, in order
+        uint64_t g = HASH_SEED;
+        for (size_t i = n - FP_SHINGLE; i < n; i++)
+            g = hash_mix64(g ^ win[i % FP_SHINGLE]);
+
+        // FP_K hash functions from two (Kirsch-Mitzenmacher)
+        uint64_t h1 = hash_mix64(g);
+        uint64_t h2 = hash_mix64(g ^ HASH_SEED) | 1;
+        for (size_t k = 0; k < FP_K; k++)
+        {
+            uint32_t v = (uint32_t)((h1 + k * h2) >> 32);
+            if (v < mins[k])
+                mins[k] = v;
+        }
+    }
+
+    *n_ins = (uint32_t)n;
+    if (n < FP_SHINGLE + FP_MIN_FEATURES - 1)
+        return -1;
+
+    for (size_t k = 0; k < FP_K; k++)
+        sig[k] = (uint16_t)mins[k];
+    return 0;
+}
+
+static int grow(void **buf, size_t *cap, size_t need, size_t elem)
+{
+    if (need <= *cap)
+        return 0;
+
+    size_t n = *cap ? *cap : 64;
+    while (n < need)
+        n *= 2;
+    void *tmp = realloc(*buf, n * elem);
+    if (!tmp)
+        return -1;
+    *buf = tmp;
+    *cap = n;
+    return 0;
+}
+
+static int add_str(char **strtab, size_t *size, size_t *cap, const char *s,
+                   uint32_t *off)
+{
+    size_t len = strlen(s) + 1;
+    if (grow((void **)strtab, cap, *size + len, 1))
+        return -1;
+
+    memcpy(*strtab + *size, s, len);
+    *off = (uint32_t)*size;
+    *size += len;
+    return 0;
+}
+
+int fp_write_index(const char *path, char **bins, int n_bins)
+{
+    struct fp_rec *recs = NULL;
+    uint32_t *files = NULL;
+    char *strtab = NULL;
+    size_t n_recs = 0;
+    size_t rec_cap = 0;
+    size_t str_size = 0;
+    size_t str_cap = 0;
+    int ret = -1;
+
+    if (!(files = malloc(n_bins * sizeof(*files))))
+        return -1;
+
+    for (int b = 0; b < n_bins; b++)
+    {
+        if (add_str(&strtab, &str_size, &str_cap, bins[b], &files[b]))
+            goto out;
+
+        struct elf_bin *bin = elf_load(bins[b]);
+        if (!bin)
+        {
+            // Skip unreadable files, keep their id stable
+            fprintf(stderr, "[-] %s: %s\n", bins[b], elf_strerror(errno));
+            continue;
+        }
+
+        for (size_t i = 0; i < bin->syms.count; i++)
+        {
+            const struct sym_info *s = &bin->syms.items[i];
+            struct fp_rec rec = { .file_id = (uint32_t)b,
+                                  .size = (uint32_t)s->size };
+
+            if (fp_sign(s->bytes, s->size, rec.sig, &rec.n_ins))
+                continue;
+            if (grow((void **)&recs, &rec_cap, n_recs + 1, sizeof(*recs))
+                || add_str(&strtab, &str_size, &str_cap, s->name,
+                           &rec.name_off))
+            {
+                elf_free(&bin);
+                goto out;
+            }
+            recs[n_recs++] = rec;
+        }
+        elf_free(&bin);
+    }
+
+    FILE *fp = fopen(path, "wb");
+    if (!fp)
+    {
+        perror("Cannot open fingerprint index for writing");
+        goto out;
+    }
+
+    struct fp_hdr hdr = { .version = FP_VERSION,
+                          .k = FP_K,
+                          .n_files = (uint32_t)n_bins,
+                          .n_recs = n_recs,
+                          .str_size = str_size };
+    memcpy(hdr.magic, FP_MAGIC, sizeof(hdr.magic));
+
+    if (fwrite(&hdr, sizeof(hdr), 1, fp) == 1
+        && fwrite(recs, sizeof(*recs), n_recs, fp) == n_recs
+        && fwrite(files, sizeof(*files), n_bins, fp) == (size_t)n_bins
+        && fwrite(strtab, 1, str_size, fp) == str_size)
+        ret = 0;
+    if (fclose(fp) || ret)
+    {
+        perror("Cannot write fingerprint index");
+        ret = -1;
+    }
+    else
+        printf("[+] %zu functions from %d binaries indexed in %s\n", n_recs,
+               n_bins, path);
+
+out:
+    free(recs);
+    free(files);
+    free(strtab);
+    return ret;
+}
+
+static uint64_t band_key(const uint16_t sig[FP_K], size_t band)
+{
+    uint64_t key = 0;
+    memcpy(&key, &sig[band * FP_ROWS], FP_ROWS * sizeof(*sig));
+    return hash_mix64(key ^ (band + 1) * HASH_SEED);
+}
+
+// Header counts are untrusted: check them with integer math, before any
+// pointer is derived from them
+static int index_valid(const void *map, size_t map_size)
+{
+    const struct fp_hdr *hdr = map;
+    size_t left = map_size - sizeof(*hdr);
+
+    if (memcmp(hdr->magic, FP_MAGIC, 4) || hdr->version != FP_VERSION
+        || hdr->k != FP_K || hdr->n_recs > UINT32_MAX
+        || hdr->n_recs > left / sizeof(struct fp_rec))
+        return 0;
+    left -= hdr->n_recs * sizeof(struct fp_rec);
+    if (hdr->n_files > left / sizeof(uint32_t))
+        return 0;
+    left -= hdr->n_files * sizeof(uint32_t);
+
+    // Every string ends before the table does
+    const uint32_t *files = (const uint32_t *)((const struct fp_rec *)(hdr + 1)
+                                               + hdr->n_recs);
+    const char *strtab = (const char *)(files + hdr->n_files);
+    if (hdr->str_size != left || (left && strtab[left - 1]))
+        return 0;
+    for (uint32_t f = 0; f < hdr->n_files; f++)
+        if (files[f] >= left)
+            return 0;
+    return 1;
+}
+
+static int cmp_match(const void *a, const void *b)
+{
+    const struct fp_match *x = a;
+    const struct fp_match *y = b;
+    if (x->query != y->query)
+        return x->query < y->query ? -1 : 1;
+    return (x->same < y->same) - (x->same > y->same);
+}
+
+int fp_query(FILE *out, const char *path, const struct elf_bin *bin,
+             double min_sim)
+{
+    const struct sym_list *lst = &bin->syms;
+    uint16_t(*sigs)[FP_K] = malloc((lst->count + 1) * sizeof(*sigs));
+    uint32_t *stamp = malloc((lst->count + 1) * sizeof(*stamp));
+    struct band_entry *ents =
+        malloc((lst->count * FP_BANDS + 1) * sizeof(*ents));
+    size_t n_slots = 64;
+    uint32_t *slots = NULL;
+    struct fp_match *matches = NULL;
+    size_t n_matches = 0;
+    size_t match_cap = 0;
+    void *map = MAP_FAILED;
+    size_t map_size = 0;
+    int ret = -1;
+
+    if (!sigs || !stamp || !ents)
+        goto out;
+
+    // Query side: sign every function and bucket its bands
+    while (n_slots < 2 * lst->count * FP_BANDS)
+        n_slots *= 2;
+    if (!(slots = malloc(n_slots * sizeof(*slots))))
+        goto out;
+    memset(slots, 0xFF, n_slots * sizeof(*slots));
+    memset(stamp, 0xFF, (lst->count + 1) * sizeof(*stamp));
+
+    uint32_t n_ents = 0;
+    for (size_t i = 0; i < lst->count; i++)
+    {
+        uint32_t n_ins;
+        if (fp_sign(lst->items[i].bytes, lst->items[i].size, sigs[i], &n_ins))
+            continue;
+        for (size_t b = 0; b < FP_BANDS; b++)
+        {
+            uint64_t key = band_key(sigs[i], b);
+            size_t slot = key & (n_slots - 1);
+            ents[n_ents] = (struct band_entry){ key, (uint32_t)i, slots[slot] };
+            slots[slot] = n_ents++;
+        }
+    }
+
+    // Index side: one sequential pass over the mapped records
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    if (fd == -1 || fstat(fd, &st) == -1)
+    {
+        perror("Cannot open fingerprint index");
+        if (fd != -1)
+            close(fd);
+        goto out;
+    }
+    map_size = (size_t)st.st_size;
+    if (map_size >= sizeof(struct fp_hdr))
+        map = mmap(NULL, map_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+    {
+        fprintf(stderr, "[-] Cannot map fingerprint index %s\n", path);
+        goto out;
+    }
+
+    if (!index_valid(map, map_size))
+    {
+        fprintf(stderr, "[-] %s is not a valid fingerprint index\n", path);
+        goto out;
+    }
+    const struct fp_hdr *hdr = map;
+    const struct fp_rec *recs = (const struct fp_rec *)(hdr + 1);
+    const uint32_t *files = (const uint32_t *)(recs + hdr->n_recs);
+    const char *strtab = (const char *)(files + hdr->n_files);
+
+    size_t n_bad = 0;
+    for (uint32_t r = 0; r < hdr->n_recs; r++)
+    {
+        if (recs[r].file_id >= hdr->n_files
+            || recs[r].name_off >= hdr->str_size)
+        {
+            n_bad++;
+            continue;
+        }
+        for (size_t b = 0; b < FP_BANDS; b++)
+        {
+            uint64_t key = band_key(recs[r].sig, b);
+            for (uint32_t e = slots[key & (n_slots - 1)]; e != UINT32_MAX;
+                 e = ents[e].next)
+            {
+                uint32_t q = ents[e].query;
+                if (ents[e].key != key || stamp[q] == r)
+                    continue;
+                stamp[q] = r; // Candidate pair checked once
+
+                uint32_t same = 0;
+                for (size_t k = 0; k < FP_K; k++)
+                    same += sigs[q][k] == recs[r].sig[k];
+                if ((double)same / FP_K < min_sim)
+                    continue;
+                if (grow((void **)&matches, &match_cap, n_matches + 1,
+                         sizeof(*matches)))
+                    goto out;
+                matches[n_matches++] = (struct fp_match){ q, r, same };
+            }
+        }
+    }
+
+    qsort(matches, n_matches, sizeof(*matches), cmp_match);
+    for (size_t i = 0; i < n_matches; i++)
+    {
+        const struct fp_match *m = &matches[i];
+        const struct fp_rec *rec = &recs[m->rec];
+        if (!i || matches[i - 1].query != m->query)
+            fprintf(out, "%s (%zu bytes):\n", lst->items[m->query].name,
+                    lst->items[m->query].size);
+        fprintf(out, "\t%5.1f%%  %s:%s (%" PRIu32 " bytes)\n",
+                100.0 * m->same / FP_K, strtab + files[rec->file_id],
+                strtab + rec->name_off, rec->size);
+    }
+    fprintf(out, "%zu near-duplicate pairs (similarity >= %.0f%%)\n",
+            n_matches, 100.0 * min_sim);
+    if (n_bad)
+        fprintf(stderr, "[-] %s: %zu records out of range, skipped\n", path,
+                n_bad);
+    ret = 0;
+
+out:
+    if (map != MAP_FAILED)
+        munmap(map, map_size);
+    free(sigs);
+    free(stamp);
+    free(ents);
+    free(slots);
+    free(matches);
+    return ret;
+}
@@ -0,0 +1,79 @@
+#include "include/hash.h"
+#include "include/disas.h"
+
+#include <string.h>
+
+// splitmix64 finalizer
+uint64_t hash_mix64(uint64_t x)
+{
+    x ^= x >> 30;
+    x *= 0xBF58476D1CE4E5B9ULL;
+    x ^= x >> 27;
+    x *= 0x94D049BB133111EBULL;
+    x ^= x >> 31;
+    return x;
+}
+
+uint64_t hash_bytes(const void *buf, size_t len, uint64_t seed)
+{
+    const uint8_t *p = buf;
+    uint64_t h = seed ^ (len * HASH_SEED);
+
+    // 8 bytes at a time, tail is zero padded
+    for (; len >= 8; p += 8, len -= 8)
+    {
+        uint64_t w;
+        memcpy(&w, p, 8);
+        h = hash_mix64(h ^ w);
+    }
+    if (len)
+    {
+        uint64_t w = 0;
+        memcpy(&w, p, len);
+        h = hash_mix64(h ^ w);
+    }
+
+    return h;
+}
+
+uint64_t ins_hash(const struct asm_ins *ins)
+{
+    /*
+     * Encoding identity: map, opcode, prefixes, REX.W and ModR/M / SIB
+     * (which carry the operand kinds and registers)
+     */
+    uint64_t key = (uint64_t)ins->map | (uint64_t)ins->op << 8
+        | (uint64_t)ins->modrm << 16 | (uint64_t)ins->sib << 24
+        | (uint64_t)ins->rex_w << 32 | (uint64_t)ins->has_66 << 33
+        | (uint64_t)ins->has_67 << 34 | (uint64_t)ins->lock << 35
+        | (uint64_t)ins->rep << 36 | (uint64_t)ins->repne << 37
+        | (uint64_t)ins->disp_size << 40 | (uint64_t)ins->imm_size << 48;
+
+    uint64_t h = hash_mix64(key);
+    if (ins->disp_size && !ins_rip_relative(ins))
+        h = hash_mix64(h ^ (uint64_t)ins->disp);
+    if (ins->imm_size && !ins_has_rel(ins))
+        h = hash_mix64(h ^ ins->imm);
+
+    return h;
+}
+
+uint64_t func_hash(const uint8_t *bytes, size_t size)
+{
+    const uint8_t *p = bytes;
+    const uint8_t *end = bytes + size;
+    uint64_t h = HASH_SEED;
+    struct asm_ins ins;
+
+    while (p < end)
+    {
+        size_t n = decode64(p, (size_t)(end - p), &ins);
+        if (!n) // Undecodable tail: fall back to the raw bytes
+            return hash_bytes(p, (size_t)(end - p), h);
+
+        h = hash_mix64(h ^ ins_hash(&ins));
+        p += n;
+    }
+
+    return h;
+}
@@ -0,0 +1,17 @@
+#ifndef ADDR2SYM_H
+#define ADDR2SYM_H
+
+#include "parse_elf.h"
+
+#include <stdio.h>
+
+#define A2S_READ_CHUNK (1 << 20)
+#define A2S_BAD (UINT32_MAX - 1) // Line without an address (SYM_NONE - 1)
+
+/*
+ * Reads one hex address per line from in and writes "addr symbol+0xoff"
+ * (or "addr ??") per line, in input order.
+ */
+int addr2sym(FILE *out, FILE *in, const struct elf_bin *bin);
+
+#endif /* !ADDR2SYM_H */
@@ -0,0 +1,34 @@
+#ifndef ALIGN_H
+#define ALIGN_H
+
+#include "parse_elf.h"
+
+#include <stdint.h>
+#include <stdio.h>
+
+#define ALIGN_WANT 16 // Entries / loop heads below this are reported
+#define ALIGN_MAX 64 // Cache line, largest alignment worth reporting
+#define JCC_BOUNDARY 32 // Skylake JCC erratum window
+
+struct align_report // Accumulated over every function of one pass
+{
+    size_t n_funcs;
+    size_t n_entries[4]; // Entries aligned on 16/32/64 bytes and below 16
+    size_t n_heads;
+    size_t heads_low; // Loop heads below ALIGN_WANT
+    size_t n_branches;
+    size_t jcc_hits; // Branches crossing / ending on a 32-byte boundary
+    size_t fused_hits; // Of which macro-fused cmp/test+jcc pairs
+
+    uint64_t *heads; // Loop head scratch, reused across functions
+    uint64_t *tmp;
+    size_t cap;
+};
+
+void align_init(struct align_report *r);
+int align_func(FILE *out, struct align_report *r,
+               const struct sym_info *s); // -1 on OOM
+void align_summary(FILE *out, const struct align_report *r);
+void align_free(struct align_report *r);
+
+#endif /* !ALIGN_H */
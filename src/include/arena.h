@@ -0,0 +1,30 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+#define ARENA_CHUNK_SIZE (64 * 1024)
+#define ARENA_ALIGN 16
+
+struct arena_chunk
+{
+    struct arena_chunk *next;
+    size_t size;
+    size_t used;
+    size_t pad; // Keeps data ARENA_ALIGN aligned
+    unsigned char data[];
+};
+
+struct arena // Bump allocator, everything is released at once
+{
+    struct arena_chunk *head;
+    size_t chunk_size;
+};
+
+void arena_init(struct arena *a, size_t chunk_size);
+void *arena_alloc(struct arena *a, size_t size); // NULL on OOM
+void *arena_calloc(struct arena *a, size_t n, size_t size);
+void arena_reset(struct arena *a); // Keep the newest chunk for reuse
+void arena_free(struct arena *a);
+
+#endif /* !ARENA_H */
@@ -0,0 +1,26 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "io.h"
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#define BATCH_CHUNK_BYTES (256 * 1024) // Code bytes per function task
+#define BATCH_MAX_THREADS 256
+
+struct batch_opts
+{
+    const char *out_dir; // One .txt per input, NULL: combined stdout stream
+    size_t n_threads; // 0: online CPUs
+    enum io_backend io; // IO_URING: io_prefetch() thread ahead of mmap loads
+};
+
+/*
+ * Disassemble every ELF found in paths (files or directory trees) on a
+ * work-stealing thread pool. Returns the number of files that failed.
+ */
+int batch_run(const struct batch_opts *opts, char **paths, size_t n_paths);
+
+#endif /* !BATCH_H */
@@ -0,0 +1,54 @@
+#ifndef CALLGRAPH_H
+#define CALLGRAPH_H
+
+#include "parse_elf.h"
+
+#include <stdint.h>
+#include <stdio.h>
+
+#define CG_MAGIC "GDCG"
+#define CG_VERSION 1
+
+/*
+ * Call graph in compressed sparse row form, node ids are sym_list indexes.
+ * Callees of n: dst[off[n] .. off[n + 1]), callers: src[roff[n] .. roff[n + 1])
+ */
+struct callgraph
+{
+    size_t n_nodes;
+    size_t n_edges; // Distinct caller -> callee pairs
+    size_t n_sites; // Resolved call instructions
+    size_t n_unresolved; // Calls through registers or outside .text funcs
+    uint32_t *off;
+    uint32_t *dst; // Sorted per row
+    uint32_t *cnt; // Call sites per edge
+    uint32_t *roff;
+    uint32_t *src; // Sorted per row
+};
+
+/*
+ * Binary file layout (native endianness):
+ * [cg_hdr][off * (n_nodes + 1)][dst * n_edges][cnt * n_edges]
+ * [name offsets * n_nodes][strtab]
+ */
+struct cg_hdr
+{
+    char magic[4];
+    uint32_t version;
+    uint64_t n_nodes;
+    uint64_t n_edges;
+    uint64_t str_size;
+};
+
+int cg_build(struct callgraph *cg, const struct elf_bin *bin);
+void cg_free(struct callgraph *cg);
+void cg_print_dot(FILE *out, const struct callgraph *cg,
+                  const struct sym_list *lst);
+int cg_write(const char *path, const struct callgraph *cg,
+             const struct sym_list *lst);
+void cg_print_callees(FILE *out, const struct callgraph *cg,
+                      const struct sym_list *lst, uint32_t id);
+void cg_print_callers(FILE *out, const struct callgraph *cg,
+                      const struct sym_list *lst, uint32_t id);
+
+#endif /* !CALLGRAPH_H */
@@ -0,0 +1,73 @@
+#ifndef CFG_H
+#define CFG_H
+
+#include "arena.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#define CFG_NONE UINT32_MAX
+
+enum cfg_edge_kind
+{
+    EDGE_FALLTHROUGH,
+    EDGE_TAKEN, // jcc taken or jmp
+};
+
+struct cfg_ins // Decoded instruction, offsets relative to the function
+{
+    uint32_t off;
+    uint32_t target; // Internal rel branch target offset or CFG_NONE
+    uint8_t len;
+    uint8_t flow; // enum ins_flow
+};
+
+struct cfg_edge
+{
+    uint32_t from;
+    uint32_t to;
+    uint8_t kind; // enum cfg_edge_kind
+};
+
+struct cfg_block
+{
+    uint64_t start; // Virtual address of first instruction
+    uint64_t end; // Past the last instruction
+    uint32_t first_ins; // Index in cfg->ins
+    uint32_t n_ins;
+    uint32_t first_succ; // Out edges: cfg->edges[first_succ ..+ n_succ]
+    uint32_t n_succ;
+    uint32_t first_pred; // In edges: cfg->preds[first_pred ..+ n_pred]
+    uint32_t n_pred;
+    bool exits; // Leaves the function (ret, tail jump, indirect jmp...)
+};
+
+struct cfg // Basic blocks of one function, all memory owned by an arena
+{
+    uint64_t addr;
+    const uint8_t *bytes;
+    size_t size;
+    struct cfg_ins *ins;
+    uint32_t n_ins;
+    struct cfg_block *blocks; // Sorted by address, entry block is 0
+    uint32_t n_blocks;
+    struct cfg_edge *edges; // Grouped by source block
+    uint32_t n_edges;
+    uint32_t *preds; // Edge indexes grouped by destination block
+    bool truncated; // Decoding stopped before the end of the function
+};
+
+// Appends text to the label line of a block when printing
+typedef void (*cfg_note_fn)(FILE *out, const struct cfg *cfg, uint32_t block,
+                            void *data);
+
+struct cfg *cfg_build(struct arena *a, const uint8_t *bytes, size_t size,
+                      uint64_t addr); // NULL on OOM
+uint32_t cfg_block_at(const struct cfg *cfg,
+                      uint64_t addr); // Block starting at addr or CFG_NONE
+void cfg_print(FILE *out, const struct cfg *cfg);
+void cfg_print_notes(FILE *out, const struct cfg *cfg, cfg_note_fn note,
+                     void *data);
+
+#endif /* !CFG_H */
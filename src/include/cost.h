@@ -0,0 +1,63 @@
+#ifndef COST_H
+#define COST_H
+
+#include "cfg.h"
+#include "loops.h"
+
+#include <stdint.h>
+#include <stdio.h>
+
+#define COST_MAX_PORTS 12
+#define COST_NREGS 16
+#define COST_CLASSES 29 // CC_COUNT of opcodes.h
+#define COST_DEFAULT_UARCH "skl"
+
+struct op_cost // Cost of one instruction of a class
+{
+    uint8_t lat; // Result latency in cycles
+    uint8_t uops;
+    uint8_t occ; // Cycles a port stays busy per uop (non pipelined units)
+    uint16_t ports; // Bitmask of ports able to execute the uops
+};
+
+struct uarch // Microarchitecture model, selectable at runtime by name
+{
+    const char *name;
+    const char *desc;
+    uint8_t width; // uops issued per cycle
+    uint8_t n_ports;
+    const char *const *port_names;
+    uint8_t load_lat; // Added to the latency of memory source operands
+    uint16_t load_ports;
+    uint16_t sta_ports; // Store address
+    uint16_t std_ports; // Store data
+    struct op_cost cost[COST_CLASSES];
+};
+
+struct block_cost // Steady state estimate of a straight instruction sequence
+{
+    uint32_t n_ins;
+    uint32_t uops;
+    double port_load[COST_MAX_PORTS];
+    uint32_t ready[COST_NREGS]; // Dependency chain state per GPR
+    uint32_t latency; // Longest register dependency chain
+    double issue; // uops / width
+    double port; // Busiest port
+    int busiest; // Index of the busiest port
+    double cycles; // Estimated cycles per iteration
+};
+
+const struct uarch *uarch_find(const char *name); // NULL if unknown
+void uarch_list(FILE *out);
+
+void cost_init(struct block_cost *bc);
+void cost_add(const struct uarch *u, struct block_cost *bc, const uint8_t *p,
+              size_t size); // Accumulate the instructions of [p, p + size)
+void cost_finish(const struct uarch *u, struct block_cost *bc);
+
+void cost_note(FILE *out, const struct cfg *cfg, uint32_t block,
+               void *uarch); // cfg_note_fn: per block estimate
+void cost_print_loops(FILE *out, const struct uarch *u, const struct cfg *cfg,
+                      const struct loop_info *li); // Whole body estimates
+
+#endif /* !COST_H */
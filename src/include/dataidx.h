@@ -0,0 +1,38 @@
+#ifndef DATAIDX_H
+#define DATAIDX_H
+
+#include "parse_elf.h"
+
+#include <stdint.h>
+
+#define DATAIDX_PREVIEW 32 // String preview characters before "..."
+
+struct data_index // Address intervals of symbols and sections, sorted
+{
+    uint64_t *start; // Symbols (struct of arrays)
+    uint64_t *end; // start + size (at least 1 byte)
+    const char **name; // In the file
+    size_t n;
+    uint64_t *sec_start; // SHF_ALLOC sections
+    uint64_t *sec_end;
+    const char **sec_name;
+    const uint8_t **sec_str; // Contents of .rodata* and SHF_STRINGS ones
+    size_t n_sec;
+};
+
+/*
+ * Built once from the symbol table and section headers, then read only:
+ * lookups are two binary searches, safe to share between threads.
+ */
+int dataidx_build(struct data_index *idx, const struct elf_bin *bin);
+void dataidx_free(struct data_index *idx);
+
+/*
+ * Write "<symbol+0xoff>" (or "<.section+0xoff>" outside any symbol) for
+ * addr into buf, followed by a quoted preview when addr starts a string
+ * of a read only data section. Returns 0 when nothing contains addr.
+ */
+int dataidx_label(const struct data_index *idx, uint64_t addr, char *buf,
+                  size_t cap);
+
+#endif /* !DATAIDX_H */
@@ -0,0 +1,36 @@
+#ifndef DIFF_H
+#define DIFF_H
+
+#include "parse_elf.h"
+
+#include <stdio.h>
+
+#define DIFF_COL 40 // Width of an instruction column in side by side output
+#define DIFF_LCS_MAX (1u << 22) // Max DP cells before plain index alignment
+
+struct fn_ref // Function + its position-independent hash
+{
+    const struct sym_info *sym;
+    uint64_t hash;
+};
+
+struct fn_hashes // Every function of a build, sorted by name
+{
+    struct fn_ref *ref;
+    size_t n;
+};
+
+// Report added/removed/changed functions between two builds, changed ones
+// are disassembled side by side. Returns 0 on success, -1 on failure
+int bin_diff(FILE *out, const struct elf_bin *old_bin,
+             const struct elf_bin *new_bin);
+int sym_diff(FILE *out, const struct sym_list *old_syms,
+             const struct sym_list *new_syms); // bin_diff without header
+
+// Hash once, diff many times: a build kept around is not hashed again
+int fn_hashes_build(struct fn_hashes *h, const struct sym_list *lst);
+void fn_hashes_free(struct fn_hashes *h);
+int hashed_diff(FILE *out, const struct fn_hashes *old_fns,
+                const struct fn_hashes *new_fns); // sym_diff on hashes
+
+#endif /* !DIFF_H */
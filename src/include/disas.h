@@ -1,11 +1,116 @@
 #ifndef DISAS_H
 #define DISAS_H
 
+#include <stdbool.h>
 #include <stddef.h>
+#include <stdio.h>
 #include <inttypes.h>
 
 #define OP_BUFSIZE 64
+#define INS_BUFSIZE 160 // Mnemonic + up to 3 formatted operands
 
+struct opcode_info;
+
+enum ins_flow // Control flow class of an instruction
+{
+    FLOW_NONE = 0, // Falls through
+    FLOW_CALL, // call rel32
+    FLOW_ICALL, // call r/m64
+    FLOW_JMP, // jmp rel8/rel32
+    FLOW_IJMP, // jmp r/m64
+    FLOW_JCC, // jcc, loop*, jrcxz
+    FLOW_RET, // ret, iret
+    FLOW_STOP, // hlt, ud2, int3: no successor
+};
+
+struct asm_ins
+{
+    // Prefixes / mode
+    bool has_66, has_67;
+    bool lock, rep, repne;
+    uint8_t rex; // 0100WRXB, byte extension
+    uint8_t rex_w, rex_r, rex_x, rex_b;
+    int op_size; // 16/32/64 (Z-width)
+    int addr_size;
+
+    // Opcode bytes
+    uint8_t map; // 1, 0x0F, 0x38, 0x3A
+    uint8_t op; // opcode byte in that map
+
+    const struct opcode_info *op_desc; // Custom opcode descriptor
+
+    // ModR/M / SIB
+    bool has_modrm, has_sib;
+    uint8_t modrm; // Operands encoding
+    uint8_t mod; // 2 bits, displacement size
+    uint8_t reg; // 3 bits, either opcode extension of register reference
+    uint8_t rm; // 3-bits, direct or indirect register operand (extended by REX)
+
+    uint8_t sib; // Memory addressing
+    uint8_t scale, index, base; // Addr = base + (index * scale) + disp
+
+    // Displacement / immediates
+    int disp_size;
+    int imm_size; // Size if encoded operands in instruction
+    int64_t disp; // sign-extended disp8/disp32
+    uint64_t imm; // raw immediate value TODO: use this
+};
+
+struct disas_iter // Reentrant decode cursor, owned by the caller
+{
+    const uint8_t *p;
+    const uint8_t *end;
+    uint64_t rip;
+
+    // Last instruction returned by disas_next()
+    const uint8_t *ins_bytes;
+    uint64_t ins_rip;
+    size_t ins_len;
+};
+
+// Length of the decoded instruction, 0 on error
+size_t decode64(const uint8_t *p, size_t max, struct asm_ins *ins);
+void disas_iter_init(struct disas_iter *it, const uint8_t *code, size_t size,
+                     uint64_t rip);
+int disas_next(struct disas_iter *it,
+               struct asm_ins *ins); // 1 decoded, 0 at end, -1 on error
+bool ins_has_rel(const struct asm_ins *ins); // rel8/rel32 operand
+bool ins_rip_relative(const struct asm_ins *ins); // [rip+disp] operand
+enum ins_flow ins_flow(const struct asm_ins *ins);
+uint64_t ins_target(const struct asm_ins *ins, uint64_t rip,
+                    size_t len); // rel branch target or [rip+disp] address
+uint8_t ins_cost_class(const struct asm_ins *ins); // CC_* of opcodes.h
+int ins_operand_reg(const struct asm_ins *ins,
+                    int idx); // GPR id (0-15) of an operand or -1
+uint32_t ins_mem_regs(const struct asm_ins *ins); // Address regs bitmask
+bool ins_mem_operand(const struct asm_ins *ins); // Has a memory operand
+int format_ins(char *buf, size_t cap,
+               const struct asm_ins *ins); // "mnemonic op1, op2" (no color)
+void print_asm_ins(FILE *out, const uint8_t *addr, size_t len,
+                   const struct asm_ins *ins, uint64_t rip);
+void print_asm_ins_label(FILE *out, const uint8_t *addr, size_t len,
+                         const struct asm_ins *ins, uint64_t rip,
+                         const char *label); // " label" ends the line
 void disas(const uint8_t *ptr, size_t remaining, uint64_t start_rip);
+void fdisas(FILE *out, const uint8_t *ptr, size_t remaining,
+            uint64_t start_rip);
+
+// Printed after each instruction line, rips increase from call to call
+typedef void (*disas_note_fn)(FILE *out, uint64_t rip, size_t len,
+                              void *data);
+// Name a branch or [rip+disp] target into buf, 0 for none
+typedef int (*disas_label_fn)(char *buf, size_t cap, uint64_t target,
+                              void *data);
+
+struct disas_hooks // Any member may be NULL
+{
+    disas_note_fn note;
+    void *note_data;
+    disas_label_fn label;
+    void *label_data;
+};
+
+void fdisas_notes(FILE *out, const uint8_t *ptr, size_t remaining,
+                  uint64_t start_rip, const struct disas_hooks *hooks);
 
 #endif /* !DISAS_H */
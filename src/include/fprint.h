@@ -0,0 +1,48 @@
+#ifndef FPRINT_H
+#define FPRINT_H
+
+#include "parse_elf.h"
+
+#include <stdint.h>
+#include <stdio.h>
+
+#define FP_MAGIC "GDFP"
+#define FP_VERSION 1
+#define FP_K 32 // MinHash values per function
+#define FP_BANDS 8 // LSH bands (FP_K / FP_BANDS rows each)
+#define FP_ROWS (FP_K / FP_BANDS)
+#define FP_SHINGLE 3 // Consecutive normalized instructions per feature
+#define FP_MIN_FEATURES 4 // Smaller functions are too generic to index
+#define FP_MIN_SIM 0.8
+
+/*
+ * Index file layout (native endianness):
+ * [fp_hdr][fp_rec * n_recs][uint32_t file name offsets * n_files][strtab]
+ */
+struct fp_hdr
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t k;
+    uint32_t n_files;
+    uint64_t n_recs;
+    uint64_t str_size;
+};
+
+struct fp_rec // One fingerprinted function
+{
+    uint16_t sig[FP_K]; // b-bit (16) MinHash signature
+    uint32_t file_id;
+    uint32_t name_off; // Offset in strtab
+    uint32_t n_ins;
+    uint32_t size;
+};
+
+// Fingerprint a function, returns -1 if it has too few features to index
+int fp_sign(const uint8_t *bytes, size_t size, uint16_t sig[FP_K],
+            uint32_t *n_ins);
+int fp_write_index(const char *path, char **bins, int n_bins);
+int fp_query(FILE *out, const char *path, const struct elf_bin *bin,
+             double min_sim);
+
+#endif /* !FPRINT_H */
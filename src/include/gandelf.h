@@ -0,0 +1,32 @@
+#ifndef GANDELF_H
+#define GANDELF_H
+
+/*
+ * Public interface of libgandelf (bin/libgandelf.a, bin/libgandelf.so).
+ * No global state: every call works on caller owned structures, so
+ * separate threads may use separate objects freely.
+ *
+ *   struct elf_bin *bin = elf_load(path);
+ *   Elf64_Shdr *sh = elf_section(bin, ".text");
+ *   uint32_t id = symidx_find(&bin->syms, "main");
+ *   struct disas_iter it;
+ *   struct asm_ins ins;
+ *   disas_iter_init(&it, bin->syms.items[id].bytes, bin->syms.items[id].size,
+ *                   bin->syms.items[id].addr);
+ *   while (disas_next(&it, &ins) > 0)
+ *       ...; // it.ins_rip, it.ins_len, format_ins(buf, sizeof(buf), &ins)
+ *   elf_free(&bin);
+ */
+
+#include "parse_elf.h" // ELF loading, sections, .text functions
+#include "disas.h" // Decoder and decode iterator
+#include "symidx.h" // Symbol queries by name and address
+#include "hash.h" // Position independent function hashes
+#include "callgraph.h"
+#include "cfg.h"
+#include "loops.h"
+#include "plt.h" // Imported names of PLT stubs and GOT slots
+#include "dataidx.h" // Symbol / section containing an address
+#include "strscan.h" // Printable runs of a buffer
+
+#endif /* !GANDELF_H */
@@ -0,0 +1,19 @@
+#ifndef HASH_H
+#define HASH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct asm_ins;
+
+#define HASH_SEED 0x9E3779B97F4A7C15ULL
+
+uint64_t hash_mix64(uint64_t x); // Bijective 64-bit finalizer
+uint64_t hash_bytes(const void *buf, size_t len, uint64_t seed);
+
+// Position-independent instruction hash: rel targets and RIP displacements
+// are left out so that relinking/moving code does not change the value
+uint64_t ins_hash(const struct asm_ins *ins);
+uint64_t func_hash(const uint8_t *bytes, size_t size);
+
+#endif /* !HASH_H */
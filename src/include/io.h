@@ -0,0 +1,64 @@
+#ifndef IO_H
+#define IO_H
+
+#include "utils.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define IO_CHUNK (1 << 20) // pread / io_uring request size
+#define IO_RING_DEPTH 64 // Reads in flight per ring
+#define IO_HDR 4096 // Prefetch: first read of each file
+#define IO_PREFETCH_FILES 16 // Prefetch: files open at once
+#define IO_PREFETCH_SEGS 8 // Prefetch: ranges per file (shdrs + PF_X)
+
+enum io_backend // How file_open() brings a file into memory
+{
+    IO_MMAP, // Plain mmap, pages faulted in on first touch
+    IO_MMAP_SEQ, // mmap + MADV_SEQUENTIAL | MADV_WILLNEED: whole file walks
+    IO_MMAP_RANDOM, // mmap + MADV_RANDOM: sparse lookups, no readahead
+    IO_POPULATE, // mmap + MAP_POPULATE: every page read before returning
+    IO_PREAD, // IO_CHUNK preads into a heap buffer
+    IO_URING, // IO_RING_DEPTH concurrent IO_CHUNK reads, IO_PREAD fallback
+    IO_SELECT, // PROT_NONE reservation, headers mapped, the rest on file_need
+    IO_BACKENDS
+};
+
+int io_backend_parse(const char *name, enum io_backend *out); // -1 if unknown
+const char *io_backend_names(void); // "mmap|mmap-seq|..." for usage
+
+// NULL with errno set (ENOEXEC: not an ELF, ENODATA: empty), never prints
+struct file *file_open(const char *filename, enum io_backend backend);
+struct file *file_open_raw(const char *filename,
+                           enum io_backend backend); // Any content, no select
+
+/*
+ * Make [off, off + len) of an IO_SELECT file readable at content + off
+ * (page aligned MAP_FIXED sub-mapping). No-op for every other backend.
+ * Not thread safe on one file.
+ */
+int file_need(struct file *f, uint64_t off, uint64_t len);
+long io_peak_rss_kb(void); // getrusage() ru_maxrss
+
+/*
+ * Minimal io_uring over the raw syscalls (no liburing). NULL from
+ * io_ring_new() when the kernel or a seccomp filter refuses io_uring.
+ */
+struct io_ring;
+struct io_ring *io_ring_new(unsigned depth);
+int io_ring_full(const struct io_ring *r);
+unsigned io_ring_inflight(const struct io_ring *r);
+int io_ring_read(struct io_ring *r, int fd, void *buf, uint32_t len,
+                 uint64_t off, uint64_t tag); // Queued until io_ring_wait
+int io_ring_wait(struct io_ring *r, uint64_t *tag,
+                 int32_t *res); // Submit queued, one completion
+void io_ring_free(struct io_ring *r);
+
+/*
+ * Warm the page cache with the section headers and executable segments of
+ * each ELF in paths, in order, many files at once over io_uring
+ * (posix_fadvise(WILLNEED) without it). Returns the number of files read.
+ */
+size_t io_prefetch(char *const *paths, size_t n);
+
+#endif /* !IO_H */
@@ -0,0 +1,21 @@
+#ifndef LAYOUT_H
+#define LAYOUT_H
+
+#include "callgraph.h"
+#include "profile.h"
+
+#include <stdint.h>
+#include <stdio.h>
+
+#define LAYOUT_PAGE ((uint64_t)4096)
+#define LAYOUT_HUGE_PAGE ((uint64_t)2 << 20)
+#define LAYOUT_HOT_FRAC 0.99 // Hot set: hottest functions covering this
+#define LAYOUT_MERGE_MAX LAYOUT_PAGE // C3 stops growing a cluster past this
+#define LAYOUT_FUNC_ALIGN 16 // Function padding assumed for the new order
+#define LAYOUT_TOP 16 // Rows of the hottest function / page tables
+
+int layout_report(FILE *out, const struct profile *prof,
+                  const struct sym_list *lst, const struct sym_index *idx,
+                  const struct callgraph *cg,
+                  const char *order_path); // order_path may be NULL
+#endif /* !LAYOUT_H */
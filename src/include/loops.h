@@ -0,0 +1,41 @@
+#ifndef LOOPS_H
+#define LOOPS_H
+
+#include "arena.h"
+#include "cfg.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+struct loop // Natural loop (all back edges to the same header merged)
+{
+    uint32_t header; // Block id
+    uint32_t parent; // Enclosing loop or CFG_NONE
+    uint32_t depth; // 1 for outermost loops
+    uint32_t n_back_edges;
+    uint32_t n_blocks;
+    uint32_t *blocks; // Body block ids
+    uint32_t n_ins;
+    uint64_t n_bytes;
+};
+
+struct loop_info
+{
+    uint32_t *idom; // Immediate dominator, CFG_NONE for entry / unreachable
+    uint32_t *pre; // Dominator tree preorder number
+    uint32_t *post; // Dominator tree last preorder number in subtree
+    struct loop *loops; // Sorted by header address
+    uint32_t n_loops;
+    uint32_t *loop_of; // Innermost loop of each block or CFG_NONE
+};
+
+struct loop_info *loops_build(struct arena *a,
+                              const struct cfg *cfg); // NULL on OOM
+bool dominates(const struct loop_info *li, uint32_t a, uint32_t b);
+void loops_print(FILE *out, const struct cfg *cfg,
+                 const struct loop_info *li); // Loop nest report
+void loops_note(FILE *out, const struct cfg *cfg, uint32_t block,
+                void *li); // cfg_note_fn: loop membership of a block
+
+#endif /* !LOOPS_H */
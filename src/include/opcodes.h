@@ -18,6 +18,7 @@
 #define OT_IMM32 5
 #define OT_IMM64 6
 #define OT_IMMZ 23
+#define OT_CL 24
 #define OT_REL8 7
 #define OT_REL32 8
 #define OT_AL 9
@@ -187,7 +188,7 @@ static const struct opcode_info modrm_prim_map[256] = {
     [0x8A] = { R, 0, "mov", 2, { OT_REG8, OT_RM8, OT_NONE }, 0 },
     [0x8B] = { R, 0, "mov", 2, { OT_REGZ, OT_RMZ, OT_NONE }, 0 },
     [0x8C] = { R, 0, "mov", 1, { OT_RM16, OT_NONE, OT_NONE }, 0 },
-    [0x8D] = { R, 0, "lea", 1, { OT_REGZ, OT_NONE, OT_NONE }, 0 },
+    [0x8D] = { R, 0, "lea", 2, { OT_REGZ, OT_RMZ, OT_NONE }, 0 },
     [0x8E] = { R, 0, "mov", 2, { OT_NONE, OT_RM16, OT_NONE }, 0 },
     [0x8F] = { D, 0, "pop", 1, { OT_RM64, OT_NONE, OT_NONE }, 0 },
     [0x90] = { N, 0, "pause", 0, { OT_NONE, OT_NONE, OT_NONE }, 0 },
@@ -238,8 +239,8 @@ static const struct opcode_info modrm_prim_map[256] = {
     [0xBD] = { N, 0, "", 0, { OT_NONE, OT_NONE, OT_NONE }, 0 },
     [0xBE] = { N, 0, "", 0, { OT_NONE, OT_NONE, OT_NONE }, 0 },
     [0xBF] = { N, 0, "", 0, { OT_NONE, OT_NONE, OT_NONE }, 0 },
-    [0xC0] = { N, 0, "", 0, { OT_NONE, OT_NONE, OT_NONE }, 0 },
-    [0xC1] = { N, 0, "", 0, { OT_NONE, OT_NONE, OT_NONE }, 0 },
+    [0xC0] = { D, 0, "", 0, { OT_NONE, OT_NONE, OT_NONE }, 0 },
+    [0xC1] = { D, 0, "", 0, { OT_NONE, OT_NONE, OT_NONE }, 0 },
     [0xC2] = { N, 0, "retn", 1, { OT_IMM16, OT_NONE, OT_NONE }, 2 },
     [0xC3] = { N, 0, "retn", 0, { OT_NONE, OT_NONE, OT_NONE }, 0 },
     [0xC4] = { N, 0, "", 0, { OT_NONE, OT_NONE, OT_NONE }, 0 },
@@ -254,10 +255,10 @@ static const struct opcode_info modrm_prim_map[256] = {
     [0xCD] = { N, 0, "int", 1, { OT_IMM8, OT_NONE, OT_NONE }, 1 },
     [0xCE] = { N, 0, "into", 0, { OT_NONE, OT_NONE, OT_NONE }, 0 },
     [0xCF] = { N, 0, "iret", 0, { OT_NONE, OT_NONE, OT_NONE }, 0 },
-    [0xD0] = { N, 0, "", 0, { OT_NONE, OT_NONE, OT_NONE }, 0 },
-    [0xD1] = { N, 0, "", 0, { OT_NONE, OT_NONE, OT_NONE }, 0 },
-    [0xD2] = { N, 0, "", 0, { OT_NONE, OT_NONE, OT_NONE }, 0 },
-    [0xD3] = { N, 0, "", 0, { OT_NONE, OT_NONE, OT_NONE }, 0 },
+    [0xD0] = { D, 0, "", 0, { OT_NONE, OT_NONE, OT_NONE }, 0 },
+    [0xD1] = { D, 0, "", 0, { OT_NONE, OT_NONE, OT_NONE }, 0 },
+    [0xD2] = { D, 0, "", 0, { OT_NONE, OT_NONE, OT_NONE }, 0 },
+    [0xD3] = { D, 0, "", 0, { OT_NONE, OT_NONE, OT_NONE }, 0 },
     [0xD4] = { N, 0, "", 0, { OT_NONE, OT_NONE, OT_NONE }, 0 },
     [0xD5] = { N, 0, "", 0, { OT_NONE, OT_NONE, OT_NONE }, 0 },
     [0xD6] = { N, 0, "", 0, { OT_NONE, OT_NONE, OT_NONE }, 0 },
@@ -292,8 +293,8 @@ static const struct opcode_info modrm_prim_map[256] = {
     [0xF3] = { N, 0, "", 0, { OT_NONE, OT_NONE, OT_NONE }, 0 },
     [0xF4] = { N, 0, "hlt", 0, { OT_NONE, OT_NONE, OT_NONE }, 0 },
     [0xF5] = { N, 0, "cmc", 0, { OT_NONE, OT_NONE, OT_NONE }, 0 },
-    [0xF6] = { N, 0, "", 0, { OT_NONE, OT_NONE, OT_NONE }, 0 },
-    [0xF7] = { N, 0, "", 0, { OT_NONE, OT_NONE, OT_NONE }, 0 },
+    [0xF6] = { D, 0, "", 0, { OT_NONE, OT_NONE, OT_NONE }, 0 },
+    [0xF7] = { D, 0, "", 0, { OT_NONE, OT_NONE, OT_NONE }, 0 },
     [0xF8] = { N, 0, "clc", 0, { OT_NONE, OT_NONE, OT_NONE }, 0 },
     [0xF9] = { N, 0, "stc", 0, { OT_NONE, OT_NONE, OT_NONE }, 0 },
     [0xFA] = { N, 0, "cli", 0, { OT_NONE, OT_NONE, OT_NONE }, 0 },
@@ -1081,4 +1082,241 @@ static const struct opcode_info modrm_0f3a_map[256] = {
     /* 0xFF */ { N, 0, "", 0, { OT_NONE, OT_NONE, OT_NONE }, 0 },
 };
 
+// Groups: the prim map has D with an empty mnemonic, ModR/M.reg picks the row
+static const struct opcode_info group2_map[6][8] = { // C0 C1 D0 D1 D2 D3
+    {
+        { D, 0, "rol", 2, { OT_RM8, OT_IMM8, OT_NONE }, 1 },
+        { D, 1, "ror", 2, { OT_RM8, OT_IMM8, OT_NONE }, 1 },
+        { D, 2, "rcl", 2, { OT_RM8, OT_IMM8, OT_NONE }, 1 },
+        { D, 3, "rcr", 2, { OT_RM8, OT_IMM8, OT_NONE }, 1 },
+        { D, 4, "shl", 2, { OT_RM8, OT_IMM8, OT_NONE }, 1 },
+        { D, 5, "shr", 2, { OT_RM8, OT_IMM8, OT_NONE }, 1 },
+        { D, 6, "sal", 2, { OT_RM8, OT_IMM8, OT_NONE }, 1 },
+        { D, 7, "sar", 2, { OT_RM8, OT_IMM8, OT_NONE }, 1 },
+    },
+    {
+        { D, 0, "rol", 2, { OT_RMZ, OT_IMM8, OT_NONE }, 1 },
+        { D, 1, "ror", 2, { OT_RMZ, OT_IMM8, OT_NONE }, 1 },
+        { D, 2, "rcl", 2, { OT_RMZ, OT_IMM8, OT_NONE }, 1 },
+        { D, 3, "rcr", 2, { OT_RMZ, OT_IMM8, OT_NONE }, 1 },
+        { D, 4, "shl", 2, { OT_RMZ, OT_IMM8, OT_NONE }, 1 },
+        { D, 5, "shr", 2, { OT_RMZ, OT_IMM8, OT_NONE }, 1 },
+        { D, 6, "sal", 2, { OT_RMZ, OT_IMM8, OT_NONE }, 1 },
+        { D, 7, "sar", 2, { OT_RMZ, OT_IMM8, OT_NONE }, 1 },
+    },
+    {
+        { D, 0, "rol", 1, { OT_RM8, OT_NONE, OT_NONE }, 0 },
+        { D, 1, "ror", 1, { OT_RM8, OT_NONE, OT_NONE }, 0 },
+        { D, 2, "rcl", 1, { OT_RM8, OT_NONE, OT_NONE }, 0 },
+        { D, 3, "rcr", 1, { OT_RM8, OT_NONE, OT_NONE }, 0 },
+        { D, 4, "shl", 1, { OT_RM8, OT_NONE, OT_NONE }, 0 },
+        { D, 5, "shr", 1, { OT_RM8, OT_NONE, OT_NONE }, 0 },
+        { D, 6, "sal", 1, { OT_RM8, OT_NONE, OT_NONE }, 0 },
+        { D, 7, "sar", 1, { OT_RM8, OT_NONE, OT_NONE }, 0 },
+    },
+    {
+        { D, 0, "rol", 1, { OT_RMZ, OT_NONE, OT_NONE }, 0 },
+        { D, 1, "ror", 1, { OT_RMZ, OT_NONE, OT_NONE }, 0 },
+        { D, 2, "rcl", 1, { OT_RMZ, OT_NONE, OT_NONE }, 0 },
+        { D, 3, "rcr", 1, { OT_RMZ, OT_NONE, OT_NONE }, 0 },
+        { D, 4, "shl", 1, { OT_RMZ, OT_NONE, OT_NONE }, 0 },
+        { D, 5, "shr", 1, { OT_RMZ, OT_NONE, OT_NONE }, 0 },
+        { D, 6, "sal", 1, { OT_RMZ, OT_NONE, OT_NONE }, 0 },
+        { D, 7, "sar", 1, { OT_RMZ, OT_NONE, OT_NONE }, 0 },
+    },
+    {
+        { D, 0, "rol", 2, { OT_RM8, OT_CL, OT_NONE }, 0 },
+        { D, 1, "ror", 2, { OT_RM8, OT_CL, OT_NONE }, 0 },
+        { D, 2, "rcl", 2, { OT_RM8, OT_CL, OT_NONE }, 0 },
+        { D, 3, "rcr", 2, { OT_RM8, OT_CL, OT_NONE }, 0 },
+        { D, 4, "shl", 2, { OT_RM8, OT_CL, OT_NONE }, 0 },
+        { D, 5, "shr", 2, { OT_RM8, OT_CL, OT_NONE }, 0 },
+        { D, 6, "sal", 2, { OT_RM8, OT_CL, OT_NONE }, 0 },
+        { D, 7, "sar", 2, { OT_RM8, OT_CL, OT_NONE }, 0 },
+    },
+    {
+        { D, 0, "rol", 2, { OT_RMZ, OT_CL, OT_NONE }, 0 },
+        { D, 1, "ror", 2, { OT_RMZ, OT_CL, OT_NONE }, 0 },
+        { D, 2, "rcl", 2, { OT_RMZ, OT_CL, OT_NONE }, 0 },
+        { D, 3, "rcr", 2, { OT_RMZ, OT_CL, OT_NONE }, 0 },
+        { D, 4, "shl", 2, { OT_RMZ, OT_CL, OT_NONE }, 0 },
+        { D, 5, "shr", 2, { OT_RMZ, OT_CL, OT_NONE }, 0 },
+        { D, 6, "sal", 2, { OT_RMZ, OT_CL, OT_NONE }, 0 },
+        { D, 7, "sar", 2, { OT_RMZ, OT_CL, OT_NONE }, 0 },
+    },
+};
+
+static const struct opcode_info group3_map[2][8] = { // F6 F7
+    {
+        { D, 0, "test", 2, { OT_RM8, OT_IMM8, OT_NONE }, 1 },
+        { D, 1, "test", 2, { OT_RM8, OT_IMM8, OT_NONE }, 1 },
+        { D, 2, "not", 1, { OT_RM8, OT_NONE, OT_NONE }, 0 },
+        { D, 3, "neg", 1, { OT_RM8, OT_NONE, OT_NONE }, 0 },
+        { D, 4, "mul", 1, { OT_RM8, OT_NONE, OT_NONE }, 0 },
+        { D, 5, "imul", 1, { OT_RM8, OT_NONE, OT_NONE }, 0 },
+        { D, 6, "div", 1, { OT_RM8, OT_NONE, OT_NONE }, 0 },
+        { D, 7, "idiv", 1, { OT_RM8, OT_NONE, OT_NONE }, 0 },
+    },
+    {
+        { D, 0, "test", 2, { OT_RMZ, OT_IMM32, OT_NONE }, 4 },
+        { D, 1, "test", 2, { OT_RMZ, OT_IMM32, OT_NONE }, 4 },
+        { D, 2, "not", 1, { OT_RMZ, OT_NONE, OT_NONE }, 0 },
+        { D, 3, "neg", 1, { OT_RMZ, OT_NONE, OT_NONE }, 0 },
+        { D, 4, "mul", 1, { OT_RMZ, OT_NONE, OT_NONE }, 0 },
+        { D, 5, "imul", 1, { OT_RMZ, OT_NONE, OT_NONE }, 0 },
+        { D, 6, "div", 1, { OT_RMZ, OT_NONE, OT_NONE }, 0 },
+        { D, 7, "idiv", 1, { OT_RMZ, OT_NONE, OT_NONE }, 0 },
+    },
+};
+
+// Cost classes (latency/throughput/ports come from the per-uarch tables)
+#define CC_DEFAULT 0 // Map default: CC_ALU (1-byte map) or CC_VEC_ALU
+#define CC_ALU 1
+#define CC_MOV 2
+#define CC_LEA 3
+#define CC_SHIFT 4 // By an immediate or by 1
+#define CC_IMUL 5
+#define CC_DIV 6
+#define CC_BRANCH 7
+#define CC_CALL 8
+#define CC_RET 9
+#define CC_PUSH 10
+#define CC_POP 11
+#define CC_CMOV 12
+#define CC_XCHG 13
+#define CC_STRING 14
+#define CC_SYSTEM 15
+#define CC_NOP 16
+#define CC_X87 17
+#define CC_VEC_ALU 18
+#define CC_VEC_MOV 19
+#define CC_VEC_SHUF 20
+#define CC_VEC_MUL 21
+#define CC_FP_ADD 22
+#define CC_FP_MUL 23
+#define CC_FP_DIV 24
+#define CC_FP_CVT 25
+#define CC_SHIFT_CL 26 // Shift or rotate by cl
+#define CC_SHLD 27 // shld/shrd by an immediate
+#define CC_SHLD_CL 28
+#define CC_COUNT 29
+
+// Entries left out are CC_DEFAULT
+static const uint8_t cost_class_prim[256] = {
+    [0x50] = CC_PUSH,   [0x51] = CC_PUSH,   [0x52] = CC_PUSH,
+    [0x53] = CC_PUSH,   [0x54] = CC_PUSH,   [0x55] = CC_PUSH,
+    [0x56] = CC_PUSH,   [0x57] = CC_PUSH,   [0x58] = CC_POP,
+    [0x59] = CC_POP,    [0x5A] = CC_POP,    [0x5B] = CC_POP,
+    [0x5C] = CC_POP,    [0x5D] = CC_POP,    [0x5E] = CC_POP,
+    [0x5F] = CC_POP,    [0x63] = CC_MOV,    [0x68] = CC_PUSH,
+    [0x69] = CC_IMUL,   [0x6A] = CC_PUSH,   [0x6B] = CC_IMUL,
+    [0x6C] = CC_SYSTEM, [0x6D] = CC_SYSTEM, [0x6E] = CC_SYSTEM,
+    [0x6F] = CC_SYSTEM, [0x70] = CC_BRANCH, [0x71] = CC_BRANCH,
+    [0x72] = CC_BRANCH, [0x73] = CC_BRANCH, [0x74] = CC_BRANCH,
+    [0x75] = CC_BRANCH, [0x76] = CC_BRANCH, [0x77] = CC_BRANCH,
+    [0x78] = CC_BRANCH, [0x79] = CC_BRANCH, [0x7A] = CC_BRANCH,
+    [0x7B] = CC_BRANCH, [0x7C] = CC_BRANCH, [0x7D] = CC_BRANCH,
+    [0x7E] = CC_BRANCH, [0x7F] = CC_BRANCH, [0x86] = CC_XCHG,
+    [0x87] = CC_XCHG,   [0x88] = CC_MOV,    [0x89] = CC_MOV,
+    [0x8A] = CC_MOV,    [0x8B] = CC_MOV,    [0x8C] = CC_SYSTEM,
+    [0x8D] = CC_LEA,    [0x8E] = CC_SYSTEM, [0x8F] = CC_POP,
+    [0x90] = CC_NOP,    [0x9B] = CC_NOP,    [0x9C] = CC_SYSTEM,
+    [0x9D] = CC_SYSTEM, [0xA0] = CC_MOV,    [0xA1] = CC_MOV,
+    [0xA2] = CC_MOV,    [0xA3] = CC_MOV,    [0xA4] = CC_STRING,
+    [0xA5] = CC_STRING, [0xA6] = CC_STRING, [0xA7] = CC_STRING,
+    [0xAA] = CC_STRING, [0xAB] = CC_STRING, [0xAC] = CC_STRING,
+    [0xAD] = CC_STRING, [0xAE] = CC_STRING, [0xAF] = CC_STRING,
+    [0xC2] = CC_RET,    [0xC3] = CC_RET,    [0xC8] = CC_SYSTEM,
+    [0xC9] = CC_POP,    [0xCA] = CC_RET,    [0xCB] = CC_RET,
+    [0xCC] = CC_SYSTEM, [0xCD] = CC_SYSTEM, [0xCE] = CC_SYSTEM,
+    [0xCF] = CC_SYSTEM, [0xD7] = CC_MOV,    [0xD8] = CC_X87,
+    [0xD9] = CC_X87,    [0xDA] = CC_X87,    [0xDB] = CC_X87,
+    [0xDC] = CC_X87,    [0xDD] = CC_X87,    [0xDE] = CC_X87,
+    [0xDF] = CC_X87,    [0xE0] = CC_BRANCH, [0xE1] = CC_BRANCH,
+    [0xE2] = CC_BRANCH, [0xE3] = CC_BRANCH, [0xE4] = CC_SYSTEM,
+    [0xE5] = CC_SYSTEM, [0xE6] = CC_SYSTEM, [0xE7] = CC_SYSTEM,
+    [0xE8] = CC_CALL,   [0xE9] = CC_BRANCH, [0xEB] = CC_BRANCH,
+    [0xEC] = CC_SYSTEM, [0xED] = CC_SYSTEM, [0xEE] = CC_SYSTEM,
+    [0xEF] = CC_SYSTEM, [0xF1] = CC_SYSTEM, [0xF4] = CC_SYSTEM,
+    [0xFA] = CC_SYSTEM, [0xFB] = CC_SYSTEM, [0xFF] = CC_CALL,
+};
+
+static const uint8_t cost_class_0f[256] = {
+    [0x00] = CC_SYSTEM,   [0x01] = CC_SYSTEM,   [0x02] = CC_SYSTEM,
+    [0x03] = CC_SYSTEM,   [0x05] = CC_SYSTEM,   [0x06] = CC_SYSTEM,
+    [0x07] = CC_SYSTEM,   [0x08] = CC_SYSTEM,   [0x09] = CC_SYSTEM,
+    [0x0B] = CC_SYSTEM,   [0x0D] = CC_NOP,      [0x10] = CC_VEC_MOV,
+    [0x11] = CC_VEC_MOV,  [0x12] = CC_VEC_MOV,  [0x13] = CC_VEC_MOV,
+    [0x14] = CC_VEC_SHUF, [0x15] = CC_VEC_SHUF, [0x16] = CC_VEC_MOV,
+    [0x17] = CC_VEC_MOV,  [0x18] = CC_NOP,      [0x19] = CC_NOP,
+    [0x1A] = CC_NOP,      [0x1B] = CC_NOP,      [0x1C] = CC_NOP,
+    [0x1D] = CC_NOP,      [0x1E] = CC_NOP,      [0x1F] = CC_NOP,
+    [0x20] = CC_SYSTEM,   [0x21] = CC_SYSTEM,   [0x22] = CC_SYSTEM,
+    [0x23] = CC_SYSTEM,   [0x28] = CC_VEC_MOV,  [0x29] = CC_VEC_MOV,
+    [0x2A] = CC_FP_CVT,   [0x2B] = CC_VEC_MOV,  [0x2C] = CC_FP_CVT,
+    [0x2D] = CC_FP_CVT,   [0x2E] = CC_FP_ADD,   [0x2F] = CC_FP_ADD,
+    [0x30] = CC_SYSTEM,   [0x31] = CC_SYSTEM,   [0x32] = CC_SYSTEM,
+    [0x33] = CC_SYSTEM,   [0x34] = CC_SYSTEM,   [0x35] = CC_SYSTEM,
+    [0x37] = CC_SYSTEM,   [0x40] = CC_CMOV,     [0x41] = CC_CMOV,
+    [0x42] = CC_CMOV,     [0x43] = CC_CMOV,     [0x44] = CC_CMOV,
+    [0x45] = CC_CMOV,     [0x46] = CC_CMOV,     [0x47] = CC_CMOV,
+    [0x48] = CC_CMOV,     [0x49] = CC_CMOV,     [0x4A] = CC_CMOV,
+    [0x4B] = CC_CMOV,     [0x4C] = CC_CMOV,     [0x4D] = CC_CMOV,
+    [0x4E] = CC_CMOV,     [0x4F] = CC_CMOV,     [0x50] = CC_VEC_MOV,
+    [0x51] = CC_FP_DIV,   [0x52] = CC_FP_MUL,   [0x53] = CC_FP_MUL,
+    [0x58] = CC_FP_ADD,   [0x59] = CC_FP_MUL,   [0x5A] = CC_FP_CVT,
+    [0x5B] = CC_FP_CVT,   [0x5C] = CC_FP_ADD,   [0x5D] = CC_FP_ADD,
+    [0x5E] = CC_FP_DIV,   [0x5F] = CC_FP_ADD,   [0x60] = CC_VEC_SHUF,
+    [0x61] = CC_VEC_SHUF, [0x62] = CC_VEC_SHUF, [0x63] = CC_VEC_SHUF,
+    [0x67] = CC_VEC_SHUF, [0x68] = CC_VEC_SHUF, [0x69] = CC_VEC_SHUF,
+    [0x6A] = CC_VEC_SHUF, [0x6B] = CC_VEC_SHUF, [0x6C] = CC_VEC_SHUF,
+    [0x6D] = CC_VEC_SHUF, [0x6E] = CC_VEC_MOV,  [0x6F] = CC_VEC_MOV,
+    [0x70] = CC_VEC_SHUF, [0x77] = CC_SYSTEM,   [0x78] = CC_SYSTEM,
+    [0x79] = CC_SYSTEM,   [0x7C] = CC_FP_ADD,   [0x7D] = CC_FP_ADD,
+    [0x7E] = CC_VEC_MOV,  [0x7F] = CC_VEC_MOV,  [0x80] = CC_BRANCH,
+    [0x81] = CC_BRANCH,   [0x82] = CC_BRANCH,   [0x83] = CC_BRANCH,
+    [0x84] = CC_BRANCH,   [0x85] = CC_BRANCH,   [0x86] = CC_BRANCH,
+    [0x87] = CC_BRANCH,   [0x88] = CC_BRANCH,   [0x89] = CC_BRANCH,
+    [0x8A] = CC_BRANCH,   [0x8B] = CC_BRANCH,   [0x8C] = CC_BRANCH,
+    [0x8D] = CC_BRANCH,   [0x8E] = CC_BRANCH,   [0x8F] = CC_BRANCH,
+    [0x90] = CC_ALU,      [0x91] = CC_ALU,      [0x92] = CC_ALU,
+    [0x93] = CC_ALU,      [0x94] = CC_ALU,      [0x95] = CC_ALU,
+    [0x96] = CC_ALU,      [0x97] = CC_ALU,      [0x98] = CC_ALU,
+    [0x99] = CC_ALU,      [0x9A] = CC_ALU,      [0x9B] = CC_ALU,
+    [0x9C] = CC_ALU,      [0x9D] = CC_ALU,      [0x9E] = CC_ALU,
+    [0x9F] = CC_ALU,      [0xA0] = CC_PUSH,     [0xA1] = CC_POP,
+    [0xA2] = CC_SYSTEM,   [0xA3] = CC_ALU,      [0xA4] = CC_SHLD,
+    [0xA5] = CC_SHLD_CL,  [0xA8] = CC_PUSH,     [0xA9] = CC_POP,
+    [0xAA] = CC_SYSTEM,   [0xAB] = CC_ALU,      [0xAC] = CC_SHLD,
+    [0xAD] = CC_SHLD_CL,  [0xAE] = CC_SYSTEM,   [0xAF] = CC_IMUL,
+    [0xB0] = CC_XCHG,     [0xB1] = CC_XCHG,     [0xB2] = CC_SYSTEM,
+    [0xB3] = CC_ALU,      [0xB4] = CC_SYSTEM,   [0xB5] = CC_SYSTEM,
+    [0xB6] = CC_MOV,      [0xB7] = CC_MOV,      [0xB8] = CC_IMUL,
+    [0xB9] = CC_SYSTEM,   [0xBA] = CC_ALU,      [0xBB] = CC_ALU,
+    [0xBC] = CC_IMUL,     [0xBD] = CC_IMUL,     [0xBE] = CC_MOV,
+    [0xBF] = CC_MOV,      [0xC0] = CC_XCHG,     [0xC1] = CC_XCHG,
+    [0xC2] = CC_FP_ADD,   [0xC3] = CC_VEC_MOV,  [0xC4] = CC_VEC_SHUF,
+    [0xC5] = CC_VEC_SHUF, [0xC6] = CC_VEC_SHUF, [0xC7] = CC_SYSTEM,
+    [0xC8] = CC_ALU,      [0xC9] = CC_ALU,      [0xCA] = CC_ALU,
+    [0xCB] = CC_ALU,      [0xCC] = CC_ALU,      [0xCD] = CC_ALU,
+    [0xCE] = CC_ALU,      [0xCF] = CC_ALU,      [0xD0] = CC_FP_ADD,
+    [0xD5] = CC_VEC_MUL,  [0xD6] = CC_VEC_MOV,  [0xD7] = CC_VEC_MOV,
+    [0xE4] = CC_VEC_MUL,  [0xE5] = CC_VEC_MUL,  [0xE6] = CC_FP_CVT,
+    [0xE7] = CC_VEC_MOV,  [0xF0] = CC_VEC_MOV,  [0xF4] = CC_VEC_MUL,
+    [0xF5] = CC_VEC_MUL,  [0xF6] = CC_VEC_MUL,  [0xF7] = CC_VEC_MOV,
+};
+
+static const uint8_t cost_class_0f38[256] = {
+    [0x00] = CC_VEC_SHUF, [0x80] = CC_SYSTEM, [0x81] = CC_SYSTEM,
+    [0xF0] = CC_IMUL,     [0xF1] = CC_IMUL,
+};
+
+static const uint8_t cost_class_0f3a[256] = {
+    [0x0F] = CC_VEC_SHUF, [0x14] = CC_VEC_MOV,  [0x15] = CC_VEC_MOV,
+    [0x16] = CC_VEC_MOV,  [0x17] = CC_VEC_MOV,  [0x20] = CC_VEC_SHUF,
+    [0x21] = CC_VEC_SHUF, [0x22] = CC_VEC_SHUF, [0x40] = CC_VEC_MUL,
+    [0x41] = CC_VEC_MUL,  [0x42] = CC_VEC_MUL,  [0x60] = CC_VEC_MUL,
+    [0x61] = CC_VEC_MUL,  [0x62] = CC_VEC_MUL,  [0x63] = CC_VEC_MUL,
+};
+
 #endif /* !OPCODES_H */
@@ -1,6 +1,7 @@
 #ifndef PARSE_ELF_H
 #define PARSE_ELF_H
 
+#include "io.h"
 #include "utils.h"
 
 #include <elf.h>
@@ -10,6 +11,7 @@ struct impsec // Important sections (.text, .strtab, .symtab)
     Elf64_Shdr *symtab;
     Elf64_Shdr *strtab;
     Elf64_Shdr *text;
+    Elf64_Shdr *versym; // .gnu.version, tells default versions of .dynsym
 };
 
 struct sec // Abstraction for a section
@@ -34,6 +36,16 @@ struct sym_list // List of symbols
     size_t count;
 };
 
+struct elf_bin // Mapped ELF with its .text functions
+{
+    struct file *f;
+    Elf64_Ehdr *ehdr;
+    Elf64_Shdr *shdrs;
+    struct impsec *impsec;
+    size_t text_index;
+    struct sym_list syms;
+};
+
 int is_elf(const struct file *f);
 Elf64_Ehdr *get_ehdr(void *buf);
 Elf64_Phdr *get_phdrs(void *buf, Elf64_Ehdr *hdr); // Pointer to first entry
@@ -46,4 +58,15 @@ struct sec *sec_resolve(struct file *f,
 struct sym_list get_text_funcs(
     void *buf, struct impsec *impsec, size_t text_index,
     size_t file_size); // Get the .text section's function type symbols
+struct elf_bin *elf_load(const char *path); // Map + resolve .text functions
+struct elf_bin *elf_load_io(const char *path,
+                            enum io_backend backend); // Same, chosen backend
+const char *elf_strerror(int err); // Why elf_load failed, from its errno
+void elf_free(struct elf_bin **bin);
+const char *elf_section_name(const struct elf_bin *bin,
+                             const Elf64_Shdr *shdr); // NULL if out of file
+Elf64_Shdr *elf_section(const struct elf_bin *bin,
+                        const char *name); // First section named name
+const void *elf_section_data(const struct elf_bin *bin,
+                             const Elf64_Shdr *shdr); // NULL if NOBITS/OOB
 #endif /* !PARSE_ELF_H */
@@ -0,0 +1,27 @@
+#ifndef PLT_H
+#define PLT_H
+
+#include "parse_elf.h"
+
+#include <stdint.h>
+
+struct plt_map // PLT stubs and GOT slots of imports, address sorted
+{
+    uint64_t *addr;
+    char **name; // "memcpy@plt" for a stub, "memcpy@got" for its slot
+    size_t n;
+};
+
+/*
+ * GOT slots come from the JUMP_SLOT / GLOB_DAT relocations against
+ * .dynsym, stubs from the jmp [rip+disp] of each .plt, .plt.sec and
+ * .plt.got entry. Read only once built: safe to share between threads.
+ */
+int plt_map_build(struct plt_map *m, const struct elf_bin *bin);
+void plt_map_free(struct plt_map *m);
+const char *plt_lookup(const struct plt_map *m,
+                       uint64_t addr); // Name at exactly addr or NULL
+int plt_label(char *buf, size_t cap, uint64_t target,
+              void *map); // disas_label_fn, "<memcpy@plt>"
+
+#endif /* !PLT_H */
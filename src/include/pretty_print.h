@@ -4,6 +4,7 @@
 #include "utils.h"
 #include "parse_elf.h"
 #include <elf.h>
+#include <stdio.h>
 
 #define ANSI_COLOR_RED "\x1b[31m"
 #define ANSI_COLOR_GREEN "\x1b[32m"
@@ -17,6 +18,7 @@ void print_Ehdr(Elf64_Ehdr *hdr);
 void print_Phdrs(void *buf, Elf64_Ehdr *ehdr);
 void print_Shdrs(void *buf, Elf64_Ehdr *ehdr);
 void hexdump(unsigned char *ptr, size_t size);
+void fhexdump(FILE *out, const unsigned char *ptr, size_t size);
 void print_text_funcs(const struct sym_list *lst);
 
 #endif /* !PRETTY_PRINT_H */
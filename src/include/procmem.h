@@ -0,0 +1,48 @@
+#ifndef PROCMEM_H
+#define PROCMEM_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/types.h>
+
+struct mem_region // Executable mapping of a process image
+{
+    uint64_t start;
+    uint64_t end;
+    uint64_t pgoff; // File offset mapped at start
+    char *path; // Backing file or [vdso] like name, NULL: anonymous (JIT)
+    uint8_t *bytes; // Contents as the process sees them
+    size_t len; // Readable prefix of bytes, may be < end - start
+    int from_disk; // Core had no copy, bytes come from path
+};
+
+struct mem_image
+{
+    struct mem_region *r;
+    size_t n;
+    size_t cap;
+};
+
+/*
+ * Executable mappings of a live process (/proc/pid/maps), each read with
+ * one process_vm_readv() call.
+ */
+int mem_from_pid(struct mem_image *img, pid_t pid);
+
+/*
+ * Executable PT_LOAD segments of an ELF core file, named through its
+ * NT_FILE note. File backed text the core left out is read from disk.
+ */
+int mem_from_core(struct mem_image *img, const char *core_path);
+
+void mem_image_free(struct mem_image *img);
+
+/*
+ * Disassemble every function of the on-disk modules, from the image bytes,
+ * flagging those that differ from the file. Regions without a module are
+ * disassembled whole. sym: only that function. Returns functions printed.
+ */
+size_t mem_disas(FILE *out, const struct mem_image *img, const char *sym);
+
+#endif /* !PROCMEM_H */
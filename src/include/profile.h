@@ -0,0 +1,32 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include "symidx.h"
+
+#include <stdint.h>
+#include <stdio.h>
+
+#define PROFILE_BIAS_TRIES 4096 // sym[+off] lines tried to find the load bias
+#define PROFILE_PAGE 4096 // Load bias alignment
+#define PROFILE_BIAS_VOTES 64 // Candidates per sample, big functions
+
+struct profile // Instruction pointer samples, sorted by file address
+{
+    uint64_t *ips;
+    size_t n;
+    size_t n_skipped; // Lines without a leading hex address
+    uint64_t bias; // Runtime minus file address (PIE load base)
+    int has_bias;
+};
+
+int profile_load(struct profile *prof, const char *path,
+                 const struct sym_list *lst); // -1 on error
+size_t profile_range(const struct profile *prof, uint64_t start,
+                     uint64_t end,
+                     size_t *first); // Samples in [start, end)
+void profile_print(FILE *out, const struct profile *prof,
+                   const struct sym_list *lst,
+                   const struct sym_index *idx); // Hottest function first
+void profile_free(struct profile *prof);
+
+#endif /* !PROFILE_H */
@@ -0,0 +1,25 @@
+#ifndef RAW_H
+#define RAW_H
+
+#include "io.h"
+
+#include <stdint.h>
+#include <stdio.h>
+
+struct raw_stats
+{
+    size_t bytes; // Code bytes, after hex decoding
+    size_t ins;
+    size_t bad; // Undecodable bytes, shown as one byte "(bad)" each
+};
+
+/*
+ * Disassemble a file that is not an ELF: raw bytes, or hex text when hex
+ * is set (digit pairs, anything else and 0x / \x prefixes skipped), the
+ * first byte at base. Decoding resumes one byte past an undecodable
+ * sequence instead of stopping there. Returns -1 if the file can't be read.
+ */
+int raw_disas(FILE *out, const char *path, uint64_t base, int hex,
+              enum io_backend io, struct raw_stats *st);
+
+#endif /* !RAW_H */
@@ -0,0 +1,38 @@
+#ifndef RELOC_H
+#define RELOC_H
+
+#include "parse_elf.h"
+
+#include <stdint.h>
+#include <stdio.h>
+
+struct reloc_index // RELA entries applying to one section (struct of arrays)
+{
+    uint64_t *off; // Sorted r_offset
+    uint32_t *type;
+    int64_t *addend;
+    const char **name; // Symbol, or section for STT_SECTION, in the file
+    size_t n;
+};
+
+struct reloc_cursor // Merge walk over an index, one per decoding thread
+{
+    const struct reloc_index *ri;
+    size_t i;
+};
+
+int reloc_index_build(struct reloc_index *ri, const struct elf_bin *bin,
+                      size_t sec); // Every SHT_RELA with sh_info == sec
+void reloc_index_free(struct reloc_index *ri);
+struct reloc_cursor reloc_seek(const struct reloc_index *ri,
+                               uint64_t off); // First entry >= off, O(log n)
+const char *reloc_type_name(uint32_t type); // NULL if not a known x86-64 one
+
+/*
+ * Print the relocations patching [rip, rip + len), objdump -r style, and
+ * move past them. Calls must come in increasing rip order. Matches
+ * disas_note_fn with the cursor as data.
+ */
+void reloc_note(FILE *out, uint64_t rip, size_t len, void *cursor);
+
+#endif /* !RELOC_H */
@@ -0,0 +1,31 @@
+#ifndef REPL_H
+#define REPL_H
+
+#include "symidx.h"
+
+#include <stdint.h>
+#include <stdio.h>
+
+#define REPL_LINE_MAX 1024
+#define REPL_PROMPT "gandelf> "
+#define REPL_AROUND_DEFAULT 8
+
+struct repl // One loaded binary and the indexes answering queries
+{
+    struct elf_bin *bin;
+    struct sym_index idx; // By address
+    struct name_index names; // By name
+    uint64_t *ins; // Sorted instruction starts of every function
+    size_t n_ins;
+    uint64_t *xref_to; // Sorted targets of rel branches / RIP operands
+    uint32_t *xref_id; // Index in xref_from, follows xref_to
+    uint64_t *xref_from; // Referencing instruction
+    size_t n_xref;
+};
+
+int repl_init(struct repl *r, struct elf_bin *bin); // -1 on OOM
+void repl_free(struct repl *r);
+int repl_exec(FILE *out, struct repl *r, char *line); // 1 on quit
+int repl_run(struct repl *r, FILE *in, FILE *out); // Loop until EOF / q
+
+#endif /* !REPL_H */
@@ -0,0 +1,50 @@
+#ifndef SERVE_H
+#define SERVE_H
+
+#include "symidx.h"
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#define SERVE_CACHE_SIZE 8 // Binaries kept mapped and indexed
+#define SERVE_LINE_MAX 4096 // Longest request line
+#define SERVE_BACKLOG 16
+#define SERVE_MAX_ARGS 4
+#define SERVE_MAX_CLIENTS 64 // Connections served at once
+
+/*
+ * Request: one line, space separated "command binary [args]".
+ *   syms  BIN                 -> "addr size name" per function
+ *   sym   BIN ADDR            -> "name+0xoff" or "??"
+ *   find  BIN NAME            -> "addr size"
+ *   dis   BIN NAME            -> "addr\tinstruction" per instruction
+ *   slice BIN ADDR LEN        -> same, for [ADDR, ADDR + LEN) of .text
+ *   stats                     -> cache hits / misses / entries
+ *   quit                      -> stops the server, only for its own uid
+ * Response: "OK <n>\n" followed by n payload bytes, or "ERR <message>\n".
+ */
+
+struct serve_bin // Cache slot
+{
+    char *path;
+    struct elf_bin *bin;
+    struct sym_index idx;
+    struct name_index names;
+    dev_t dev;
+    ino_t ino;
+    off_t size;
+    time_t mtime;
+    uint64_t last_used; // LRU clock value
+};
+
+struct serve_cache
+{
+    struct serve_bin slot[SERVE_CACHE_SIZE];
+    uint64_t clock;
+    size_t hits;
+    size_t misses;
+};
+
+int serve(const char *sock_path); // Runs until a quit request, -1 on error
+
+#endif /* !SERVE_H */
@@ -0,0 +1,26 @@
+#ifndef STREAM_H
+#define STREAM_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#define STREAM_WINDOW (64 * 1024) // Code bytes buffered at once
+#define STREAM_MAX_INS 15 // Longest x86 instruction, kept across refills
+
+struct stream_stats
+{
+    uint64_t bytes; // Whole input, drained to EOF
+    uint64_t code; // Executable bytes decoded
+    size_t segments;
+};
+
+/*
+ * Disassemble an ELF64 read once, front to back, from a non seekable
+ * stream: ELF header, program headers, then every PF_X PT_LOAD segment as
+ * it arrives through a STREAM_WINDOW buffer. Section headers usually come
+ * last, so segments are decoded without symbols. Returns -1 if the input
+ * is not an ELF64 or ends before its headers.
+ */
+int stream_disas(FILE *out, FILE *in, struct stream_stats *st);
+
+#endif /* !STREAM_H */
@@ -0,0 +1,45 @@
+#ifndef STRSCAN_H
+#define STRSCAN_H
+
+#include "dataidx.h"
+#include "parse_elf.h"
+
+#include <stdint.h>
+#include <stdio.h>
+
+#define STRSCAN_MIN_LEN 4 // Characters, like strings(1)
+
+struct str_hit // Run of printable ASCII, or of UTF-16LE units
+{
+    uint64_t addr;
+    uint32_t size; // Bytes
+    uint16_t sec; // Section header index
+    uint8_t wide;
+};
+
+struct str_list
+{
+    struct str_hit *items;
+    size_t n;
+    size_t cap;
+};
+
+/*
+ * Append the runs of at least min_len printable characters (space to '~',
+ * tab, newline) of [p, p + size), mapped at addr, to lst. UTF-16LE runs
+ * are found at even offsets from p. 16 bytes per step with SSE2.
+ */
+int str_scan(struct str_list *lst, const uint8_t *p, size_t size,
+             uint64_t addr, uint16_t sec, size_t min_len);
+void str_list_free(struct str_list *lst);
+
+/*
+ * Scan every allocated, non executable section with contents and print
+ * address, section and string in address order. With xrefs, list under
+ * each string the instructions of .text functions whose [rip+disp]
+ * operand points into it, named through names when not NULL.
+ */
+int strings_print(FILE *out, const struct elf_bin *bin, size_t min_len,
+                  int xrefs, const struct data_index *names);
+
+#endif /* !STRSCAN_H */
@@ -0,0 +1,42 @@
+#ifndef SYMIDX_H
+#define SYMIDX_H
+
+#include "parse_elf.h"
+
+#include <stdint.h>
+
+#define SYM_NONE UINT32_MAX
+
+struct sym_index // Address sorted view of a sym_list (struct of arrays)
+{
+    uint64_t *start; // Sorted function start addresses
+    uint64_t *end; // start + size (at least 1 byte)
+    uint32_t *id; // Index in the sym_list
+    size_t n;
+};
+
+struct name_key
+{
+    const char *name;
+    uint32_t id;
+};
+
+struct name_index // Name sorted view of a sym_list, for repeated lookups
+{
+    struct name_key *key; // Sorted by name, then id
+    size_t n;
+};
+
+int symidx_build(struct sym_index *idx, const struct sym_list *lst);
+void symidx_free(struct sym_index *idx);
+uint32_t symidx_lookup(const struct sym_index *idx,
+                       uint64_t addr); // Containing function or SYM_NONE
+uint32_t symidx_find(const struct sym_list *lst,
+                     const char *name); // By name or SYM_NONE
+
+int nameidx_build(struct name_index *ni, const struct sym_list *lst);
+void nameidx_free(struct name_index *ni);
+uint32_t nameidx_find(const struct name_index *ni,
+                      const char *name); // First id by name or SYM_NONE
+
+#endif /* !SYMIDX_H */
@@ -0,0 +1,31 @@
+#ifndef TRIAGE_H
+#define TRIAGE_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+#define TRIAGE_PAGE 4096 // First read, covers ehdr + phdrs of most files
+#define TRIAGE_MAX_SHSTR (1 << 20) // .shstrtab size cap
+#define TRIAGE_MAX_DYN (1 << 16) // Dynamic section bytes read for DT_FLAGS_1
+
+struct triage_stats
+{
+    size_t files; // Regular files looked at
+    size_t elfs;
+    size_t bad; // ELF magic but truncated / inconsistent headers
+    size_t wx; // ELFs with a writable and executable PT_LOAD
+    size_t no_nx;
+    size_t no_relro;
+};
+
+/*
+ * One line per ELF under paths (files or directory trees): class, machine,
+ * type, PIE, RELRO, NX, symtab, debug info, W+X segments. Only the ELF
+ * header, program headers, section headers and .shstrtab are read (pread),
+ * plus PT_DYNAMIC for DT_FLAGS_1, never section contents. Returns the
+ * number of malformed ELFs.
+ */
+int triage(FILE *out, char **paths, size_t n_paths,
+           struct triage_stats *stats);
+
+#endif /* !TRIAGE_H */
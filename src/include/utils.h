@@ -2,6 +2,7 @@
 #define FILE_MAP_H
 
 #include <stddef.h>
+#include <stdint.h>
 
 struct file
 {
@@ -9,12 +10,24 @@ struct file
     size_t size;
     char *name;
     void *content;
+    int mapped; // content is mmap()ed, else malloc()ed
+    struct io_maps *maps; // IO_SELECT: ranges mapped so far, else NULL
 };
 
-struct file *file_map(const char *filename);
+struct file *file_map(const char *filename); // file_open(filename, IO_MMAP)
 void file_unmap(struct file **file);
 char *xstrdup(const char *s);
 struct sym_list;
 void free_symlist(struct sym_list l);
+void radix_sort_u64(uint64_t *a, uint64_t *tmp, size_t n);
+void radix_sort_kv(uint64_t *key, uint32_t *val, uint64_t *ktmp,
+                   uint32_t *vtmp, size_t n); // Stable, val follows key
+typedef int (*walk_fn)(const char *path, void *data); // Non zero stops
+// Regular files under path: path itself may be a symlink, entries below not
+int walk_files(const char *path, walk_fn fn, void *data);
+size_t hex_decode(const char *in, size_t len,
+                  uint8_t *out); // Hex digit pairs, others and 0x skipped
+int parse_hex_u64(const char **p, const char *end,
+                  uint64_t *val); // [0x]hex bounded by end, -1 if none
 
 #endif
@@ -0,0 +1,23 @@
+#ifndef WATCH_H
+#define WATCH_H
+
+#include "diff.h"
+#include "parse_elf.h"
+
+#include <stdio.h>
+
+#define WATCH_EVENT_BUF 4096
+
+struct watch_snapshot // Owned copy of the functions of the last build
+{
+    struct sym_list syms; // Names and bytes point into blob / strings
+    unsigned char *blob;
+    struct fn_hashes fns; // Hashed once, when the build was loaded
+    size_t generation;
+};
+
+// Re-diff path against its previous build each time it is rewritten.
+// Runs until interrupted or max_builds rebuilds were seen (0: forever)
+int watch(FILE *out, const char *path, size_t max_builds);
+
+#endif /* !WATCH_H */
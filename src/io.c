@@ -0,0 +1,575 @@
+#define _DEFAULT_SOURCE // madvise, MAP_POPULATE, pread, posix_fadvise
+
+#include "include/io.h"
+#include "include/parse_elf.h"
+
+#include <elf.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+static const char *const backend_names[IO_BACKENDS] = {
+    "mmap", "mmap-seq", "mmap-random", "populate", "pread", "uring", "select",
+};
+
+struct io_maps // Page aligned file ranges mapped in an IO_SELECT reservation
+{
+    size_t n;
+    size_t cap;
+    struct
+    {
+        uint64_t start;
+        uint64_t end;
+    } r[];
+};
+
+int io_backend_parse(const char *name, enum io_backend *out)
+{
+    for (int i = 0; i < IO_BACKENDS; i++)
+        if (strcmp(name, backend_names[i]) == 0)
+        {
+            *out = i;
+            return 0;
+        }
+    return -1;
+}
+
+const char *io_backend_names(void)
+{
+    return "mmap|mmap-seq|mmap-random|populate|pread|uring|select";
+}
+
+struct io_ring
+{
+    int fd;
+    unsigned entries;
+    unsigned queued; // SQEs not yet passed to io_uring_enter
+    unsigned inflight; // Queued or submitted, not yet reaped
+    unsigned *sq_head;
+    unsigned *sq_tail;
+    unsigned *sq_mask;
+    unsigned *sq_array;
+    unsigned *cq_head;
+    unsigned *cq_tail;
+    unsigned *cq_mask;
+    struct io_uring_sqe *sqes;
+    struct io_uring_cqe *cqes;
+    void *sq_map;
+    void *cq_map;
+    size_t sq_len;
+    size_t cq_len;
+    size_t sqes_len;
+};
+
+struct io_ring *io_ring_new(unsigned depth)
+{
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    int fd = syscall(__NR_io_uring_setup, depth, &p);
+    if (fd < 0)
+        return NULL;
+
+    struct io_ring *r = calloc(1, sizeof(*r));
+    if (!r)
+    {
+        close(fd);
+        return NULL;
+    }
+    r->fd = fd;
+    r->entries = p.sq_entries;
+    r->sq_len = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    r->cq_len = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    int single = p.features & IORING_FEAT_SINGLE_MMAP;
+    if (single && r->cq_len > r->sq_len)
+        r->sq_len = r->cq_len;
+    r->sqes_len = p.sq_entries * sizeof(struct io_uring_sqe);
+
+    r->sq_map = mmap(NULL, r->sq_len, PROT_READ | PROT_WRITE, MAP_SHARED, fd,
+                     IORING_OFF_SQ_RING);
+    r->cq_map = single ? r->sq_map
+                       : mmap(NULL, r->cq_len, PROT_READ | PROT_WRITE,
+                              MAP_SHARED, fd, IORING_OFF_CQ_RING);
+    r->sqes = mmap(NULL, r->sqes_len, PROT_READ | PROT_WRITE, MAP_SHARED, fd,
+                   IORING_OFF_SQES);
+    if (r->sq_map == MAP_FAILED || r->cq_map == MAP_FAILED
+        || r->sqes == MAP_FAILED)
+    {
+        io_ring_free(r);
+        return NULL;
+    }
+
+    char *sq = r->sq_map;
+    char *cq = r->cq_map;
+    r->sq_head = (unsigned *)(sq + p.sq_off.head);
+    r->sq_tail = (unsigned *)(sq + p.sq_off.tail);
+    r->sq_mask = (unsigned *)(sq + p.sq_off.ring_mask);
+    r->sq_array = (unsigned *)(sq + p.sq_off.array);
+    r->cq_head = (unsigned *)(cq + p.cq_off.head);
+    r->cq_tail = (unsigned *)(cq + p.cq_off.tail);
+    r->cq_mask = (unsigned *)(cq + p.cq_off.ring_mask);
+    r->cqes = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+    return r;
+}
+
+// The CQ holds twice the SQ entries, so this bound keeps both from overflowing
+int io_ring_full(const struct io_ring *r)
+{
+    return r->inflight >= r->entries;
+}
+
+unsigned io_ring_inflight(const struct io_ring *r)
+{
+    return r->inflight;
+}
+
+int io_ring_read(struct io_ring *r, int fd, void *buf, uint32_t len,
+                 uint64_t off, uint64_t tag)
+{
+    if (io_ring_full(r))
+        return -1;
+    unsigned tail = *r->sq_tail; // Only we move the SQ tail
+    unsigned idx = tail & *r->sq_mask;
+    struct io_uring_sqe *sqe = &r->sqes[idx];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = IORING_OP_READ;
+    sqe->fd = fd;
+    sqe->off = off;
+    sqe->addr = (uintptr_t)buf;
+    sqe->len = len;
+    sqe->user_data = tag;
+    r->sq_array[idx] = idx;
+    __atomic_store_n(r->sq_tail, tail + 1, __ATOMIC_RELEASE);
+    r->queued++;
+    r->inflight++;
+    return 0;
+}
+
+static int ring_enter(struct io_ring *r, unsigned min_complete)
+{
+    int ret = syscall(__NR_io_uring_enter, r->fd, r->queued, min_complete,
+                      min_complete ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+    if (ret < 0)
+        return errno == EINTR || errno == EAGAIN ? 0 : -1;
+    r->queued -= ret;
+    return 0;
+}
+
+int io_ring_wait(struct io_ring *r, uint64_t *tag, int32_t *res)
+{
+    if (!r->inflight || (r->queued && ring_enter(r, 0)))
+        return -1;
+    for (;;)
+    {
+        unsigned head = *r->cq_head; // Only we move the CQ head
+        if (head != __atomic_load_n(r->cq_tail, __ATOMIC_ACQUIRE))
+        {
+            struct io_uring_cqe *cqe = &r->cqes[head & *r->cq_mask];
+            *tag = cqe->user_data;
+            *res = cqe->res;
+            __atomic_store_n(r->cq_head, head + 1, __ATOMIC_RELEASE);
+            r->inflight--;
+            return 0;
+        }
+        if (ring_enter(r, 1))
+            return -1;
+    }
+}
+
+void io_ring_free(struct io_ring *r)
+{
+    if (!r)
+        return;
+    if (r->sqes && r->sqes != MAP_FAILED)
+        munmap(r->sqes, r->sqes_len);
+    if (r->cq_map && r->cq_map != MAP_FAILED && r->cq_map != r->sq_map)
+        munmap(r->cq_map, r->cq_len);
+    if (r->sq_map && r->sq_map != MAP_FAILED)
+        munmap(r->sq_map, r->sq_len);
+    close(r->fd);
+    free(r);
+}
+
+static int read_pread(int fd, char *buf, size_t size)
+{
+    posix_fadvise(fd, 0, size, POSIX_FADV_SEQUENTIAL);
+    for (size_t done = 0; done < size;)
+    {
+        size_t len = size - done < IO_CHUNK ? size - done : IO_CHUNK;
+        ssize_t r = pread(fd, buf + done, len, done);
+        if (r < 0 && errno == EINTR)
+            continue;
+        if (r <= 0)
+        {
+            if (r == 0)
+                errno = EIO; // Shrunk under us
+            return -1;
+        }
+        done += r;
+    }
+    return 0;
+}
+
+// Every IO_CHUNK of the file in flight at once, short reads resubmitted
+static int read_ring(int fd, char *buf, size_t size)
+{
+    struct io_ring *r = io_ring_new(IO_RING_DEPTH);
+    if (!r)
+        return -1;
+
+    int err = 0;
+    size_t next = 0;
+    size_t done = 0;
+    while (!err && done < size)
+    {
+        for (; next < size && !io_ring_full(r); next += IO_CHUNK)
+        {
+            size_t len = size - next < IO_CHUNK ? size - next : IO_CHUNK;
+            io_ring_read(r, fd, buf + next, len, next, next);
+        }
+        uint64_t off;
+        int32_t res;
+        if (io_ring_wait(r, &off, &res) || res <= 0)
+        {
+            err = -1;
+            break;
+        }
+        done += res;
+        uint64_t end = (off / IO_CHUNK + 1) * IO_CHUNK;
+        if (end > size)
+            end = size;
+        off += res;
+        if (off < end)
+            io_ring_read(r, fd, buf + off, end - off, off, off);
+    }
+
+    uint64_t tag;
+    int32_t res;
+    while (io_ring_inflight(r) && io_ring_wait(r, &tag, &res) == 0)
+        ; // Nothing may land in buf once we return
+    io_ring_free(r);
+    return err;
+}
+
+// NULL with errno set on failure
+static void *load(int fd, size_t size, enum io_backend backend)
+{
+    if (backend == IO_PREAD || backend == IO_URING)
+    {
+        char *buf = malloc(size);
+        if (!buf)
+            return NULL;
+        // Kernels without io_uring or IORING_OP_READ: plain pread
+        if (backend == IO_URING && read_ring(fd, buf, size) == 0)
+            return buf;
+        if (read_pread(fd, buf, size) == 0)
+            return buf;
+        int err = errno;
+        free(buf);
+        errno = err;
+        return NULL;
+    }
+
+    if (backend == IO_SELECT)
+    {
+        // Address space only: file_need() maps pieces over it
+        void *res = mmap(NULL, size, PROT_NONE,
+                         MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        return res == MAP_FAILED ? NULL : res;
+    }
+
+    int flags = MAP_PRIVATE | (backend == IO_POPULATE ? MAP_POPULATE : 0);
+    void *content = mmap(NULL, size, PROT_READ, flags, fd, 0);
+    if (content == MAP_FAILED)
+        return NULL;
+    // Advice is a hint, a refusal changes nothing
+    if (backend == IO_MMAP_SEQ)
+    {
+        madvise(content, size, MADV_SEQUENTIAL);
+        madvise(content, size, MADV_WILLNEED);
+    }
+    else if (backend == IO_MMAP_RANDOM)
+        madvise(content, size, MADV_RANDOM);
+    return content;
+}
+
+int file_need(struct file *f, uint64_t off, uint64_t len)
+{
+    if (!f->maps || !len)
+        return 0;
+    if (off >= f->size)
+        return -1;
+    if (len > f->size - off)
+        len = f->size - off;
+
+    uint64_t page = sysconf(_SC_PAGESIZE);
+    uint64_t start = off & ~(page - 1);
+    uint64_t end = (off + len + page - 1) & ~(page - 1);
+    struct io_maps *m = f->maps;
+    for (size_t i = 0; i < m->n; i++)
+        if (m->r[i].start <= start && end <= m->r[i].end)
+            return 0;
+
+    if (mmap((char *)f->content + start, end - start, PROT_READ,
+             MAP_PRIVATE | MAP_FIXED, f->fd, start)
+        == MAP_FAILED)
+        return -1;
+    if (m->n == m->cap)
+    {
+        size_t cap = m->cap ? 2 * m->cap : 16;
+        if (!(m = realloc(m, sizeof(*m) + cap * sizeof(m->r[0]))))
+            return 0; // Mapped all the same, only not remembered
+        m->cap = cap;
+        f->maps = m;
+    }
+    m->r[m->n].start = start;
+    m->r[m->n++].end = end;
+    return 0;
+}
+
+// Program headers, section headers and their names: what elf_load reads first
+static int select_headers(struct file *f)
+{
+    const Elf64_Ehdr *h = f->content;
+    if (h->e_ident[EI_CLASS] != ELFCLASS64
+        || file_need(f, 0, sizeof(Elf64_Ehdr))
+        || file_need(f, h->e_phoff, (uint64_t)h->e_phnum * h->e_phentsize)
+        || file_need(f, h->e_shoff, (uint64_t)h->e_shnum * h->e_shentsize))
+        return -1;
+    if (h->e_shstrndx >= h->e_shnum || h->e_shentsize != sizeof(Elf64_Shdr))
+        return 0;
+    const Elf64_Shdr *str =
+        (const Elf64_Shdr *)((const char *)f->content + h->e_shoff)
+        + h->e_shstrndx;
+    return file_need(f, str->sh_offset, str->sh_size);
+}
+
+long io_peak_rss_kb(void)
+{
+    struct rusage ru;
+    return getrusage(RUSAGE_SELF, &ru) == 0 ? ru.ru_maxrss : -1;
+}
+
+// Prints nothing: errno tells why, ENOEXEC for a file that is not an ELF,
+// ENODATA for an empty one
+static struct file *open_file(const char *filename, enum io_backend backend,
+                              int elf)
+{
+    struct stat s = { 0 };
+    struct file *new = malloc(sizeof(struct file));
+    int err;
+
+    if (new == NULL)
+        return NULL;
+    if ((new->name = xstrdup(filename)) == NULL)
+        goto error_name;
+    if ((new->fd = open(new->name, O_RDONLY)) == -1)
+        goto error_open;
+    if ((fstat(new->fd, &s)) == -1)
+        goto error_load;
+    new->size = s.st_size;
+    new->mapped = backend != IO_PREAD && backend != IO_URING;
+    new->maps = NULL;
+    if (new->size < (elf ? EI_NIDENT : 1))
+    {
+        errno = new->size ? ENOEXEC : ENODATA;
+        goto error_load;
+    }
+    if ((new->content = load(new->fd, new->size, backend)) == NULL)
+        goto error_load;
+
+    if (backend == IO_SELECT
+        && (!(new->maps = calloc(1, sizeof(*new->maps)))
+            || file_need(new, 0, EI_NIDENT)))
+    {
+        err = errno;
+        file_unmap(&new);
+        errno = err;
+        return NULL;
+    }
+    if (elf && (!is_elf(new) || (new->maps && select_headers(new))))
+    {
+        file_unmap(&new);
+        errno = ENOEXEC;
+        return NULL;
+    }
+    return new;
+
+error_load:
+    err = errno;
+    close(new->fd);
+    errno = err;
+error_open:
+    free(new->name);
+error_name:
+    err = errno;
+    free(new);
+    errno = err;
+    return NULL;
+}
+
+struct file *file_open(const char *filename, enum io_backend backend)
+{
+    return open_file(filename, backend, 1);
+}
+
+struct file *file_open_raw(const char *filename, enum io_backend backend)
+{
+    return open_file(filename, backend == IO_SELECT ? IO_MMAP : backend, 0);
+}
+
+struct pf_file // One io_prefetch slot
+{
+    int fd; // -1: free
+    unsigned inflight;
+    unsigned n_seg;
+    unsigned cur; // Next range to read
+    uint64_t off[IO_PREFETCH_SEGS];
+    uint64_t end[IO_PREFETCH_SEGS];
+    uint8_t hdr[IO_HDR];
+};
+
+// Section header table and PF_X PT_LOAD file ranges named by a first page
+static unsigned pf_ranges(const uint8_t *hdr, size_t len, uint64_t *off,
+                          uint64_t *end)
+{
+    Elf64_Ehdr h;
+    if (len < sizeof(h) || memcmp(hdr, ELFMAG, SELFMAG)
+        || hdr[EI_CLASS] != ELFCLASS64)
+        return 0;
+    memcpy(&h, hdr, sizeof(h));
+
+    unsigned n = 0;
+    if (h.e_shnum && h.e_shentsize == sizeof(Elf64_Shdr))
+    {
+        off[n] = h.e_shoff;
+        end[n++] = h.e_shoff + (uint64_t)h.e_shnum * sizeof(Elf64_Shdr);
+    }
+    if (h.e_phentsize != sizeof(Elf64_Phdr)
+        || h.e_phoff + (uint64_t)h.e_phnum * sizeof(Elf64_Phdr) > len)
+        return n;
+    for (size_t i = 0; i < h.e_phnum && n < IO_PREFETCH_SEGS; i++)
+    {
+        Elf64_Phdr p;
+        memcpy(&p, hdr + h.e_phoff + i * sizeof(p), sizeof(p));
+        if (p.p_type == PT_LOAD && (p.p_flags & PF_X) && p.p_filesz)
+        {
+            off[n] = p.p_offset;
+            end[n++] = p.p_offset + p.p_filesz;
+        }
+    }
+    return n;
+}
+
+static size_t prefetch_advise(char *const *paths, size_t n)
+{
+    uint8_t hdr[IO_HDR];
+    uint64_t off[IO_PREFETCH_SEGS];
+    uint64_t end[IO_PREFETCH_SEGS];
+    size_t done = 0;
+
+    for (size_t i = 0; i < n; i++)
+    {
+        int fd = open(paths[i], O_RDONLY);
+        if (fd == -1)
+            continue;
+        ssize_t r = pread(fd, hdr, sizeof(hdr), 0);
+        unsigned segs = pf_ranges(hdr, r > 0 ? r : 0, off, end);
+        for (unsigned s = 0; s < segs; s++)
+            posix_fadvise(fd, off[s], end[s] - off[s], POSIX_FADV_WILLNEED);
+        close(fd);
+        done++;
+    }
+    return done;
+}
+
+// Queue the ranges left in a slot, into a sink nobody reads
+static void pf_pump(struct io_ring *r, struct pf_file *f, unsigned slot,
+                    uint8_t *sink)
+{
+    while (f->cur < f->n_seg && !io_ring_full(r))
+    {
+        uint64_t left = f->end[f->cur] - f->off[f->cur];
+        uint32_t len = left < IO_CHUNK ? left : IO_CHUNK;
+        io_ring_read(r, f->fd, sink, len, f->off[f->cur], (slot << 1) | 1);
+        f->inflight++;
+        if ((f->off[f->cur] += len) >= f->end[f->cur])
+            f->cur++;
+    }
+}
+
+size_t io_prefetch(char *const *paths, size_t n)
+{
+    struct io_ring *r = io_ring_new(IO_RING_DEPTH);
+    struct pf_file *slots = malloc(IO_PREFETCH_FILES * sizeof(*slots));
+    uint8_t *sink = malloc(IO_CHUNK);
+    if (!r || !slots || !sink)
+    {
+        io_ring_free(r);
+        free(slots);
+        free(sink);
+        return prefetch_advise(paths, n);
+    }
+    for (unsigned s = 0; s < IO_PREFETCH_FILES; s++)
+        slots[s].fd = -1;
+
+    size_t next = 0;
+    size_t done = 0;
+    for (;;)
+    {
+        for (unsigned s = 0; s < IO_PREFETCH_FILES; s++)
+            if (slots[s].fd != -1)
+                pf_pump(r, &slots[s], s, sink);
+        for (unsigned s = 0; s < IO_PREFETCH_FILES; s++)
+        {
+            struct pf_file *f = &slots[s];
+            if (f->fd != -1 || next >= n || io_ring_full(r))
+                continue;
+            if ((f->fd = open(paths[next++], O_RDONLY)) == -1)
+                continue;
+            f->n_seg = f->cur = 0;
+            f->inflight = 1;
+            io_ring_read(r, f->fd, f->hdr, IO_HDR, 0, s << 1);
+        }
+        if (!io_ring_inflight(r))
+        {
+            if (next >= n)
+                break;
+            continue;
+        }
+
+        uint64_t tag;
+        int32_t res;
+        if (io_ring_wait(r, &tag, &res))
+            break;
+        struct pf_file *f = &slots[tag >> 1];
+        f->inflight--;
+        if (!(tag & 1))
+            f->n_seg = pf_ranges(f->hdr, res > 0 ? res : 0, f->off, f->end);
+        if (!f->inflight && f->cur >= f->n_seg)
+        {
+            close(f->fd);
+            f->fd = -1;
+            done++;
+        }
+    }
+
+    uint64_t tag;
+    int32_t res;
+    while (io_ring_inflight(r) && io_ring_wait(r, &tag, &res) == 0)
+        ;
+    for (unsigned s = 0; s < IO_PREFETCH_FILES; s++)
+        if (slots[s].fd != -1)
+            close(slots[s].fd);
+    io_ring_free(r);
+    free(slots);
+    free(sink);
+    return done;
+}
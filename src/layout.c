@@ -0,0 +1,372 @@
+#include "include/layout.h"
+
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct layout_state
+{
+    size_t n;
+    uint64_t *samples; // Per sym_list id
+    uint32_t *by_heat; // Hot function ids, hottest first
+    size_t n_hot; // Functions with samples
+    size_t n_set; // Prefix of by_heat forming the hot set
+    uint8_t *in_set;
+    uint32_t *cluster; // Cluster id of each function (its first member)
+    uint32_t *next; // Next member of the same cluster or SYM_NONE
+    uint32_t *tail; // Last member, valid for cluster ids
+    uint64_t *csize; // Bytes, valid for cluster ids
+    uint64_t *csamples;
+    uint32_t *order; // Final function order
+    struct rank *rank; // Sort scratch
+    size_t n_order;
+};
+
+struct rank // Sort key: decreasing key, then increasing id
+{
+    double key;
+    uint32_t id;
+};
+
+static int cmp_rank(const void *a, const void *b)
+{
+    const struct rank *x = a;
+    const struct rank *y = b;
+    if (x->key != y->key)
+        return x->key < y->key ? 1 : -1;
+    return (x->id > y->id) - (x->id < y->id);
+}
+
+// Sort ids[0..n) by r[i].key, r[i] must describe ids[i]
+static void sort_ranked(struct rank *r, uint32_t *ids, size_t n)
+{
+    qsort(r, n, sizeof(*r), cmp_rank);
+    for (size_t i = 0; i < n; i++)
+        ids[i] = r[i].id;
+}
+
+static uint64_t func_size(const struct sym_list *lst, uint32_t id)
+{
+    return lst->items[id].size ? lst->items[id].size : 1;
+}
+
+// Static call sites of caller -> callee (dst rows are sorted)
+static uint32_t edge_count(const struct callgraph *cg, uint32_t caller,
+                           uint32_t callee)
+{
+    uint32_t lo = cg->off[caller];
+    uint32_t hi = cg->off[caller + 1];
+    while (lo < hi)
+    {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (cg->dst[mid] < callee)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo < cg->off[caller + 1] && cg->dst[lo] == callee ? cg->cnt[lo]
+                                                             : 0;
+}
+
+/*
+ * Call-chain clustering (C3): hottest function first, append its cluster
+ * to the cluster of its heaviest hot caller unless the result outgrows
+ * LAYOUT_MERGE_MAX. Samples carry no call edges, so arc weights are
+ * estimated as static call sites scaled by the caller's samples.
+ */
+static void c3_clusters(struct layout_state *st, const struct sym_list *lst,
+                        const struct callgraph *cg)
+{
+    for (size_t i = 0; i < st->n_hot; i++)
+    {
+        uint32_t f = st->by_heat[i];
+        st->cluster[f] = f;
+        st->next[f] = SYM_NONE;
+        st->tail[f] = f;
+        st->csize[f] = func_size(lst, f);
+        st->csamples[f] = st->samples[f];
+    }
+
+    for (size_t i = 0; cg && i < st->n_hot; i++)
+    {
+        uint32_t f = st->by_heat[i];
+        uint32_t best = SYM_NONE;
+        uint64_t best_w = 0;
+
+        for (uint32_t k = cg->roff[f]; k < cg->roff[f + 1]; k++)
+        {
+            uint32_t c = cg->src[k];
+            if (c == f || !st->samples[c])
+                continue;
+            uint64_t w = edge_count(cg, c, f) * st->samples[c];
+            if (w > best_w)
+            {
+                best_w = w;
+                best = c;
+            }
+        }
+        if (best == SYM_NONE)
+            continue;
+
+        uint32_t cc = st->cluster[best];
+        uint32_t cf = st->cluster[f];
+        if (cc == cf || st->csize[cc] + st->csize[cf] > LAYOUT_MERGE_MAX)
+            continue;
+
+        st->next[st->tail[cc]] = cf;
+        st->tail[cc] = st->tail[cf];
+        st->csize[cc] += st->csize[cf];
+        st->csamples[cc] += st->csamples[cf];
+        for (uint32_t m = cf; m != SYM_NONE; m = st->next[m])
+            st->cluster[m] = cc;
+    }
+
+    // Surviving cluster ids, densest (samples per byte) first, flattened
+    uint32_t *heads = st->order + st->n_hot; // Second half of the buffer
+    size_t n_heads = 0;
+    for (size_t i = 0; i < st->n_hot; i++)
+    {
+        uint32_t c = st->by_heat[i];
+        if (st->cluster[c] != c)
+            continue;
+        st->rank[n_heads] = (struct rank){
+            (double)st->csamples[c] / (st->csize[c] + 1), c
+        };
+        heads[n_heads++] = c;
+    }
+    sort_ranked(st->rank, heads, n_heads);
+
+    st->n_order = 0;
+    for (size_t i = 0; i < n_heads; i++)
+        for (uint32_t m = heads[i]; m != SYM_NONE; m = st->next[m])
+            st->order[st->n_order++] = m;
+}
+
+struct span // Distinct pages touched
+{
+    size_t small;
+    size_t huge;
+    uint64_t last_small; // Last page counted, UINT64_MAX if none
+    uint64_t last_huge;
+};
+
+static void span_pages(size_t *count, uint64_t *last, uint64_t page,
+                       uint64_t start, uint64_t end)
+{
+    uint64_t first = start / page;
+    uint64_t final = (end - 1) / page;
+
+    if (*last != UINT64_MAX && first <= *last)
+        first = *last + 1;
+    if (final >= first)
+    {
+        *count += final - first + 1;
+        *last = final;
+    }
+}
+
+// Ranges must come in increasing start order
+static void span_add(struct span *sp, uint64_t start, uint64_t end)
+{
+    span_pages(&sp->small, &sp->last_small, LAYOUT_PAGE, start, end);
+    span_pages(&sp->huge, &sp->last_huge, LAYOUT_HUGE_PAGE, start, end);
+}
+
+static void span_print(FILE *out, const char *what, const struct span *sp)
+{
+    fprintf(out, "  %-16s %6zu 4K pages, %4zu 2M pages\n", what, sp->small,
+            sp->huge);
+}
+
+static void print_tables(FILE *out, const struct layout_state *st,
+                         const struct profile *prof,
+                         const struct sym_list *lst)
+{
+    fputs("Hottest functions:\n     %  samples      size  samples/KB  name\n",
+          out);
+    for (size_t i = 0; i < st->n_hot && i < LAYOUT_TOP; i++)
+    {
+        uint32_t id = st->by_heat[i];
+        uint64_t size = func_size(lst, id);
+        fprintf(out, "%6.2f %8" PRIu64 "  %8" PRIu64 "  %10.1f  %s\n",
+                100.0 * st->samples[id] / prof->n, st->samples[id], size,
+                1024.0 * st->samples[id] / size, lst->items[id].name);
+    }
+
+    // Samples are sorted: each 4K page is one run
+    struct page_heat
+    {
+        uint64_t page;
+        size_t count;
+    } top[LAYOUT_TOP];
+    size_t n_top = 0;
+    size_t n_pages = 0;
+
+    for (size_t i = 0; i < prof->n;)
+    {
+        uint64_t page = prof->ips[i] / LAYOUT_PAGE;
+        size_t j = i;
+        while (j < prof->n && prof->ips[j] / LAYOUT_PAGE == page)
+            j++;
+        n_pages++;
+
+        // Insertion into the small top table
+        size_t count = j - i;
+        if (n_top < LAYOUT_TOP || count > top[n_top - 1].count)
+        {
+            size_t k = n_top < LAYOUT_TOP ? n_top++ : n_top - 1;
+            while (k && top[k - 1].count < count)
+            {
+                top[k] = top[k - 1];
+                k--;
+            }
+            top[k] = (struct page_heat){ page, count };
+        }
+        i = j;
+    }
+
+    fprintf(out, "\nHottest 4K pages (%zu sampled):\n", n_pages);
+    for (size_t i = 0; i < n_top; i++)
+        fprintf(out, "  0x%08" PRIx64 " %6.2f%% %8zu\n",
+                top[i].page * LAYOUT_PAGE, 100.0 * top[i].count / prof->n,
+                top[i].count);
+}
+
+static int write_order(const char *path, const struct layout_state *st,
+                       const struct sym_list *lst)
+{
+    FILE *f = fopen(path, "w");
+    if (!f)
+    {
+        perror("Cannot open the symbol ordering file");
+        return -1;
+    }
+    for (size_t i = 0; i < st->n_order; i++)
+        fprintf(f, "%s\n", lst->items[st->order[i]].name);
+    if (fclose(f))
+    {
+        perror("Cannot write the symbol ordering file");
+        return -1;
+    }
+    return 0;
+}
+
+static void free_state(struct layout_state *st)
+{
+    free(st->samples);
+    free(st->by_heat);
+    free(st->in_set);
+    free(st->cluster);
+    free(st->next);
+    free(st->tail);
+    free(st->csize);
+    free(st->csamples);
+    free(st->order);
+    free(st->rank);
+}
+
+static int alloc_state(struct layout_state *st, size_t n)
+{
+    memset(st, 0, sizeof(*st));
+    st->n = n;
+    st->samples = calloc(n + 1, sizeof(*st->samples));
+    st->by_heat = malloc((n + 1) * sizeof(*st->by_heat));
+    st->in_set = calloc(n + 1, sizeof(*st->in_set));
+    st->cluster = malloc((n + 1) * sizeof(*st->cluster));
+    st->next = malloc((n + 1) * sizeof(*st->next));
+    st->tail = malloc((n + 1) * sizeof(*st->tail));
+    st->csize = malloc((n + 1) * sizeof(*st->csize));
+    st->csamples = malloc((n + 1) * sizeof(*st->csamples));
+    st->order = malloc((2 * n + 1) * sizeof(*st->order));
+    st->rank = malloc((n + 1) * sizeof(*st->rank));
+    if (!st->samples || !st->by_heat || !st->in_set || !st->cluster
+        || !st->next || !st->tail || !st->csize || !st->csamples
+        || !st->order || !st->rank)
+    {
+        free_state(st);
+        return -1;
+    }
+    return 0;
+}
+
+int layout_report(FILE *out, const struct profile *prof,
+                  const struct sym_list *lst, const struct sym_index *idx,
+                  const struct callgraph *cg, const char *order_path)
+{
+    struct layout_state st;
+    uint64_t total = 0;
+
+    if (alloc_state(&st, lst->count))
+    {
+        fprintf(stderr, "[-] Out of memory in the layout analysis\n");
+        return -1;
+    }
+
+    for (size_t i = 0; i < idx->n; i++)
+    {
+        uint32_t id = idx->id[i];
+        st.samples[id] = profile_range(prof, idx->start[i], idx->end[i], NULL);
+        if (st.samples[id])
+        {
+            st.by_heat[st.n_hot++] = id;
+            total += st.samples[id];
+        }
+    }
+    for (size_t i = 0; i < st.n_hot; i++)
+        st.rank[i] = (struct rank){ (double)st.samples[st.by_heat[i]],
+                                    st.by_heat[i] };
+    sort_ranked(st.rank, st.by_heat, st.n_hot);
+
+    uint64_t covered = 0;
+    while (st.n_set < st.n_hot && covered < LAYOUT_HOT_FRAC * total)
+    {
+        covered += st.samples[st.by_heat[st.n_set]];
+        st.in_set[st.by_heat[st.n_set++]] = 1;
+    }
+
+    fprintf(out, "Layout of %zu samples, %" PRIu64 " in %zu .text functions\n",
+            prof->n, total, st.n_hot);
+    print_tables(out, &st, prof, lst);
+
+    // Current addresses of the hot set
+    struct span cur = { 0, 0, UINT64_MAX, UINT64_MAX };
+    uint64_t hot_bytes = 0;
+    for (size_t i = 0; i < idx->n; i++)
+        if (st.in_set[idx->id[i]])
+        {
+            span_add(&cur, idx->start[i], idx->end[i]);
+            hot_bytes += idx->end[i] - idx->start[i];
+        }
+
+    // Same functions packed in the C3 order from the first one's page
+    c3_clusters(&st, lst, cg);
+    struct span c3 = { 0, 0, UINT64_MAX, UINT64_MAX };
+    uint64_t addr = idx->n ? idx->start[0] & ~(LAYOUT_PAGE - 1) : 0;
+    for (size_t i = 0; i < st.n_order; i++)
+    {
+        uint32_t id = st.order[i];
+        addr = (addr + LAYOUT_FUNC_ALIGN - 1) & ~(LAYOUT_FUNC_ALIGN - 1ULL);
+        if (st.in_set[id])
+            span_add(&c3, addr, addr + func_size(lst, id));
+        addr += func_size(lst, id);
+    }
+
+    fprintf(out,
+            "\nHot set: %zu functions, %" PRIu64 " bytes, %.0f%% of "
+            "samples (minimum %" PRIu64 " 4K pages)\n",
+            st.n_set, hot_bytes, total ? 100.0 * covered / total : 0.0,
+            (hot_bytes + LAYOUT_PAGE - 1) / LAYOUT_PAGE);
+    span_print(out, "current layout", &cur);
+    span_print(out, "C3 order", &c3);
+
+    int ret = 0;
+    if (order_path)
+    {
+        ret = write_order(order_path, &st, lst);
+        if (!ret)
+            fprintf(out, "[+] Symbol ordering (%zu functions) written to %s\n",
+                    st.n_order, order_path);
+    }
+    free_state(&st);
+    return ret;
+}
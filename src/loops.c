@@ -0,0 +1,363 @@
+#include "include/loops.h"
+
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct lt_state // Lengauer-Tarjan working arrays, indexed by block id
+{
+    uint32_t *dfnum; // CFG_NONE if unreachable
+    uint32_t *vertex; // dfnum -> block
+    uint32_t *parent; // DFS tree parent
+    uint32_t *semi;
+    uint32_t *ancestor; // Forest built by link()
+    uint32_t *best; // Vertex with lowest semi on the compressed path
+    uint32_t *samedom;
+    uint32_t *bucket_head;
+    uint32_t *bucket_next;
+    uint32_t *stack; // Scratch for the iterative walks
+    uint32_t n; // Reachable blocks
+};
+
+static uint32_t *alloc_fill(struct arena *a, uint32_t n, uint8_t byte)
+{
+    uint32_t *p = arena_alloc(a, ((size_t)n + 1) * sizeof(*p));
+    if (p)
+        memset(p, byte, ((size_t)n + 1) * sizeof(*p));
+    return p;
+}
+
+// Iterative DFS from the entry block numbering reachable blocks
+static void lt_dfs(const struct cfg *cfg, struct lt_state *st)
+{
+    uint32_t *next_succ = st->semi; // Reused as a per-block cursor
+    uint32_t sp = 0;
+
+    memset(next_succ, 0, (size_t)cfg->n_blocks * sizeof(*next_succ));
+    st->dfnum[0] = 0;
+    st->vertex[st->n++] = 0;
+    st->stack[sp++] = 0;
+    while (sp)
+    {
+        uint32_t b = st->stack[sp - 1];
+        const struct cfg_block *blk = &cfg->blocks[b];
+        if (next_succ[b] == blk->n_succ)
+        {
+            sp--;
+            continue;
+        }
+
+        uint32_t s = cfg->edges[blk->first_succ + next_succ[b]++].to;
+        if (st->dfnum[s] != CFG_NONE)
+            continue;
+        st->dfnum[s] = st->n;
+        st->vertex[st->n++] = s;
+        st->parent[s] = b;
+        st->stack[sp++] = s;
+    }
+}
+
+// Path compressing eval(), iterative so deep chains can't blow the stack
+static uint32_t lt_eval(struct lt_state *st, uint32_t v)
+{
+    uint32_t sp = 0;
+    uint32_t x = v;
+
+    while (st->ancestor[x] != CFG_NONE
+           && st->ancestor[st->ancestor[x]] != CFG_NONE)
+    {
+        st->stack[sp++] = x;
+        x = st->ancestor[x];
+    }
+    while (sp)
+    {
+        uint32_t y = st->stack[--sp];
+        uint32_t a = st->ancestor[y];
+        uint32_t b = st->best[a];
+        st->ancestor[y] = st->ancestor[a];
+        if (st->dfnum[st->semi[b]] < st->dfnum[st->semi[st->best[y]]])
+            st->best[y] = b;
+    }
+
+    return st->best[v];
+}
+
+static void lt_idom(const struct cfg *cfg, struct lt_state *st, uint32_t *idom)
+{
+    for (uint32_t i = st->n; i-- > 1;)
+    {
+        uint32_t w = st->vertex[i];
+        uint32_t p = st->parent[w];
+        uint32_t s = p;
+        const struct cfg_block *blk = &cfg->blocks[w];
+
+        for (uint32_t k = 0; k < blk->n_pred; k++)
+        {
+            uint32_t v = cfg->edges[cfg->preds[blk->first_pred + k]].from;
+            uint32_t s2;
+            if (st->dfnum[v] == CFG_NONE)
+                continue;
+            if (st->dfnum[v] <= st->dfnum[w])
+                s2 = v;
+            else
+                s2 = st->semi[lt_eval(st, v)];
+            if (st->dfnum[s2] < st->dfnum[s])
+                s = s2;
+        }
+        st->semi[w] = s;
+        st->bucket_next[w] = st->bucket_head[s];
+        st->bucket_head[s] = w;
+
+        st->ancestor[w] = p; // link(p, w)
+        st->best[w] = w;
+
+        for (uint32_t v = st->bucket_head[p]; v != CFG_NONE;
+             v = st->bucket_next[v])
+        {
+            uint32_t y = lt_eval(st, v);
+            if (st->semi[y] == st->semi[v])
+                idom[v] = p;
+            else
+                st->samedom[v] = y;
+        }
+        st->bucket_head[p] = CFG_NONE;
+    }
+
+    for (uint32_t i = 1; i < st->n; i++)
+    {
+        uint32_t w = st->vertex[i];
+        if (st->samedom[w] != CFG_NONE)
+            idom[w] = idom[st->samedom[w]];
+    }
+}
+
+// Preorder intervals of the dominator tree for O(1) dominance queries
+static int number_domtree(struct arena *a, const struct cfg *cfg,
+                          struct loop_info *li, uint32_t *stack)
+{
+    uint32_t n = cfg->n_blocks;
+    uint32_t *first = alloc_fill(a, n + 1, 0);
+    uint32_t *child = alloc_fill(a, n, 0);
+    uint32_t *cursor = alloc_fill(a, n, 0);
+    if (!first || !child || !cursor)
+        return -1;
+
+    for (uint32_t b = 0; b < n; b++)
+        if (li->idom[b] != CFG_NONE)
+            first[li->idom[b] + 1]++;
+    for (uint32_t b = 0; b < n; b++)
+        first[b + 1] += first[b];
+    for (uint32_t b = 0; b < n; b++)
+        if (li->idom[b] != CFG_NONE)
+            child[first[li->idom[b]] + cursor[li->idom[b]]++] = b;
+
+    uint32_t sp = 0;
+    uint32_t counter = 0;
+    memset(cursor, 0, (size_t)n * sizeof(*cursor));
+    stack[sp++] = 0;
+    li->pre[0] = counter++;
+    while (sp)
+    {
+        uint32_t b = stack[sp - 1];
+        if (first[b] + cursor[b] == first[b + 1])
+        {
+            li->post[b] = counter - 1;
+            sp--;
+            continue;
+        }
+        uint32_t c = child[first[b] + cursor[b]++];
+        li->pre[c] = counter++;
+        stack[sp++] = c;
+    }
+    return 0;
+}
+
+bool dominates(const struct loop_info *li, uint32_t a, uint32_t b)
+{
+    if (li->pre[a] == CFG_NONE || li->pre[b] == CFG_NONE)
+        return false;
+    return li->pre[a] <= li->pre[b] && li->pre[b] <= li->post[a];
+}
+
+static int cmp_loop_size(const void *a, const void *b)
+{
+    const struct loop *x = *(const struct loop *const *)a;
+    const struct loop *y = *(const struct loop *const *)b;
+    return (x->n_blocks < y->n_blocks) - (x->n_blocks > y->n_blocks);
+}
+
+// Body of the loop headed by h: blocks reaching a back edge source without
+// going through h
+static int loop_body(struct arena *a, const struct cfg *cfg,
+                     const struct loop_info *li, struct loop *l,
+                     uint32_t *stamp, uint32_t *stack)
+{
+    uint32_t h = l->header;
+    const struct cfg_block *hb = &cfg->blocks[h];
+    uint32_t sp = 0;
+    uint32_t n = 0;
+
+    stamp[h] = h;
+    stack[n++] = h; // Body list is built in the same scratch array
+    for (uint32_t k = 0; k < hb->n_pred; k++)
+    {
+        uint32_t u = cfg->edges[cfg->preds[hb->first_pred + k]].from;
+        if (dominates(li, h, u) && stamp[u] != h)
+        {
+            stamp[u] = h;
+            stack[n++] = u;
+        }
+    }
+
+    // Worklist is the tail of the body list
+    for (sp = 1; sp < n; sp++)
+    {
+        const struct cfg_block *blk = &cfg->blocks[stack[sp]];
+        for (uint32_t k = 0; k < blk->n_pred; k++)
+        {
+            uint32_t v = cfg->edges[cfg->preds[blk->first_pred + k]].from;
+            if (stamp[v] != h && li->pre[v] != CFG_NONE)
+            {
+                stamp[v] = h;
+                stack[n++] = v;
+            }
+        }
+    }
+
+    if (!(l->blocks = arena_alloc(a, (size_t)n * sizeof(*l->blocks))))
+        return -1;
+    memcpy(l->blocks, stack, (size_t)n * sizeof(*l->blocks));
+    l->n_blocks = n;
+    for (uint32_t i = 0; i < n; i++)
+    {
+        l->n_ins += cfg->blocks[stack[i]].n_ins;
+        l->n_bytes += cfg->blocks[stack[i]].end - cfg->blocks[stack[i]].start;
+    }
+    return 0;
+}
+
+static int find_loops(struct arena *a, const struct cfg *cfg,
+                      struct loop_info *li, uint32_t *stamp, uint32_t *stack)
+{
+    uint32_t n = cfg->n_blocks;
+
+    // Headers are targets of back edges (edges whose target dominates)
+    for (uint32_t e = 0; e < cfg->n_edges; e++)
+        if (dominates(li, cfg->edges[e].to, cfg->edges[e].from))
+            stamp[cfg->edges[e].to]++;
+
+    li->n_loops = 0;
+    for (uint32_t b = 0; b < n; b++)
+        li->n_loops += stamp[b] != 0;
+    li->loops = arena_calloc(a, li->n_loops + 1, sizeof(*li->loops));
+    struct loop **by_size =
+        arena_alloc(a, (li->n_loops + 1) * sizeof(*by_size));
+    if (!li->loops || !by_size)
+        return -1;
+
+    uint32_t l = 0;
+    for (uint32_t b = 0; b < n; b++)
+        if (stamp[b])
+        {
+            li->loops[l].header = b;
+            li->loops[l].n_back_edges = stamp[b];
+            li->loops[l].parent = CFG_NONE;
+            by_size[l] = &li->loops[l];
+            l++;
+        }
+
+    memset(stamp, 0xFF, (size_t)n * sizeof(*stamp));
+    for (l = 0; l < li->n_loops; l++)
+        if (loop_body(a, cfg, li, &li->loops[l], stamp, stack))
+            return -1;
+
+    // Outer loops first: inner bodies are strict subsets of theirs, so the
+    // last loop written to a block is its innermost one
+    qsort(by_size, li->n_loops, sizeof(*by_size), cmp_loop_size);
+    for (l = 0; l < li->n_loops; l++)
+    {
+        struct loop *lp = by_size[l];
+        uint32_t id = (uint32_t)(lp - li->loops);
+        lp->parent = li->loop_of[lp->header];
+        lp->depth =
+            lp->parent == CFG_NONE ? 1 : li->loops[lp->parent].depth + 1;
+        for (uint32_t i = 0; i < lp->n_blocks; i++)
+            li->loop_of[lp->blocks[i]] = id;
+    }
+    return 0;
+}
+
+struct loop_info *loops_build(struct arena *a, const struct cfg *cfg)
+{
+    uint32_t n = cfg->n_blocks;
+    struct loop_info *li = arena_calloc(a, 1, sizeof(*li));
+    struct lt_state st = { 0 };
+
+    if (!li)
+        return NULL;
+    li->idom = alloc_fill(a, n, 0xFF);
+    li->pre = alloc_fill(a, n, 0xFF);
+    li->post = alloc_fill(a, n, 0xFF);
+    li->loop_of = alloc_fill(a, n, 0xFF);
+    st.dfnum = alloc_fill(a, n, 0xFF);
+    st.vertex = alloc_fill(a, n, 0xFF);
+    st.parent = alloc_fill(a, n, 0xFF);
+    st.semi = alloc_fill(a, n, 0xFF);
+    st.ancestor = alloc_fill(a, n, 0xFF);
+    st.best = alloc_fill(a, n, 0xFF);
+    st.samedom = alloc_fill(a, n, 0xFF);
+    st.bucket_head = alloc_fill(a, n, 0xFF);
+    st.bucket_next = alloc_fill(a, n, 0xFF);
+    st.stack = alloc_fill(a, n, 0xFF);
+    if (!li->idom || !li->pre || !li->post || !li->loop_of || !st.dfnum
+        || !st.vertex || !st.parent || !st.semi || !st.ancestor || !st.best
+        || !st.samedom || !st.bucket_head || !st.bucket_next || !st.stack)
+        return NULL;
+    if (!n)
+        return li;
+
+    lt_dfs(cfg, &st);
+    memset(st.semi, 0xFF, (size_t)n * sizeof(*st.semi));
+    for (uint32_t i = 0; i < st.n; i++)
+        st.semi[st.vertex[i]] = st.vertex[i];
+    lt_idom(cfg, &st, li->idom);
+
+    // Scratch arrays are reused past this point
+    memset(st.best, 0, (size_t)n * sizeof(*st.best));
+    if (number_domtree(a, cfg, li, st.stack)
+        || find_loops(a, cfg, li, st.best, st.stack))
+        return NULL;
+    return li;
+}
+
+void loops_print(FILE *out, const struct cfg *cfg, const struct loop_info *li)
+{
+    fprintf(out, "%" PRIu32 " loop(s)\n", li->n_loops);
+    for (uint32_t l = 0; l < li->n_loops; l++)
+    {
+        const struct loop *lp = &li->loops[l];
+        fprintf(out, "%*sL%" PRIu32 ": header bb%" PRIu32 " <0x%" PRIx64
+                ">, depth %" PRIu32 ", %" PRIu32 " blocks, %" PRIu32
+                " instructions, %" PRIu64 " bytes",
+                (int)(2 * lp->depth), "", l, lp->header,
+                cfg->blocks[lp->header].start, lp->depth, lp->n_blocks,
+                lp->n_ins, lp->n_bytes);
+        if (lp->parent != CFG_NONE)
+            fprintf(out, ", in L%" PRIu32, lp->parent);
+        putc('\n', out);
+    }
+    putc('\n', out);
+}
+
+void loops_note(FILE *out, const struct cfg *cfg, uint32_t block, void *data)
+{
+    const struct loop_info *li = data;
+    uint32_t l = li->loop_of[block];
+    (void)cfg;
+
+    if (l == CFG_NONE)
+        return;
+    fprintf(out, "\tloop L%" PRIu32 " (depth %" PRIu32 "%s)", l,
+            li->loops[l].depth,
+            li->loops[l].header == block ? ", header" : "");
+}
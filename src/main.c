@@ -2,7 +2,31 @@
 #include "include/utils.h"
 #include "include/pretty_print.h"
 #include "include/disas.h"
+#include "include/diff.h"
+#include "include/fprint.h"
+#include "include/callgraph.h"
+#include "include/symidx.h"
+#include "include/cfg.h"
+#include "include/loops.h"
+#include "include/cost.h"
+#include "include/align.h"
+#include "include/profile.h"
+#include "include/layout.h"
+#include "include/addr2sym.h"
+#include "include/serve.h"
+#include "include/repl.h"
+#include "include/watch.h"
+#include "include/batch.h"
+#include "include/triage.h"
+#include "include/stream.h"
+#include "include/procmem.h"
+#include "include/raw.h"
+#include "include/reloc.h"
+#include "include/plt.h"
+#include "include/dataidx.h"
+#include "include/strscan.h"
 
+#include <errno.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <elf.h>
@@ -13,97 +37,697 @@
 
 // Program arguments
 #define ARGS_MIN 3
-#define ARGS_MAX 7
+#define ARGS_MAX 16
 #define DISAS 'd' // -d disas .text (+option to select symbol in .text)
 #define F_INFO 'f' // -f print file info
 #define F_HEADERS 'h' // -h print headers
 #define HEXDUMP                                                                \
     'x' // -x hexdump of .text(+option to select a given symbol in .text)
 
+// Standalone modes (replace the target_program argument)
+#define DIFF_MODE "--diff" // --diff old.elf new.elf: function-level diff
+#define FPRINT_MODE "--fingerprint" // --fingerprint index bin...: build index
+#define QUERY_MODE "--query" // --query index bin [min_sim]: near-duplicates
+#define A2S_MODE "--addr2sym" // --addr2sym bin [file]: symbolize addresses
+#define SERVE_MODE "--serve" // --serve socket: query daemon
+#define REPL_MODE "-i" // -i binary: interactive queries on preloaded indexes
+#define WATCH_MODE "--watch" // --watch bin [n]: diff each rebuild of bin
+#define BATCH_MODE "--batch" // --batch [-j n] [-o dir] path...: many files
+#define PID_MODE "--pid" // --pid N [symbol]: code of a running process
+#define CORE_MODE "--core" // --core file [symbol]: code of a core dump
+#define RAW_MODE "--raw" // --raw file [--base addr] [--hex]: not an ELF
+#define STDIN_TARGET "-" // - [-d]: disassemble an ELF streamed on stdin
+#define IO_OPT "--io" // --io backend, before the target or --batch
+#define TRIAGE_MODE "--triage" // --triage path...: header-only security scan
+
+// Long target options
+#define CALLGRAPH "--callgraph" // --callgraph dot | --callgraph bin file
+#define CALLERS "--callers" // --callers symbol
+#define CALLEES "--callees" // --callees symbol
+#define CFG "--cfg" // --cfg (+optional symbol): block structured disassembly
+#define LOOPS "--loops" // --loops (+optional symbol): CFG + loop nests
+#define COST "--cost" // --cost (+optional symbol): loops + cycle estimates
+#define UARCH "--uarch" // --uarch name: cost model used by later --cost
+#define ALIGN "--align" // --align (+optional symbol): alignment / JCC erratum
+#define PROFILE "--profile" // --profile samples.txt: annotate with ip samples
+#define LAYOUT "--layout" // --layout samples.txt [order file]: hot/cold pages
+#define STRINGS "--strings" // --strings [min_len] [xref]: data section strings
+
+struct run_ctx // Target binary and the analyses built on demand for it
+{
+    struct elf_bin *bin;
+    struct callgraph cg;
+    int has_cg;
+    struct reloc_index rel; // .text relocations of an ET_REL target
+    int has_rel;
+    struct plt_map plt; // Imports of a linked target
+    struct data_index data; // Its symbols and sections by address
+    int has_names;
+    const struct uarch *uarch;
+};
+
+enum cfg_view
+{
+    VIEW_CFG,
+    VIEW_LOOPS,
+    VIEW_COST,
+};
+
+struct cost_notes // Data of cost_notes_fn
+{
+    const struct loop_info *li;
+    const struct uarch *u;
+};
+
+static int is_long_arg(const char *arg)
+{
+    return arg
+        && (strcmp(arg, CALLGRAPH) == 0 || strcmp(arg, CALLERS) == 0
+            || strcmp(arg, CALLEES) == 0 || strcmp(arg, CFG) == 0
+            || strcmp(arg, LOOPS) == 0 || strcmp(arg, COST) == 0
+            || strcmp(arg, UARCH) == 0 || strcmp(arg, ALIGN) == 0
+            || strcmp(arg, PROFILE) == 0 || strcmp(arg, LAYOUT) == 0
+            || strcmp(arg, STRINGS) == 0);
+}
+
 // Check if given string is a program argument (distinguish from argument
 // option)
 static int is_arg(const char *arg)
 {
-    return arg && arg[0] == '-' && arg[1] && !arg[2]
-        && (arg[1] == DISAS || arg[1] == F_INFO || arg[1] == F_HEADERS
-            || arg[1] == HEXDUMP);
+    return is_long_arg(arg)
+        || (arg && arg[0] == '-' && arg[1] && !arg[2]
+            && (arg[1] == DISAS || arg[1] == F_INFO || arg[1] == F_HEADERS
+                || arg[1] == HEXDUMP));
 }
 
-int main(int argc, char **argv)
+// The library stays quiet, say why a target cannot be used
+static struct elf_bin *load_target(const char *path, enum io_backend io)
 {
-    // Ensure correct usage
-    if (argc < ARGS_MIN || argc > ARGS_MAX)
+    struct elf_bin *bin = elf_load_io(path, io);
+    if (!bin)
+        fprintf(stderr, "[-] %s: %s\n", path, elf_strerror(errno));
+    return bin;
+}
+
+static struct callgraph *get_callgraph(struct run_ctx *ctx)
+{
+    if (!ctx->has_cg)
     {
-        fprintf(
-            stderr,
-            "[-] Usage: ./%s target_program [options...]\nOptions=-d(+optional "
-            "symbol), -f, -h, -x(+optional section)\n",
-            TARGET);
+        if (cg_build(&ctx->cg, ctx->bin))
+        {
+            fprintf(stderr, "[-] Failed to build the call graph\n");
+            return NULL;
+        }
+        ctx->has_cg = 1;
+    }
+    return &ctx->cg;
+}
+
+// PLT map and address index, empty ones if out of memory
+static void get_names(struct run_ctx *ctx)
+{
+    if (ctx->has_names)
+        return;
+    if (plt_map_build(&ctx->plt, ctx->bin)
+        || dataidx_build(&ctx->data, ctx->bin))
+        fprintf(stderr, "[-] Out of memory indexing addresses\n");
+    ctx->has_names = 1;
+}
+
+// Imports first, they have no symbol of their own in the file
+static int target_label(char *buf, size_t cap, uint64_t target, void *data)
+{
+    struct run_ctx *ctx = data;
+    return plt_label(buf, cap, target, &ctx->plt)
+        || dataidx_label(&ctx->data, target, buf, cap);
+}
+
+// ET_REL targets: operands are placeholders, print what will patch them.
+// Linked ones: name the calls and loads going through the PLT / GOT.
+static void disas_sym(struct run_ctx *ctx, const struct sym_info *sym)
+{
+    int rel = ctx->bin->ehdr->e_type == ET_REL;
+    if (rel && !ctx->has_rel)
+    {
+        if (reloc_index_build(&ctx->rel, ctx->bin, ctx->bin->text_index))
+            fprintf(stderr, "[-] Out of memory indexing relocations\n");
+        ctx->has_rel = 1;
+    }
+    if (!rel)
+        get_names(ctx);
+    printf("x86 disassembly of symbol %s\n", sym->name);
+    struct reloc_cursor c = reloc_seek(&ctx->rel, sym->addr);
+    struct disas_hooks h = { ctx->rel.n ? reloc_note : NULL, &c,
+                             rel ? NULL : target_label, ctx };
+    fdisas_notes(stdout, sym->bytes, sym->size, sym->addr, &h);
+}
+
+static void cost_notes_fn(FILE *out, const struct cfg *cfg, uint32_t block,
+                          void *data)
+{
+    struct cost_notes *n = data;
+    loops_note(out, cfg, block, (void *)n->li);
+    cost_note(out, cfg, block, (void *)n->u);
+}
+
+static void print_cfg(struct arena *a, const struct sym_info *s,
+                      enum cfg_view view, const struct uarch *u)
+{
+    struct cfg *cfg = cfg_build(a, s->bytes, s->size, s->addr);
+    struct loop_info *li =
+        cfg && view != VIEW_CFG ? loops_build(a, cfg) : NULL;
+
+    printf("Control flow graph of symbol %s\n", s->name);
+    if (!cfg || (view != VIEW_CFG && !li))
+        fprintf(stderr, "[-] Out of memory building the CFG of %s\n",
+                s->name);
+    else if (view == VIEW_COST)
+    {
+        struct cost_notes n = { li, u };
+        loops_print(stdout, cfg, li);
+        cost_print_loops(stdout, u, cfg, li);
+        cfg_print_notes(stdout, cfg, cost_notes_fn, &n);
+    }
+    else if (view == VIEW_LOOPS)
+    {
+        loops_print(stdout, cfg, li);
+        cfg_print_notes(stdout, cfg, loops_note, li);
+    }
+    else
+        cfg_print(stdout, cfg);
+    arena_reset(a);
+}
+
+// --cfg/--loops/--cost (+optional symbol), returns the number of arguments
+// used
+static int run_cfg(struct run_ctx *ctx, int argc, char **argv)
+{
+    const struct sym_list *lst = &ctx->bin->syms;
+    struct arena a;
+    int used = argc > 1 && !is_arg(argv[1]);
+    enum cfg_view view = strcmp(argv[0], CFG) == 0 ? VIEW_CFG
+        : strcmp(argv[0], LOOPS) == 0              ? VIEW_LOOPS
+                                                   : VIEW_COST;
+
+    if (!ctx->uarch)
+        ctx->uarch = uarch_find(COST_DEFAULT_UARCH);
+
+    arena_init(&a, 0);
+    if (used)
+    {
+        uint32_t id = symidx_find(lst, argv[1]);
+        if (id == SYM_NONE)
+            fprintf(stderr, "[-] No .text symbol named %s\n", argv[1]);
+        else
+            print_cfg(&a, &lst->items[id], view, ctx->uarch);
+    }
+    else
+        for (size_t j = 0; j < lst->count; j++)
+            print_cfg(&a, &lst->items[j], view, ctx->uarch);
+    arena_free(&a);
+
+    return used;
+}
+
+// --align (+optional symbol), returns the number of arguments used
+static int run_align(struct run_ctx *ctx, int argc, char **argv)
+{
+    const struct sym_list *lst = &ctx->bin->syms;
+    struct align_report r;
+    int used = argc > 1 && !is_arg(argv[1]);
+    int ret = 0;
+
+    align_init(&r);
+    printf("Alignment report (entries / loop heads below %d bytes, "
+           "branches hit by the %d-byte JCC erratum)\n",
+           ALIGN_WANT, JCC_BOUNDARY);
+    if (used)
+    {
+        uint32_t id = symidx_find(lst, argv[1]);
+        if (id == SYM_NONE)
+            fprintf(stderr, "[-] No .text symbol named %s\n", argv[1]);
+        else
+            ret = align_func(stdout, &r, &lst->items[id]);
+    }
+    else
+        for (size_t j = 0; j < lst->count && !ret; j++)
+            ret = align_func(stdout, &r, &lst->items[j]);
+
+    if (ret)
+        fprintf(stderr, "[-] Out of memory in %s\n", ALIGN);
+    else
+        align_summary(stdout, &r);
+    align_free(&r);
+    return ret ? -1 : used;
+}
+
+// --profile samples / --layout samples [order file]
+static int run_profile(struct run_ctx *ctx, int argc, char **argv)
+{
+    const struct sym_list *lst = &ctx->bin->syms;
+    int layout = strcmp(argv[0], LAYOUT) == 0;
+    const char *order = layout && argc > 2 && !is_arg(argv[2]) ? argv[2]
+                                                               : NULL;
+    struct callgraph *cg = layout ? get_callgraph(ctx) : NULL;
+    struct profile prof;
+    struct sym_index idx;
+    int ret = 0;
+
+    if ((layout && !cg) || profile_load(&prof, argv[1], lst))
+        return -1;
+    if (symidx_build(&idx, lst))
+    {
+        fprintf(stderr, "[-] Out of memory indexing symbols\n");
+        profile_free(&prof);
+        return -1;
+    }
+    if (layout)
+        ret = layout_report(stdout, &prof, lst, &idx, cg, order);
+    else
+        profile_print(stdout, &prof, lst, &idx);
+    symidx_free(&idx);
+    profile_free(&prof);
+    return ret ? -1 : 1 + (order != NULL);
+}
+
+// --strings [min_len] [xref], returns the number of arguments used
+static int run_strings(struct run_ctx *ctx, int argc, char **argv)
+{
+    size_t min_len = STRSCAN_MIN_LEN;
+    int xrefs = 0;
+    int used = 0;
+
+    if (used + 1 < argc && argv[used + 1][0] >= '0'
+        && argv[used + 1][0] <= '9')
+        min_len = strtoull(argv[++used], NULL, 0);
+    if (used + 1 < argc && strcmp(argv[used + 1], "xref") == 0)
+    {
+        xrefs = 1;
+        used++;
+    }
+    if (xrefs)
+        get_names(ctx);
+    if (strings_print(stdout, ctx->bin, min_len, xrefs, &ctx->data))
+        return -1;
+    return used;
+}
+
+// Run a long option, returns the number of option arguments used or -1
+static int run_long_arg(struct run_ctx *ctx, int argc, char **argv)
+{
+    const struct sym_list *lst = &ctx->bin->syms;
+
+    if (strcmp(argv[0], CFG) == 0 || strcmp(argv[0], LOOPS) == 0
+        || strcmp(argv[0], COST) == 0)
+        return run_cfg(ctx, argc, argv);
+    if (strcmp(argv[0], ALIGN) == 0)
+        return run_align(ctx, argc, argv);
+    if (strcmp(argv[0], STRINGS) == 0)
+        return run_strings(ctx, argc, argv);
+
+    if (argc < 2 || is_arg(argv[1]))
+    {
+        fprintf(stderr, "[-] %s: missing argument\n", argv[0]);
+        return -1;
+    }
+
+    if (strcmp(argv[0], UARCH) == 0)
+    {
+        if (!(ctx->uarch = uarch_find(argv[1])))
+        {
+            fprintf(stderr, "[-] Unknown cost model %s\n", argv[1]);
+            uarch_list(stderr);
+            return -1;
+        }
+        return 1;
+    }
+
+    if (strcmp(argv[0], PROFILE) == 0 || strcmp(argv[0], LAYOUT) == 0)
+        return run_profile(ctx, argc, argv);
+
+    struct callgraph *cg = get_callgraph(ctx);
+    if (!cg)
+        return -1;
+
+    if (strcmp(argv[0], CALLGRAPH) == 0)
+    {
+        if (strcmp(argv[1], "dot") == 0)
+        {
+            cg_print_dot(stdout, cg, lst);
+            return 1;
+        }
+        if (strcmp(argv[1], "bin") == 0 && argc > 2)
+        {
+            if (cg_write(argv[2], cg, lst))
+                return -1;
+            printf("[+] Call graph (%zu functions, %zu edges, %zu call sites, "
+                   "%zu unresolved) written to %s\n",
+                   cg->n_nodes, cg->n_edges, cg->n_sites, cg->n_unresolved,
+                   argv[2]);
+            return 2;
+        }
+        fprintf(stderr, "[-] %s: expected dot or bin file\n", CALLGRAPH);
+        return -1;
+    }
+
+    uint32_t id = symidx_find(lst, argv[1]);
+    if (id == SYM_NONE)
+    {
+        fprintf(stderr, "[-] No .text symbol named %s\n", argv[1]);
         return 1;
     }
+    if (strcmp(argv[0], CALLERS) == 0)
+        cg_print_callers(stdout, cg, lst, id);
+    else
+        cg_print_callees(stdout, cg, lst, id);
+    return 1;
+}
 
-    // Load file & assert ELF
-    char *target_bin = argv[1];
-    struct file *f = file_map(target_bin);
-    if (!f)
+static int run_diff(int argc, char **argv)
+{
+    if (argc != 4)
     {
-        fprintf(stderr,
-                "[-] Failed to parse file argument (file does not exist)\n");
+        fprintf(stderr, "[-] Usage: ./%s %s old.elf new.elf\n", TARGET,
+                DIFF_MODE);
         return 1;
     }
-    if (!is_elf(f))
+
+    struct elf_bin *old_bin = load_target(argv[2], IO_MMAP);
+    struct elf_bin *new_bin = old_bin ? load_target(argv[3], IO_MMAP) : NULL;
+    int ret = 1;
+    if (old_bin && new_bin)
+        ret = bin_diff(stdout, old_bin, new_bin) == 0 ? 0 : 1;
+
+    elf_free(&old_bin);
+    elf_free(&new_bin);
+    return ret;
+}
+
+static int run_fingerprint(int argc, char **argv)
+{
+    if (argc < 4)
     {
-        fprintf(stderr, "[-] File is not of ELF format, can't parse\n");
-        file_unmap(&f);
+        fprintf(stderr, "[-] Usage: ./%s %s index.fp binary...\n", TARGET,
+                FPRINT_MODE);
         return 1;
     }
 
-    // Collect file info
-    Elf64_Ehdr *ehdr = get_ehdr(f->content);
-    Elf64_Phdr *phdrs = get_phdrs(f->content, ehdr);
-    Elf64_Shdr *shdrs = get_shdrs(f->content, ehdr);
+    return fp_write_index(argv[2], argv + 3, argc - 3) == 0 ? 0 : 1;
+}
 
-    if (!ehdr || !phdrs || !shdrs)
+static int run_query(int argc, char **argv)
+{
+    if (argc != 4 && argc != 5)
     {
-        fprintf(stderr, "[-] Missing required headers for ELF parsing\n");
-        file_unmap(&f);
+        fprintf(stderr, "[-] Usage: ./%s %s index.fp binary [min_similarity]\n",
+                TARGET, QUERY_MODE);
         return 1;
     }
 
-    // Collect important ELF sections
-    struct impsec *impsec = get_impsec(f->content, ehdr);
-    if (!impsec)
+    double min_sim = argc == 5 ? strtod(argv[4], NULL) : FP_MIN_SIM;
+    struct elf_bin *bin = load_target(argv[3], IO_MMAP);
+    if (!bin)
+        return 1;
+
+    int ret = fp_query(stdout, argv[2], bin, min_sim) == 0 ? 0 : 1;
+    elf_free(&bin);
+    return ret;
+}
+
+static int run_addr2sym(int argc, char **argv)
+{
+    if (argc != 3 && argc != 4)
+    {
+        fprintf(stderr, "[-] Usage: ./%s %s binary [addresses]\n", TARGET,
+                A2S_MODE);
+        return 1;
+    }
+
+    FILE *in = argc == 4 ? fopen(argv[3], "r") : stdin;
+    if (!in)
     {
-        fprintf(stderr, "[-] Failed to extract important sections\n");
-        file_unmap(&f);
+        perror("Cannot open the addresses file");
         return 1;
     }
 
-    // Resolve & map text section into a wrapper
-    size_t text_index = impsec->text - shdrs; // Calculate .text's index
-    struct sec *text_sec = NULL;
+    struct elf_bin *bin = load_target(argv[2], IO_MMAP);
+    int ret = bin && addr2sym(stdout, in, bin) == 0 ? 0 : 1;
+    elf_free(&bin);
+    if (in != stdin)
+        fclose(in);
+    return ret;
+}
 
-    if (!impsec->text)
+static int run_repl(int argc, char **argv)
+{
+    if (argc != 3)
     {
-        puts("[-] No .text section found");
-        free(impsec);
-        file_unmap(&f);
+        fprintf(stderr, "[-] Usage: ./%s %s binary\n", TARGET, REPL_MODE);
         return 1;
     }
 
-    text_sec = sec_resolve(f, impsec->text);
-    struct sym_list lst =
-        get_text_funcs(f->content, impsec, text_index, f->size);
-    if (!text_sec)
+    struct elf_bin *bin = load_target(argv[2], IO_MMAP);
+    struct repl r;
+    int ret = 1;
+    if (bin && repl_init(&r, bin) == 0)
     {
-        fprintf(stderr, "[-] Failed to retrieve text section or its symbols\n");
+        ret = repl_run(&r, stdin, stdout);
+        repl_free(&r);
     }
+    else if (bin)
+        fprintf(stderr, "[-] Out of memory indexing %s\n", argv[2]);
+    elf_free(&bin);
+    return ret;
+}
+
+static int run_batch(int argc, char **argv, enum io_backend io)
+{
+    struct batch_opts opts = { NULL, 0, io };
+    int i = 2;
+
+    for (; i + 1 < argc; i += 2)
+    {
+        if (strcmp(argv[i], "-j") == 0)
+            opts.n_threads = strtoull(argv[i + 1], NULL, 0);
+        else if (strcmp(argv[i], "-o") == 0)
+            opts.out_dir = argv[i + 1];
+        else
+            break;
+    }
+    if (i >= argc)
+    {
+        fprintf(stderr, "[-] Usage: ./%s %s [-j threads] [-o out_dir] "
+                        "file_or_dir...\n",
+                TARGET, BATCH_MODE);
+        return 1;
+    }
+    return batch_run(&opts, argv + i, argc - i) == 0 ? 0 : 1;
+}
+
+static int run_memory(int argc, char **argv)
+{
+    int pid = strcmp(argv[1], PID_MODE) == 0;
+    if (argc != 3 && argc != 4)
+    {
+        fprintf(stderr, "[-] Usage: ./%s %s %s [symbol]\n", TARGET, argv[1],
+                pid ? "pid" : "core_file");
+        return 1;
+    }
+    struct mem_image img = { NULL, 0, 0 };
+    int err = pid ? mem_from_pid(&img, strtol(argv[2], NULL, 0))
+                  : mem_from_core(&img, argv[2]);
+    size_t n = err ? 0 : mem_disas(stdout, &img, argc == 4 ? argv[3] : NULL);
+    if (!err)
+        fprintf(stderr, "[+] %zu executable regions, %zu functions\n", img.n,
+                n);
+    mem_image_free(&img);
+    return err ? 1 : 0;
+}
+
+static int run_raw(int argc, char **argv, enum io_backend io)
+{
+    uint64_t base = 0;
+    int hex = 0;
+    int i = 3;
+
+    for (; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--base") == 0 && i + 1 < argc)
+            base = strtoull(argv[++i], NULL, 0);
+        else if (strcmp(argv[i], "--hex") == 0)
+            hex = 1;
+        else
+            break;
+    }
+    if (argc < 3 || i < argc)
+    {
+        fprintf(stderr, "[-] Usage: ./%s %s file [--base addr] [--hex]\n",
+                TARGET, RAW_MODE);
+        return 1;
+    }
+    struct raw_stats st;
+    if (raw_disas(stdout, argv[2], base, hex, io, &st))
+        return 1;
+    fprintf(stderr, "[+] %zu bytes, %zu instructions, %zu undecodable\n",
+            st.bytes, st.ins, st.bad);
+    return 0;
+}
+
+static int run_stream(int argc, char **argv)
+{
+    if (argc > 3 || (argc == 3 && strcmp(argv[2], "-d") != 0))
+    {
+        fprintf(stderr, "[-] Usage: ./%s %s [-d] < elf, only whole "
+                        "segment disassembly works on a stream\n",
+                TARGET, STDIN_TARGET);
+        return 1;
+    }
+    struct stream_stats st;
+    int ret = stream_disas(stdout, stdin, &st);
+    fprintf(stderr,
+            "[+] %zu executable segments, %" PRIu64 " of %" PRIu64
+            " bytes decoded\n",
+            st.segments, st.code, st.bytes);
+    return ret == 0 ? 0 : 1;
+}
+
+static int run_triage(int argc, char **argv)
+{
+    if (argc < 3)
+    {
+        fprintf(stderr, "[-] Usage: ./%s %s file_or_dir...\n", TARGET,
+                TRIAGE_MODE);
+        return 1;
+    }
+    struct triage_stats st;
+    int ret = triage(stdout, argv + 2, argc - 2, &st);
+    fprintf(stderr,
+            "[+] %zu files, %zu ELF, %zu malformed, %zu with W+X segments, "
+            "%zu without NX stack, %zu without RELRO\n",
+            st.files, st.elfs, st.bad, st.wx, st.no_nx, st.no_relro);
+    return ret == 0 ? 0 : 1;
+}
+
+int main(int argc, char **argv)
+{
+    enum io_backend io = IO_MMAP;
+    int show_rss = argc > 2 && strcmp(argv[1], IO_OPT) == 0;
+    if (show_rss)
+    {
+        if (io_backend_parse(argv[2], &io))
+        {
+            fprintf(stderr, "[-] Unknown I/O backend %s, expected %s\n",
+                    argv[2], io_backend_names());
+            return 1;
+        }
+        argv[2] = argv[0];
+        argv += 2;
+        argc -= 2;
+    }
+    if (argc > 1 && strcmp(argv[1], DIFF_MODE) == 0)
+        return run_diff(argc, argv);
+    if (argc > 1 && strcmp(argv[1], FPRINT_MODE) == 0)
+        return run_fingerprint(argc, argv);
+    if (argc > 1 && strcmp(argv[1], QUERY_MODE) == 0)
+        return run_query(argc, argv);
+    if (argc > 1 && strcmp(argv[1], A2S_MODE) == 0)
+        return run_addr2sym(argc, argv);
+    if (argc > 1 && strcmp(argv[1], REPL_MODE) == 0)
+        return run_repl(argc, argv);
+    if (argc > 1 && strcmp(argv[1], BATCH_MODE) == 0)
+    {
+        int ret = run_batch(argc, argv, io);
+        if (show_rss)
+            fprintf(stderr, "[+] Peak RSS %ld KB\n", io_peak_rss_kb());
+        return ret;
+    }
+    if (argc > 1 && strcmp(argv[1], TRIAGE_MODE) == 0)
+        return run_triage(argc, argv);
+    if (argc > 1 && strcmp(argv[1], STDIN_TARGET) == 0)
+        return run_stream(argc, argv);
+    if (argc > 1 && strcmp(argv[1], RAW_MODE) == 0)
+        return run_raw(argc, argv, show_rss ? io : IO_MMAP_SEQ);
+    if (argc > 1
+        && (strcmp(argv[1], PID_MODE) == 0 || strcmp(argv[1], CORE_MODE) == 0))
+        return run_memory(argc, argv);
+    if (argc > 1 && strcmp(argv[1], WATCH_MODE) == 0)
+    {
+        if (argc != 3 && argc != 4)
+        {
+            fprintf(stderr, "[-] Usage: ./%s %s binary [max_rebuilds]\n",
+                    TARGET, WATCH_MODE);
+            return 1;
+        }
+        size_t max = argc == 4 ? strtoull(argv[3], NULL, 0) : 0;
+        return watch(stdout, argv[2], max) == 0 ? 0 : 1;
+    }
+    if (argc > 1 && strcmp(argv[1], SERVE_MODE) == 0)
+    {
+        if (argc != 3)
+        {
+            fprintf(stderr, "[-] Usage: ./%s %s socket\n", TARGET,
+                    SERVE_MODE);
+            return 1;
+        }
+        return serve(argv[2]) == 0 ? 0 : 1;
+    }
+
+    // Ensure correct usage
+    if (argc < ARGS_MIN || argc > ARGS_MAX)
+    {
+        fprintf(
+            stderr,
+            "[-] Usage: ./%s [--io backend] target_program [options...]\n"
+            "Options=-d(+optional symbol), -f, -h, -x(+optional section), "
+            "--callgraph dot|bin file, --callers symbol, --callees symbol, "
+            "--cfg(+optional symbol), --loops(+optional symbol), "
+            "--cost(+optional symbol), --uarch name, "
+            "--align(+optional symbol), --profile samples, "
+            "--layout samples [order_file], --strings [min_len] [xref]\n"
+            "       ./%s %s old.elf new.elf\n"
+            "       ./%s %s index.fp binary...\n"
+            "       ./%s %s index.fp binary [min_similarity]\n"
+            "       ./%s %s binary [addresses]\n"
+            "       ./%s %s socket\n"
+            "       ./%s %s binary\n"
+            "       ./%s %s binary [max_rebuilds]\n"
+            "       ./%s [--io backend] %s [-j threads] [-o out_dir] "
+            "file_or_dir...\n"
+            "       ./%s %s file_or_dir...\n"
+            "       ./%s %s [-d] < elf\n"
+            "       ./%s %s pid [symbol]\n"
+            "       ./%s %s core_file [symbol]\n"
+            "       ./%s [--io backend] %s file [--base addr] [--hex]\n"
+            "Backends=%s\n",
+            TARGET, TARGET, DIFF_MODE, TARGET, FPRINT_MODE, TARGET,
+            QUERY_MODE, TARGET, A2S_MODE, TARGET, SERVE_MODE, TARGET,
+            REPL_MODE, TARGET, WATCH_MODE, TARGET, BATCH_MODE, TARGET,
+            TRIAGE_MODE, TARGET, STDIN_TARGET, TARGET, PID_MODE, TARGET,
+            CORE_MODE, TARGET, RAW_MODE, io_backend_names());
+        return 1;
+    }
+
+    // Load file, assert ELF & collect .text functions
+    struct run_ctx ctx = { 0 };
+    if (!(ctx.bin = load_target(argv[1], io)))
+        return 1;
+
+    Elf64_Ehdr *ehdr = ctx.bin->ehdr;
+    void *content = ctx.bin->f->content;
+    struct sym_list lst = ctx.bin->syms;
 
     // Handle args & run program
     int i = 2;
     while (i < argc)
     {
-        if (is_arg(argv[i]))
+        if (is_long_arg(argv[i]))
+        {
+            int used = run_long_arg(&ctx, argc - i, argv + i);
+            if (used < 0)
+                break;
+            i += used;
+        }
+        else if (is_arg(argv[i]))
         {
             char opt = (char)argv[i][1];
             switch (opt)
@@ -117,10 +741,7 @@ int main(int argc, char **argv)
                         if (strcmp(sym_info->name, argv[i + 1])
                             == 0) // .text symbol matched
                         {
-                            printf("x86 disassembly of symbol %s\n",
-                                   sym_info->name);
-                            disas((uint8_t *)sym_info->bytes, sym_info->size,
-                                  (uint64_t)sym_info->addr);
+                            disas_sym(&ctx, sym_info);
                             break;
                         }
                     }
@@ -129,21 +750,15 @@ int main(int argc, char **argv)
                 else
                 {
                     for (size_t j = 0; j < lst.count; j++)
-                    {
-                        struct sym_info *sym_info = &lst.items[j];
-                        printf("x86 disassembly of symbol %s\n",
-                               sym_info->name);
-                        disas((uint8_t *)sym_info->bytes, sym_info->size,
-                              (uint64_t)sym_info->addr);
-                    }
+                        disas_sym(&ctx, &lst.items[j]);
                 }
                 break;
             case F_INFO:
                 print_Ehdr(ehdr);
                 break;
             case F_HEADERS:
-                print_Phdrs(f->content, ehdr);
-                print_Shdrs(f->content, ehdr);
+                print_Phdrs(content, ehdr);
+                print_Shdrs(content, ehdr);
                 break;
             case HEXDUMP:
                 if (i + 1 < argc && !is_arg(argv[i + 1]))
@@ -182,18 +797,13 @@ int main(int argc, char **argv)
         i++;
     }
 
-    // for (size_t i = 0; i < lst.count; i++)
-    //     if (strcmp(lst.items[i].name, "mult") == 0
-    //         || strcmp(lst.items[i].name, "divide") == 0)
-    //     {
-    //         printf("x86 disas of symbol %s\n", lst.items[i].name);
-    //         disas((uint8_t *)lst.items[i].bytes, lst.items[i].size,
-    //               (uint64_t)lst.items[i].addr);
-    //     }
-
-    free_symlist(lst);
-    free(impsec);
-    free(text_sec);
-    file_unmap(&f);
+    if (ctx.has_cg)
+        cg_free(&ctx.cg);
+    reloc_index_free(&ctx.rel);
+    plt_map_free(&ctx.plt);
+    dataidx_free(&ctx.data);
+    elf_free(&ctx.bin);
+    if (show_rss)
+        fprintf(stderr, "[+] Peak RSS %ld KB\n", io_peak_rss_kb());
     return 0;
 }
@@ -2,6 +2,8 @@
 #include "include/parse_elf.h"
 
 #include <elf.h>
+#include <errno.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -39,7 +41,7 @@ struct impsec *get_impsec(void *buf, Elf64_Ehdr *ehdr)
     if (ehdr->e_shnum <= 0)
         return NULL;
 
-    struct impsec *sec = malloc(sizeof(struct impsec));
+    struct impsec *sec = calloc(1, sizeof(struct impsec));
     if (!sec)
         return NULL;
 
@@ -57,8 +59,13 @@ struct impsec *get_impsec(void *buf, Elf64_Ehdr *ehdr)
             && (sh_cur->sh_flags & SHF_EXECINSTR)
             && strcmp(section_name, ".text") == 0)
             sec->text = sh_cur;
+        if (sh_cur->sh_type == SHT_GNU_versym)
+            sec->versym = sh_cur;
 
-        if (sh_cur->sh_type == SHT_SYMTAB)
+        // Prefer .symtab, stripped binaries still have .dynsym
+        if (sh_cur->sh_type == SHT_SYMTAB
+            || (sh_cur->sh_type == SHT_DYNSYM
+                && (!sec->symtab || sec->symtab->sh_type != SHT_SYMTAB)))
         {
             sec->symtab = sh_cur;
 
@@ -80,6 +87,11 @@ struct sec *sec_resolve(struct file *f, Elf64_Shdr *shdr)
     if (!sec)
         return NULL;
 
+    if (file_need(f, shdr->sh_offset, shdr->sh_size))
+    {
+        free(sec);
+        return NULL;
+    }
     sec->addr = (void *)((char *)f->content + shdr->sh_offset);
     sec->size = shdr->sh_size;
     sec->entsize = shdr->sh_entsize;
@@ -87,6 +99,87 @@ struct sec *sec_resolve(struct file *f, Elf64_Shdr *shdr)
     return sec;
 }
 
+// Version of .dynsym entry i is hidden: a non default foo@VER alias
+static int sym_hidden(const void *buf, const struct impsec *impsec, size_t i,
+                      size_t file_size)
+{
+    const Elf64_Shdr *v = impsec->versym;
+    Elf64_Versym ver;
+    if (!v || v->sh_offset > file_size || (i + 1) * sizeof(ver) > v->sh_size
+        || v->sh_offset + (i + 1) * sizeof(ver) > file_size)
+        return 0;
+    memcpy(&ver, (const char *)buf + v->sh_offset + i * sizeof(ver),
+           sizeof(ver));
+    return (ver & 0x8000) != 0; // VERSYM_HIDDEN
+}
+
+/*
+ * .dynsym lists each versioned alias (foo@VER_1, foo@@VER_2) as its own
+ * entry, all at one address: keep one function per address and size,
+ * the default version when there is one. Order is kept.
+ */
+static size_t dedupe_aliases(struct sym_info *funcs, uint8_t *hidden,
+                             size_t n)
+{
+    uint64_t *key = malloc((n + 1) * sizeof(*key));
+    uint64_t *ktmp = malloc((n + 1) * sizeof(*ktmp));
+    uint32_t *id = malloc((n + 1) * sizeof(*id));
+    uint32_t *vtmp = malloc((n + 1) * sizeof(*vtmp));
+    uint8_t *drop = calloc(n + 1, 1);
+    if (!key || !ktmp || !id || !vtmp || !drop)
+    {
+        free(key);
+        free(ktmp);
+        free(id);
+        free(vtmp);
+        free(drop);
+        return n; // Duplicates are only wasted work
+    }
+
+    for (size_t i = 0; i < n; i++)
+    {
+        key[i] = funcs[i].addr;
+        id[i] = i;
+    }
+    radix_sort_kv(key, id, ktmp, vtmp, n);
+    for (size_t i = 0; i < n;)
+    {
+        size_t end = i + 1;
+        while (end < n && key[end] == key[i])
+            end++;
+        // Same address: pick per size, first default version else first
+        for (size_t a = i; a < end; a++)
+        {
+            if (drop[id[a]])
+                continue;
+            size_t keep = a;
+            for (size_t b = a + 1; b < end; b++)
+                if (funcs[id[b]].size == funcs[id[a]].size && hidden[id[keep]]
+                    && !hidden[id[b]])
+                    keep = b;
+            for (size_t b = a; b < end; b++)
+                if (b != keep && funcs[id[b]].size == funcs[id[a]].size)
+                    drop[id[b]] = 1;
+        }
+        i = end;
+    }
+
+    size_t j = 0;
+    for (size_t i = 0; i < n; i++)
+    {
+        if (drop[i])
+            free(funcs[i].name);
+        else
+            funcs[j++] = funcs[i];
+    }
+    free(key);
+    free(ktmp);
+    free(id);
+    free(vtmp);
+    free(drop);
+    return j;
+}
+
 struct sym_list get_text_funcs(void *buf, struct impsec *impsec,
                                size_t text_index, size_t file_size)
 {
@@ -111,8 +204,13 @@ struct sym_list get_text_funcs(void *buf, struct impsec *impsec,
         return out;
 
     struct sym_info *funcs = calloc(fun_count, sizeof(*funcs));
-    if (!funcs)
+    int dynsym = impsec->symtab->sh_type == SHT_DYNSYM;
+    uint8_t *hidden = dynsym ? calloc(fun_count, 1) : NULL;
+    if (!funcs || (dynsym && !hidden))
+    {
+        free(funcs);
         return out;
+    }
 
     size_t j = 0;
     for (size_t i = 0; i < sym_count; i++)
@@ -136,10 +234,127 @@ struct sym_list get_text_funcs(void *buf, struct impsec *impsec,
         funcs[j].addr = s->st_value;
         funcs[j].size = s->st_size;
         funcs[j].bytes = (unsigned char *)buf + off;
+        if (dynsym)
+            hidden[j] = sym_hidden(buf, impsec, i, file_size);
         j++;
     }
+    if (dynsym)
+        j = dedupe_aliases(funcs, hidden, j);
+    free(hidden);
 
     out.items = funcs;
     out.count = j; // may be <= fun_count if some failed bounds
     return out;
 }
+
+struct elf_bin *elf_load(const char *path)
+{
+    return elf_load_io(path, IO_MMAP);
+}
+
+struct elf_bin *elf_load_io(const char *path, enum io_backend backend)
+{
+    struct elf_bin *bin = calloc(1, sizeof(struct elf_bin));
+    int err = ENOEXEC;
+    if (!bin)
+        return NULL;
+
+    if (!(bin->f = file_open(path, backend)))
+    {
+        err = errno == ENODATA ? ENOEXEC : errno; // Empty is just not an ELF
+        goto error_map;
+    }
+
+    bin->ehdr = get_ehdr(bin->f->content);
+    bin->shdrs = get_shdrs(bin->f->content, bin->ehdr);
+    if (!(bin->impsec = get_impsec(bin->f->content, bin->ehdr)))
+    {
+        err = bin->ehdr->e_shnum ? ENOMEM : ENOEXEC;
+        goto error_impsec;
+    }
+    if (!bin->impsec->text)
+    {
+        err = ENODATA;
+        goto error_text;
+    }
+
+    // IO_SELECT: only what get_text_funcs reads, never .debug_*
+    struct impsec *imp = bin->impsec;
+    if ((imp->symtab
+         && file_need(bin->f, imp->symtab->sh_offset, imp->symtab->sh_size))
+        || (imp->versym
+            && file_need(bin->f, imp->versym->sh_offset, imp->versym->sh_size))
+        || (imp->strtab
+            && file_need(bin->f, imp->strtab->sh_offset, imp->strtab->sh_size))
+        || file_need(bin->f, imp->text->sh_offset, imp->text->sh_size))
+    {
+        err = errno;
+        goto error_text;
+    }
+
+    bin->text_index = bin->impsec->text - bin->shdrs;
+    bin->syms = get_text_funcs(bin->f->content, bin->impsec, bin->text_index,
+                               bin->f->size);
+    return bin;
+
+error_text:
+    free(bin->impsec);
+error_impsec:
+    file_unmap(&bin->f);
+error_map:
+    free(bin);
+    errno = err;
+    return NULL;
+}
+
+const char *elf_strerror(int err)
+{
+    if (err == ENOEXEC)
+        return "not an ELF64 file with section headers";
+    if (err == ENODATA)
+        return "no .text section";
+    return strerror(err);
+}
+
+const char *elf_section_name(const struct elf_bin *bin,
+                             const Elf64_Shdr *shdr)
+{
+    const Elf64_Shdr *shstr = &bin->shdrs[bin->ehdr->e_shstrndx];
+    if (bin->ehdr->e_shstrndx >= bin->ehdr->e_shnum
+        || shstr->sh_offset + shdr->sh_name >= bin->f->size)
+        return NULL;
+    return (const char *)bin->f->content + shstr->sh_offset + shdr->sh_name;
+}
+
+Elf64_Shdr *elf_section(const struct elf_bin *bin, const char *name)
+{
+    for (Elf64_Half i = 0; i < bin->ehdr->e_shnum; i++)
+    {
+        const char *cur = elf_section_name(bin, &bin->shdrs[i]);
+        if (cur && strcmp(cur, name) == 0)
+            return &bin->shdrs[i];
+    }
+    return NULL;
+}
+
+const void *elf_section_data(const struct elf_bin *bin,
+                             const Elf64_Shdr *shdr)
+{
+    if (shdr->sh_type == SHT_NOBITS || shdr->sh_offset > bin->f->size
+        || shdr->sh_size > bin->f->size - shdr->sh_offset
+        || file_need(bin->f, shdr->sh_offset, shdr->sh_size))
+        return NULL;
+    return (const char *)bin->f->content + shdr->sh_offset;
+}
+
+void elf_free(struct elf_bin **bin)
+{
+    if (!*bin)
+        return;
+
+    free_symlist((*bin)->syms);
+    free((*bin)->impsec);
+    file_unmap(&(*bin)->f);
+    free(*bin);
+    *bin = NULL;
+}
@@ -0,0 +1,223 @@
+#include "include/plt.h"
+
+#include <elf.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PLT_ENTSIZE 16 // When the section does not say
+
+struct plt_builder
+{
+    uint64_t *addr;
+    char **name;
+    size_t n;
+    size_t cap;
+};
+
+static int push(struct plt_builder *b, uint64_t addr, const char *sym,
+                const char *suffix)
+{
+    if (b->n == b->cap)
+    {
+        size_t cap = b->cap ? 2 * b->cap : 64;
+        uint64_t *addr_new = realloc(b->addr, cap * sizeof(*addr_new));
+        if (!addr_new)
+            return -1;
+        b->addr = addr_new;
+        char **name_new = realloc(b->name, cap * sizeof(*name_new));
+        if (!name_new)
+            return -1;
+        b->name = name_new;
+        b->cap = cap;
+    }
+    size_t len = strlen(sym) + strlen(suffix) + 1;
+    if (!(b->name[b->n] = malloc(len)))
+        return -1;
+    strcpy(b->name[b->n], sym);
+    strcat(b->name[b->n], suffix);
+    b->addr[b->n++] = addr;
+    return 0;
+}
+
+// Slot names, from every RELA section against the dynamic symbol table
+static int add_got(struct plt_builder *b, const struct elf_bin *bin,
+                   size_t dynsym)
+{
+    const Elf64_Shdr *sh = bin->shdrs;
+    const Elf64_Sym *syms = elf_section_data(bin, &sh[dynsym]);
+    size_t n_syms = syms ? sh[dynsym].sh_size / sizeof(Elf64_Sym) : 0;
+    const Elf64_Shdr *strtab = sh[dynsym].sh_link < bin->ehdr->e_shnum
+        ? &sh[sh[dynsym].sh_link]
+        : NULL;
+    const char *str = strtab ? elf_section_data(bin, strtab) : NULL;
+    if (!syms || !str)
+        return 0;
+
+    for (Elf64_Half i = 0; i < bin->ehdr->e_shnum; i++)
+    {
+        if (sh[i].sh_type != SHT_RELA || sh[i].sh_link != dynsym
+            || sh[i].sh_entsize != sizeof(Elf64_Rela))
+            continue;
+        const Elf64_Rela *rel = elf_section_data(bin, &sh[i]);
+        size_t n = rel ? sh[i].sh_size / sizeof(Elf64_Rela) : 0;
+        for (size_t r = 0; r < n; r++)
+        {
+            uint32_t type = ELF64_R_TYPE(rel[r].r_info);
+            uint32_t sym = ELF64_R_SYM(rel[r].r_info);
+            if ((type != R_X86_64_JUMP_SLOT && type != R_X86_64_GLOB_DAT)
+                || !sym || sym >= n_syms
+                || syms[sym].st_name >= strtab->sh_size)
+                continue;
+            if (push(b, rel[r].r_offset, str + syms[sym].st_name, "@got"))
+                return -1;
+        }
+    }
+    return 0;
+}
+
+// Order the first n entries by address, names follow their address
+static int sort_entries(struct plt_builder *b, size_t n)
+{
+    uint64_t *ktmp = malloc(n * sizeof(*ktmp) + 1);
+    uint32_t *perm = malloc(n * sizeof(*perm) + 1);
+    uint32_t *vtmp = malloc(n * sizeof(*vtmp) + 1);
+    char **name = malloc(n * sizeof(*name) + 1);
+    int err = !ktmp || !perm || !vtmp || !name ? -1 : 0;
+
+    if (!err)
+    {
+        for (size_t i = 0; i < n; i++)
+            perm[i] = i;
+        radix_sort_kv(b->addr, perm, ktmp, vtmp, n);
+        for (size_t i = 0; i < n; i++)
+            name[i] = b->name[perm[i]];
+        memcpy(b->name, name, n * sizeof(*name));
+    }
+    free(ktmp);
+    free(perm);
+    free(vtmp);
+    free(name);
+    return err;
+}
+
+// The first n_got entries are the slots, sorted by sort_entries()
+static const char *got_name(const struct plt_builder *b, size_t n_got,
+                            uint64_t slot, size_t *len)
+{
+    size_t lo = 0;
+    size_t hi = n_got;
+    while (lo < hi)
+    {
+        size_t mid = lo + (hi - lo) / 2;
+        if (b->addr[mid] < slot)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    if (lo == n_got || b->addr[lo] != slot)
+        return NULL;
+    *len = strlen(b->name[lo]) - strlen("@got");
+    return b->name[lo];
+}
+
+// Each entry jumps through its slot: jmp [rip+disp], maybe bnd / endbr64
+static int add_stubs(struct plt_builder *b, const struct elf_bin *bin,
+                     const Elf64_Shdr *plt, size_t n_got)
+{
+    const uint8_t *code = elf_section_data(bin, plt);
+    size_t ent = plt->sh_entsize >= 6 ? plt->sh_entsize : PLT_ENTSIZE;
+    if (!code)
+        return 0;
+
+    for (size_t e = 0; e + ent <= plt->sh_size; e += ent)
+        for (size_t i = e; i + 6 <= e + ent; i++)
+        {
+            if (code[i] != 0xFF || code[i + 1] != 0x25)
+                continue;
+            int32_t disp;
+            memcpy(&disp, code + i + 2, sizeof(disp));
+            uint64_t slot = plt->sh_addr + i + 6 + (int64_t)disp;
+            size_t len;
+            const char *name = got_name(b, n_got, slot, &len);
+            if (!name)
+                break; // PLT0 or a slot no import owns
+            char sym[len + 1];
+            memcpy(sym, name, len);
+            sym[len] = '\0';
+            if (push(b, plt->sh_addr + e, sym, "@plt"))
+                return -1;
+            break;
+        }
+    return 0;
+}
+
+int plt_map_build(struct plt_map *m, const struct elf_bin *bin)
+{
+    struct plt_builder b = { NULL, NULL, 0, 0 };
+    const Elf64_Shdr *sh = bin->shdrs;
+    int err = 0;
+
+    memset(m, 0, sizeof(*m));
+    for (Elf64_Half i = 0; i < bin->ehdr->e_shnum && !err; i++)
+        if (sh[i].sh_type == SHT_DYNSYM)
+            err = add_got(&b, bin, i);
+    size_t n_got = b.n;
+    if (!err)
+        err = sort_entries(&b, n_got);
+    for (Elf64_Half i = 0; i < bin->ehdr->e_shnum && !err && n_got; i++)
+    {
+        const char *name = elf_section_name(bin, &sh[i]);
+        if (name
+            && (strcmp(name, ".plt") == 0 || strcmp(name, ".plt.sec") == 0
+                || strcmp(name, ".plt.got") == 0))
+            err = add_stubs(&b, bin, &sh[i], n_got);
+    }
+    if (!err)
+        err = sort_entries(&b, b.n);
+
+    if (err)
+    {
+        for (size_t i = 0; i < b.n; i++)
+            free(b.name[i]);
+        free(b.addr);
+        free(b.name);
+        return -1;
+    }
+    m->addr = b.addr;
+    m->name = b.name;
+    m->n = b.n;
+    return 0;
+}
+
+void plt_map_free(struct plt_map *m)
+{
+    for (size_t i = 0; i < m->n; i++)
+        free(m->name[i]);
+    free(m->addr);
+    free(m->name);
+    memset(m, 0, sizeof(*m));
+}
+
+const char *plt_lookup(const struct plt_map *m, uint64_t addr)
+{
+    size_t lo = 0;
+    size_t hi = m->n;
+    while (lo < hi)
+    {
+        size_t mid = lo + (hi - lo) / 2;
+        if (m->addr[mid] < addr)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo < m->n && m->addr[lo] == addr ? m->name[lo] : NULL;
+}
+
+int plt_label(char *buf, size_t cap, uint64_t target, void *map)
+{
+    const char *name = plt_lookup(map, target);
+    if (name)
+        snprintf(buf, cap, "<%s>", name);
+    return name != NULL;
+}
@@ -83,16 +83,21 @@ void print_Shdrs(void *buf, Elf64_Ehdr *ehdr)
 
 // Dump memory byte by byte in hex format
 void hexdump(unsigned char *ptr, size_t size)
+{
+    fhexdump(stdout, ptr, size);
+}
+
+void fhexdump(FILE *out, const unsigned char *ptr, size_t size)
 {
     for (size_t i = 0; i < size; i++)
     {
-        printf("0x%02x", ptr[i]);
+        fprintf(out, "0x%02x", ptr[i]);
         if (i % 10 == 0 && i != 0)
-            putchar('\n');
+            putc('\n', out);
         else
-            putchar('\t');
+            putc('\t', out);
     }
-    putchar('\n');
+    putc('\n', out);
 }
 
 void print_text_funcs(const struct sym_list *lst)
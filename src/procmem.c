@@ -0,0 +1,379 @@
+#define _GNU_SOURCE // process_vm_readv, getline, pread
+
+#include "include/procmem.h"
+#include "include/disas.h"
+#include "include/parse_elf.h"
+#include "include/symidx.h"
+
+#include <elf.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+static struct mem_region *add_region(struct mem_image *img, uint64_t start,
+                                     uint64_t end, uint64_t pgoff,
+                                     const char *path)
+{
+    if (img->n == img->cap)
+    {
+        size_t cap = img->cap ? 2 * img->cap : 16;
+        struct mem_region *r = realloc(img->r, cap * sizeof(*r));
+        if (!r)
+            return NULL;
+        img->r = r;
+        img->cap = cap;
+    }
+    struct mem_region *r = &img->r[img->n];
+    memset(r, 0, sizeof(*r));
+    r->start = start;
+    r->end = end;
+    r->pgoff = pgoff;
+    if ((path && !(r->path = xstrdup(path)))
+        || !(r->bytes = malloc(end - start)))
+    {
+        free(r->path);
+        return NULL;
+    }
+    img->n++;
+    return r;
+}
+
+void mem_image_free(struct mem_image *img)
+{
+    for (size_t i = 0; i < img->n; i++)
+    {
+        free(img->r[i].path);
+        free(img->r[i].bytes);
+    }
+    free(img->r);
+    memset(img, 0, sizeof(*img));
+}
+
+int mem_from_pid(struct mem_image *img, pid_t pid)
+{
+    char maps[64];
+    snprintf(maps, sizeof(maps), "/proc/%d/maps", (int)pid);
+    FILE *f = fopen(maps, "r");
+    if (!f)
+    {
+        perror(maps);
+        return -1;
+    }
+
+    char *line = NULL;
+    size_t cap = 0;
+    int err = 0;
+    while (!err && getline(&line, &cap, f) > 0)
+    {
+        uint64_t start, end, pgoff;
+        char perms[5];
+        int name = 0;
+        if (sscanf(line, "%" SCNx64 "-%" SCNx64 " %4s %" SCNx64 " %*s %*s %n",
+                   &start, &end, perms, &pgoff, &name)
+                < 4
+            || perms[2] != 'x' || end <= start)
+            continue;
+        line[strcspn(line, "\n")] = '\0';
+        const char *path = name && line[name] ? line + name : NULL;
+        if (path && strcmp(path, "[vsyscall]") == 0)
+            continue; // Fixed kernel page, never readable
+
+        struct mem_region *r = add_region(img, start, end, pgoff, path);
+        if (!r)
+        {
+            err = -1;
+            break;
+        }
+        // One call per mapping, whatever the number of functions inside
+        struct iovec local = { r->bytes, end - start };
+        struct iovec remote = { (void *)(uintptr_t)start, end - start };
+        ssize_t n = process_vm_readv(pid, &local, 1, &remote, 1, 0);
+        if (n < 0)
+        {
+            fprintf(stderr, "[-] Cannot read 0x%" PRIx64 "-0x%" PRIx64 ": ",
+                    start, end);
+            perror("process_vm_readv");
+            n = 0;
+        }
+        r->len = n;
+    }
+    free(line);
+    fclose(f);
+    return err;
+}
+
+// NT_FILE: count, page size, count * (start, end, page offset), names
+static const char *nt_file_lookup(const uint8_t *desc, size_t size,
+                                  uint64_t addr, uint64_t *pgoff)
+{
+    uint64_t hdr[2];
+    if (size < sizeof(hdr))
+        return NULL;
+    memcpy(hdr, desc, sizeof(hdr));
+    uint64_t count = hdr[0];
+    if (count > (size - sizeof(hdr)) / (3 * sizeof(uint64_t)))
+        return NULL;
+
+    const char *name = (const char *)desc + sizeof(hdr) + count * 24;
+    const char *end = (const char *)desc + size;
+    for (uint64_t i = 0; i < count && name < end; i++)
+    {
+        uint64_t e[3];
+        memcpy(e, desc + sizeof(hdr) + i * sizeof(e), sizeof(e));
+        if (addr >= e[0] && addr < e[1])
+        {
+            *pgoff = e[2] * hdr[1] + (addr - e[0]);
+            return memchr(name, '\0', end - name) ? name : NULL;
+        }
+        const char *nul = memchr(name, '\0', end - name);
+        if (!nul)
+            return NULL;
+        name = nul + 1;
+    }
+    return NULL;
+}
+
+static int find_nt_file(const struct file *f, const Elf64_Phdr *ph,
+                        size_t phnum, const uint8_t **desc, size_t *size)
+{
+    const uint8_t *buf = f->content;
+    for (size_t i = 0; i < phnum; i++)
+    {
+        if (ph[i].p_type != PT_NOTE || ph[i].p_offset > f->size
+            || ph[i].p_filesz > f->size - ph[i].p_offset)
+            continue;
+        size_t off = ph[i].p_offset;
+        size_t end = off + ph[i].p_filesz;
+        while (off + sizeof(Elf64_Nhdr) <= end)
+        {
+            Elf64_Nhdr n;
+            memcpy(&n, buf + off, sizeof(n));
+            size_t name_len = (n.n_namesz + 3) & ~(size_t)3;
+            size_t desc_off = off + sizeof(n) + name_len;
+            if (desc_off > end || n.n_descsz > end - desc_off)
+                break;
+            if (n.n_type == NT_FILE)
+            {
+                *desc = buf + desc_off;
+                *size = n.n_descsz;
+                return 0;
+            }
+            off = desc_off + ((n.n_descsz + 3) & ~(size_t)3);
+        }
+    }
+    return -1;
+}
+
+// Text the core left out (coredump_filter): same bytes as the module file
+static size_t read_from_disk(const char *path, uint64_t off, uint8_t *dst,
+                             size_t len)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd == -1)
+        return 0;
+    size_t done = 0;
+    ssize_t r;
+    while (done < len
+           && (r = pread(fd, dst + done, len - done, off + done)) > 0)
+        done += r;
+    close(fd);
+    return done;
+}
+
+int mem_from_core(struct mem_image *img, const char *core_path)
+{
+    struct file *f = file_map(core_path);
+    if (!f)
+    {
+        fprintf(stderr, "[-] %s: %s\n", core_path, elf_strerror(errno));
+        return -1;
+    }
+    const Elf64_Ehdr *h = f->content;
+    if (f->size < sizeof(*h) || h->e_type != ET_CORE
+        || h->e_phentsize != sizeof(Elf64_Phdr)
+        || h->e_phoff + (uint64_t)h->e_phnum * sizeof(Elf64_Phdr) > f->size)
+    {
+        fprintf(stderr, "[-] %s is not an ELF64 core file\n", core_path);
+        file_unmap(&f);
+        return -1;
+    }
+    const Elf64_Phdr *ph = get_phdrs(f->content, (Elf64_Ehdr *)h);
+    const uint8_t *files = NULL;
+    size_t files_size = 0;
+    if (find_nt_file(f, ph, h->e_phnum, &files, &files_size))
+        fprintf(stderr, "[-] No NT_FILE note, modules cannot be named\n");
+
+    int err = 0;
+    for (size_t i = 0; i < h->e_phnum && !err; i++)
+    {
+        if (ph[i].p_type != PT_LOAD || !(ph[i].p_flags & PF_X)
+            || !ph[i].p_memsz)
+            continue;
+        uint64_t start = ph[i].p_vaddr;
+        uint64_t pgoff = 0;
+        const char *path =
+            files ? nt_file_lookup(files, files_size, start, &pgoff) : NULL;
+        struct mem_region *r =
+            add_region(img, start, start + ph[i].p_memsz, pgoff, path);
+        if (!r)
+        {
+            err = -1;
+            break;
+        }
+
+        uint64_t in_core = ph[i].p_filesz;
+        if (ph[i].p_offset > f->size)
+            in_core = 0;
+        else if (in_core > f->size - ph[i].p_offset)
+            in_core = f->size - ph[i].p_offset;
+        if (in_core > ph[i].p_memsz)
+            in_core = ph[i].p_memsz;
+        memcpy(r->bytes, (const uint8_t *)f->content + ph[i].p_offset, in_core);
+        r->len = in_core;
+        if (!in_core && r->path)
+        {
+            r->len = read_from_disk(r->path, pgoff, r->bytes, ph[i].p_memsz);
+            r->from_disk = 1;
+        }
+    }
+    file_unmap(&f);
+    return err;
+}
+
+struct module // On-disk ELF behind one or more regions
+{
+    const char *path;
+    struct elf_bin *bin; // NULL: could not be loaded
+    struct sym_index idx; // Its .text functions by address
+};
+
+static struct module *module_get(struct module **mods, size_t *n,
+                                 const char *path)
+{
+    for (size_t i = 0; i < *n; i++)
+        if (strcmp((*mods)[i].path, path) == 0)
+            return &(*mods)[i];
+    struct module *m = realloc(*mods, (*n + 1) * sizeof(*m));
+    if (!m)
+        return NULL;
+    *mods = m;
+    m += (*n)++;
+    m->path = path;
+    memset(&m->idx, 0, sizeof(m->idx));
+    if ((m->bin = elf_load(path)) && symidx_build(&m->idx, &m->bin->syms))
+        elf_free(&m->bin);
+    return m;
+}
+
+// Run time minus link time address, from the segment mapping pgoff
+static int module_bias(const struct elf_bin *bin, const struct mem_region *r,
+                       uint64_t *bias)
+{
+    const Elf64_Phdr *ph = get_phdrs(bin->f->content, bin->ehdr);
+    for (size_t i = 0; i < bin->ehdr->e_phnum; i++)
+        if (ph[i].p_type == PT_LOAD && r->pgoff >= ph[i].p_offset
+            && r->pgoff < ph[i].p_offset + ph[i].p_filesz)
+        {
+            *bias = r->start - (ph[i].p_vaddr + (r->pgoff - ph[i].p_offset));
+            return 0;
+        }
+    return -1;
+}
+
+// Bytes no symbol covers (stripped code, local functions, PLT, JIT stubs)
+static void gap_disas(FILE *out, const struct mem_region *r,
+                      const struct elf_bin *bin, uint64_t start,
+                      uint64_t end)
+{
+    const uint8_t *live = r->bytes + (start - r->start);
+    uint64_t off = r->pgoff + (start - r->start); // Same bytes in the file
+    uint64_t size = end - start;
+    int patched = off > bin->f->size || size > bin->f->size - off
+        || memcmp(live, (const uint8_t *)bin->f->content + off, size) != 0;
+    fprintf(out,
+            "x86 disassembly of 0x%" PRIx64 "-0x%" PRIx64 " (no symbol)%s\n",
+            start, end, patched ? " [differs from file]" : "");
+    fdisas(out, live, size, start);
+}
+
+static size_t region_disas(FILE *out, const struct mem_region *r,
+                           const struct module *mod, const char *sym)
+{
+    const struct elf_bin *bin = mod ? mod->bin : NULL;
+    uint64_t bias;
+    if (!bin || module_bias(bin, r, &bias))
+    {
+        if (sym)
+            return 0;
+        fprintf(out, "x86 disassembly of region 0x%" PRIx64 "\n", r->start);
+        fdisas(out, r->bytes, r->len, r->start);
+        return 1;
+    }
+
+    // Symbols in address order, the bytes between them shown as gaps
+    size_t printed = 0;
+    uint64_t end = r->start + r->len;
+    uint64_t cursor = r->start;
+    for (size_t i = 0; i < mod->idx.n; i++)
+    {
+        const struct sym_info *s = &bin->syms.items[mod->idx.id[i]];
+        uint64_t addr = s->addr + bias;
+        if (addr < r->start || addr >= end
+            || (sym && strcmp(s->name, sym) != 0))
+            continue;
+        if (!sym && addr > cursor)
+        {
+            gap_disas(out, r, bin, cursor, addr);
+            printed++;
+        }
+        size_t size = s->size;
+        if (size > end - addr)
+            size = end - addr;
+        const uint8_t *live = r->bytes + (addr - r->start);
+        int patched = size != s->size || memcmp(live, s->bytes, size) != 0;
+        fprintf(out, "x86 disassembly of symbol %s (0x%" PRIx64 ")%s\n",
+                s->name, addr, patched ? " [differs from file]" : "");
+        fdisas(out, live, size, addr);
+        printed++;
+        if (addr + size > cursor)
+            cursor = addr + size;
+    }
+    if (!sym && cursor < end)
+    {
+        gap_disas(out, r, bin, cursor, end);
+        printed++;
+    }
+    return printed;
+}
+
+size_t mem_disas(FILE *out, const struct mem_image *img, const char *sym)
+{
+    struct module *mods = NULL;
+    size_t n_mods = 0;
+    size_t printed = 0;
+
+    for (size_t i = 0; i < img->n; i++)
+    {
+        const struct mem_region *r = &img->r[i];
+        if (!sym)
+            fprintf(out, "=== 0x%" PRIx64 "-0x%" PRIx64 " %s%s\n", r->start,
+                    r->end, r->path ? r->path : "[anon]",
+                    r->from_disk ? " (text from file)" : "");
+        struct module *mod = r->path && r->path[0] == '/'
+            ? module_get(&mods, &n_mods, r->path)
+            : NULL;
+        printed += region_disas(out, r, mod, sym);
+    }
+
+    for (size_t i = 0; i < n_mods; i++)
+    {
+        symidx_free(&mods[i].idx);
+        elf_free(&mods[i].bin);
+    }
+    free(mods);
+    return printed;
+}
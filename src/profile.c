@@ -0,0 +1,348 @@
+#include "include/profile.h"
+#include "include/disas.h"
+
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+struct func_hits
+{
+    size_t count;
+    size_t first; // Index of the first sample of the function
+    uint32_t id;
+};
+
+struct bias_votes // Page aligned load bias candidates, from ip + sym lines
+{
+    uint64_t *v;
+    size_t n;
+    size_t cap;
+};
+
+/*
+ * Without the offset the bias is still page aligned and ip - addr - bias
+ * must fall in [0, size): vote for each such candidate (one or two unless
+ * the function spans pages).
+ */
+static int vote_bias(struct bias_votes *b, const struct sym_info *sym,
+                     uint64_t ip)
+{
+    uint64_t d = ip - sym->addr;
+    uint64_t bias = d & ~(uint64_t)(PROFILE_PAGE - 1);
+    for (size_t k = 0; k < PROFILE_BIAS_VOTES && d - bias < sym->size;
+         k++, bias -= PROFILE_PAGE)
+    {
+        if (b->n == b->cap)
+        {
+            size_t cap = b->cap ? 2 * b->cap : 256;
+            uint64_t *v = realloc(b->v, cap * sizeof(*v));
+            if (!v)
+                return -1;
+            b->v = v;
+            b->cap = cap;
+        }
+        b->v[b->n++] = bias;
+    }
+    return 0;
+}
+
+// Most voted candidate, if any
+static void elect_bias(struct profile *prof, struct bias_votes *b)
+{
+    uint64_t *tmp = malloc((b->n + 1) * sizeof(*tmp));
+    if (!tmp || !b->n)
+    {
+        free(tmp);
+        return;
+    }
+    radix_sort_u64(b->v, tmp, b->n);
+    size_t best = 0;
+    for (size_t i = 0, j; i < b->n; i = j)
+    {
+        for (j = i + 1; j < b->n && b->v[j] == b->v[i]; j++)
+            ;
+        if (j - i > best)
+        {
+            best = j - i;
+            prof->bias = b->v[i];
+        }
+    }
+    prof->has_bias = 1;
+    free(tmp);
+}
+
+// "name+0xoff" after the address gives the load bias of a PIE, a bare
+// "name" a vote for it. names is built on the first symbol column seen
+static int find_bias(struct profile *prof, struct bias_votes *b,
+                     struct name_index *names, const struct sym_list *lst,
+                     const char *s, const char *end, uint64_t ip)
+{
+    while (s < end && (*s == ' ' || *s == '\t'))
+        s++;
+    const char *name = s;
+    while (s < end && *s != '+' && *s != ' ' && *s != '\t' && *s != '\n')
+        s++;
+    if (s == name)
+        return 0;
+
+    char buf[256];
+    size_t len = (size_t)(s - name);
+    if (len >= sizeof(buf))
+        return 0;
+    memcpy(buf, name, len);
+    buf[len] = '\0';
+    if (!names->key && nameidx_build(names, lst))
+        return -1;
+    uint32_t id = nameidx_find(names, buf);
+    if (id == SYM_NONE)
+        return 0;
+
+    uint64_t off;
+    if (s + 1 >= end || *s != '+')
+        return vote_bias(b, &lst->items[id], ip);
+    s++;
+    if (parse_hex_u64(&s, end, &off))
+        return 0;
+    prof->bias = ip - (lst->items[id].addr + off);
+    prof->has_bias = 1;
+    return 0;
+}
+
+static int push_ip(struct profile *prof, size_t *cap, uint64_t ip)
+{
+    if (prof->n == *cap)
+    {
+        size_t new_cap = *cap ? 2 * *cap : 4096;
+        uint64_t *ips = realloc(prof->ips, new_cap * sizeof(*ips));
+        if (!ips)
+            return -1;
+        prof->ips = ips;
+        *cap = new_cap;
+    }
+    prof->ips[prof->n++] = ip;
+    return 0;
+}
+
+static int parse_samples(struct profile *prof, const char *s, const char *end,
+                         const struct sym_list *lst)
+{
+    size_t cap = 0;
+    size_t tries = 0;
+    struct bias_votes votes = { NULL, 0, 0 };
+    struct name_index names = { NULL, 0 };
+    int err = 0;
+
+    while (s < end)
+    {
+        const char *eol = memchr(s, '\n', (size_t)(end - s));
+        if (!eol)
+            eol = end;
+        while (s < eol && (*s == ' ' || *s == '\t'))
+            s++;
+
+        uint64_t ip;
+        if (s == eol)
+            ; // Blank line
+        else if (parse_hex_u64(&s, eol, &ip)
+                 || (s < eol && *s != ' ' && *s != '\t'))
+            prof->n_skipped++;
+        else
+        {
+            if (!prof->has_bias && tries < PROFILE_BIAS_TRIES)
+            {
+                tries++;
+                err = find_bias(prof, &votes, &names, lst, s, eol, ip);
+            }
+            if (err || push_ip(prof, &cap, ip))
+            {
+                err = -1;
+                break;
+            }
+        }
+        s = eol + 1;
+    }
+    if (!err && !prof->has_bias)
+        elect_bias(prof, &votes);
+    free(votes.v);
+    nameidx_free(&names);
+    return err;
+}
+
+int profile_load(struct profile *prof, const char *path,
+                 const struct sym_list *lst)
+{
+    struct stat st;
+    int fd = open(path, O_RDONLY);
+
+    memset(prof, 0, sizeof(*prof));
+    if (fd == -1 || fstat(fd, &st) == -1)
+    {
+        perror("Cannot open the samples file");
+        if (fd != -1)
+            close(fd);
+        return -1;
+    }
+
+    int ret = 0;
+    if (st.st_size > 0)
+    {
+        void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map == MAP_FAILED)
+        {
+            perror("Cannot mmap the samples file");
+            close(fd);
+            return -1;
+        }
+        ret = parse_samples(prof, map, (const char *)map + st.st_size, lst);
+        munmap(map, st.st_size);
+    }
+    close(fd);
+
+    uint64_t *tmp = malloc((prof->n + 1) * sizeof(*tmp));
+    if (ret || !tmp)
+    {
+        fprintf(stderr, "[-] Out of memory loading samples\n");
+        free(tmp);
+        profile_free(prof);
+        return -1;
+    }
+    for (size_t i = 0; i < prof->n; i++)
+        prof->ips[i] -= prof->bias;
+    radix_sort_u64(prof->ips, tmp, prof->n);
+    free(tmp);
+
+    uint64_t text_end = 0;
+    for (size_t i = 0; i < lst->count; i++)
+        if (lst->items[i].addr + lst->items[i].size > text_end)
+            text_end = lst->items[i].addr + lst->items[i].size;
+    if (prof->n && prof->ips[0] >= text_end)
+        fprintf(stderr,
+                "[-] Every sample lies above .text: unknown load bias, "
+                "give function names (perf script -F ip,sym)\n");
+    return 0;
+}
+
+static size_t lower_bound(const uint64_t *a, size_t n, uint64_t key)
+{
+    size_t lo = 0;
+    while (n)
+    {
+        size_t half = n / 2;
+        if (a[lo + half] < key)
+        {
+            lo += half + 1;
+            n -= half + 1;
+        }
+        else
+            n = half;
+    }
+    return lo;
+}
+
+size_t profile_range(const struct profile *prof, uint64_t start,
+                     uint64_t end, size_t *first)
+{
+    size_t lo = lower_bound(prof->ips, prof->n, start);
+    size_t hi = lower_bound(prof->ips + lo, prof->n - lo, end) + lo;
+    if (first)
+        *first = lo;
+    return hi - lo;
+}
+
+static int cmp_hits(const void *a, const void *b)
+{
+    const struct func_hits *x = a;
+    const struct func_hits *y = b;
+    if (x->count != y->count)
+        return x->count < y->count ? 1 : -1;
+    return (x->id > y->id) - (x->id < y->id);
+}
+
+// Annotated disassembly, merging the function's sorted samples with the
+// instruction stream
+static void print_func(FILE *out, const struct profile *prof,
+                       const struct sym_info *s, const struct func_hits *h)
+{
+    const uint8_t *p = s->bytes;
+    const uint8_t *end = p + s->size;
+    uint64_t rip = s->addr;
+    size_t k = h->first;
+    size_t last = h->first + h->count;
+    struct asm_ins ins;
+
+    fprintf(out, "\n%s <0x%" PRIx64 ">: %zu samples (%.2f%%)\n", s->name,
+            (uint64_t)s->addr, h->count, 100.0 * h->count / prof->n);
+    while (p < end)
+    {
+        size_t n = decode64(p, (size_t)(end - p), &ins);
+        if (!n)
+            break;
+
+        size_t hits = 0;
+        while (k < last && prof->ips[k] < rip + n)
+        {
+            hits++;
+            k++;
+        }
+        if (hits)
+            fprintf(out, "%7.2f%% %8zu  ", 100.0 * hits / h->count, hits);
+        else
+            fprintf(out, "%8s %8s  ", "", "");
+        print_asm_ins(out, p, n, &ins, rip);
+        p += n;
+        rip += n;
+    }
+}
+
+void profile_print(FILE *out, const struct profile *prof,
+                   const struct sym_list *lst, const struct sym_index *idx)
+{
+    struct func_hits *hits = malloc((idx->n + 1) * sizeof(*hits));
+    size_t n_hot = 0;
+    size_t attributed = 0;
+
+    if (!hits)
+    {
+        fprintf(stderr, "[-] Out of memory attributing samples\n");
+        return;
+    }
+
+    // Functions are address sorted too: one binary search each
+    for (size_t i = 0; i < idx->n; i++)
+    {
+        size_t first;
+        size_t count =
+            profile_range(prof, idx->start[i], idx->end[i], &first);
+        if (count)
+        {
+            hits[n_hot++] = (struct func_hits){ count, first, idx->id[i] };
+            attributed += count;
+        }
+    }
+    qsort(hits, n_hot, sizeof(*hits), cmp_hits);
+
+    fprintf(out, "Profile: %zu samples, %zu in .text functions", prof->n,
+            attributed);
+    if (prof->has_bias)
+        fprintf(out, " (load bias 0x%" PRIx64 ")", prof->bias);
+    if (prof->n_skipped)
+        fprintf(out, ", %zu lines skipped", prof->n_skipped);
+    putc('\n', out);
+    for (size_t i = 0; i < n_hot; i++)
+        fprintf(out, "%7.2f%% %8zu  %s\n", 100.0 * hits[i].count / prof->n,
+                hits[i].count, lst->items[hits[i].id].name);
+    for (size_t i = 0; i < n_hot; i++)
+        print_func(out, prof, &lst->items[hits[i].id], &hits[i]);
+
+    free(hits);
+}
+
+void profile_free(struct profile *prof)
+{
+    free(prof->ips);
+    memset(prof, 0, sizeof(*prof));
+}
@@ -0,0 +1,78 @@
+#include "include/raw.h"
+#include "include/disas.h"
+
+#include <errno.h>
+#include <inttypes.h>
+#include <stdlib.h>
+
+static void print_bytes(FILE *out, const uint8_t *p, size_t len)
+{
+    fputs("Bytes parsed:", out);
+    for (size_t i = 0; i < len; i++)
+        fprintf(out, " 0x%02X", p[i]);
+    putc('\n', out);
+}
+
+static void disas_blob(FILE *out, const uint8_t *code, size_t size,
+                       uint64_t base, struct raw_stats *st)
+{
+    struct disas_iter it;
+    struct asm_ins ins;
+    size_t off = 0;
+
+    while (off < size)
+    {
+        disas_iter_init(&it, code + off, size - off, base + off);
+        int ret;
+        while ((ret = disas_next(&it, &ins)) > 0)
+        {
+            print_bytes(out, it.ins_bytes, it.ins_len);
+            print_asm_ins(out, it.ins_bytes, it.ins_len, &ins, it.ins_rip);
+            st->ins++;
+        }
+        off = it.p - code;
+        if (ret < 0) // Data or a decoder gap: step over one byte
+        {
+            print_bytes(out, code + off, 1);
+            fprintf(out, "RIP: 0x%016" PRIx64 "\t(bad)\n", base + off);
+            st->bad++;
+            off++;
+        }
+    }
+}
+
+int raw_disas(FILE *out, const char *path, uint64_t base, int hex,
+              enum io_backend io, struct raw_stats *st)
+{
+    struct file *f = file_open_raw(path, io);
+    if (!f)
+    {
+        if (errno == ENODATA)
+            fprintf(stderr, "[-] %s: file is empty\n", path);
+        else
+            perror(path);
+        return -1;
+    }
+
+    const uint8_t *code = f->content;
+    uint8_t *decoded = NULL;
+    st->bytes = f->size;
+    st->ins = st->bad = 0;
+    if (hex)
+    {
+        if (!(decoded = malloc(f->size / 2 + 1)))
+        {
+            perror("malloc");
+            file_unmap(&f);
+            return -1;
+        }
+        st->bytes = hex_decode(f->content, f->size, decoded);
+        code = decoded;
+    }
+
+    fprintf(out, "x86 disassembly of %s at 0x%" PRIx64 "\n", path, base);
+    disas_blob(out, code, st->bytes, base, st);
+    free(decoded);
+    file_unmap(&f);
+    return 0;
+}
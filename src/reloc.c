@@ -0,0 +1,230 @@
+#include "include/reloc.h"
+
+#include <elf.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+
+const char *reloc_type_name(uint32_t type)
+{
+    switch (type)
+    {
+    case R_X86_64_64:
+        return "R_X86_64_64";
+    case R_X86_64_PC32:
+        return "R_X86_64_PC32";
+    case R_X86_64_GOT32:
+        return "R_X86_64_GOT32";
+    case R_X86_64_PLT32:
+        return "R_X86_64_PLT32";
+    case R_X86_64_GOTPCREL:
+        return "R_X86_64_GOTPCREL";
+    case R_X86_64_32:
+        return "R_X86_64_32";
+    case R_X86_64_32S:
+        return "R_X86_64_32S";
+    case R_X86_64_16:
+        return "R_X86_64_16";
+    case R_X86_64_PC16:
+        return "R_X86_64_PC16";
+    case R_X86_64_8:
+        return "R_X86_64_8";
+    case R_X86_64_PC8:
+        return "R_X86_64_PC8";
+    case R_X86_64_TLSGD:
+        return "R_X86_64_TLSGD";
+    case R_X86_64_TLSLD:
+        return "R_X86_64_TLSLD";
+    case R_X86_64_DTPOFF32:
+        return "R_X86_64_DTPOFF32";
+    case R_X86_64_GOTTPOFF:
+        return "R_X86_64_GOTTPOFF";
+    case R_X86_64_TPOFF32:
+        return "R_X86_64_TPOFF32";
+    case R_X86_64_PC64:
+        return "R_X86_64_PC64";
+    case R_X86_64_GOTOFF64:
+        return "R_X86_64_GOTOFF64";
+    case R_X86_64_GOTPC32:
+        return "R_X86_64_GOTPC32";
+    case R_X86_64_GOTPCRELX:
+        return "R_X86_64_GOTPCRELX";
+    case R_X86_64_REX_GOTPCRELX:
+        return "R_X86_64_REX_GOTPCRELX";
+    default:
+        return NULL;
+    }
+}
+
+static const char *sym_name(const struct elf_bin *bin, const Elf64_Sym *syms,
+                            size_t n_syms, const char *str, size_t str_len,
+                            uint32_t sym)
+{
+    if (!sym || sym >= n_syms)
+        return "*ABS*";
+    const Elf64_Sym *s = &syms[sym];
+    if (ELF64_ST_TYPE(s->st_info) == STT_SECTION)
+    {
+        const char *name = s->st_shndx < bin->ehdr->e_shnum
+            ? elf_section_name(bin, &bin->shdrs[s->st_shndx])
+            : NULL;
+        return name ? name : "?";
+    }
+    if (!str || s->st_name >= str_len)
+        return "?";
+    return str + s->st_name;
+}
+
+// Entries of one RELA section, appended unsorted
+static size_t add_section(struct reloc_index *ri, const struct elf_bin *bin,
+                          const Elf64_Shdr *rela)
+{
+    const Elf64_Rela *rel = elf_section_data(bin, rela);
+    const Elf64_Shdr *symtab =
+        rela->sh_link < bin->ehdr->e_shnum ? &bin->shdrs[rela->sh_link] : NULL;
+    const Elf64_Sym *syms = symtab ? elf_section_data(bin, symtab) : NULL;
+    size_t n_syms = syms ? symtab->sh_size / sizeof(Elf64_Sym) : 0;
+    const Elf64_Shdr *strtab = symtab && symtab->sh_link < bin->ehdr->e_shnum
+        ? &bin->shdrs[symtab->sh_link]
+        : NULL;
+    const char *str = strtab ? elf_section_data(bin, strtab) : NULL;
+    size_t str_len = str ? strtab->sh_size : 0;
+    if (!rel)
+        return 0;
+
+    size_t n = rela->sh_size / sizeof(Elf64_Rela);
+    for (size_t i = 0; i < n; i++)
+    {
+        size_t k = ri->n++;
+        ri->off[k] = rel[i].r_offset;
+        ri->type[k] = ELF64_R_TYPE(rel[i].r_info);
+        ri->addend[k] = rel[i].r_addend;
+        ri->name[k] = sym_name(bin, syms, n_syms, str, str_len,
+                               ELF64_R_SYM(rel[i].r_info));
+    }
+    return n;
+}
+
+// Assemblers emit entries in offset order: only sort when they are not
+static int sort_entries(struct reloc_index *ri)
+{
+    size_t i = 1;
+    while (i < ri->n && ri->off[i - 1] <= ri->off[i])
+        i++;
+    if (i >= ri->n)
+        return 0;
+
+    uint64_t *ktmp = malloc(ri->n * sizeof(*ktmp));
+    uint32_t *perm = malloc(ri->n * sizeof(*perm));
+    uint32_t *vtmp = malloc(ri->n * sizeof(*vtmp));
+    uint32_t *type = malloc(ri->n * sizeof(*type));
+    int64_t *addend = malloc(ri->n * sizeof(*addend));
+    const char **name = malloc(ri->n * sizeof(*name));
+    int err = !ktmp || !perm || !vtmp || !type || !addend || !name;
+    if (!err)
+    {
+        for (size_t k = 0; k < ri->n; k++)
+            perm[k] = k;
+        radix_sort_kv(ri->off, perm, ktmp, vtmp, ri->n);
+        for (size_t k = 0; k < ri->n; k++)
+        {
+            type[k] = ri->type[perm[k]];
+            addend[k] = ri->addend[perm[k]];
+            name[k] = ri->name[perm[k]];
+        }
+        memcpy(ri->type, type, ri->n * sizeof(*type));
+        memcpy(ri->addend, addend, ri->n * sizeof(*addend));
+        memcpy(ri->name, name, ri->n * sizeof(*name));
+    }
+    free(ktmp);
+    free(perm);
+    free(vtmp);
+    free(type);
+    free(addend);
+    free(name);
+    return err ? -1 : 0;
+}
+
+int reloc_index_build(struct reloc_index *ri, const struct elf_bin *bin,
+                      size_t sec)
+{
+    const Elf64_Shdr *sh = bin->shdrs;
+    size_t total = 0;
+
+    memset(ri, 0, sizeof(*ri));
+    for (Elf64_Half i = 0; i < bin->ehdr->e_shnum; i++)
+        if (sh[i].sh_type == SHT_RELA && sh[i].sh_info == sec)
+            total += sh[i].sh_size / sizeof(Elf64_Rela);
+    if (!total)
+        return 0;
+
+    ri->off = malloc(total * sizeof(*ri->off));
+    ri->type = malloc(total * sizeof(*ri->type));
+    ri->addend = malloc(total * sizeof(*ri->addend));
+    ri->name = malloc(total * sizeof(*ri->name));
+    if (!ri->off || !ri->type || !ri->addend || !ri->name)
+    {
+        reloc_index_free(ri);
+        return -1;
+    }
+    for (Elf64_Half i = 0; i < bin->ehdr->e_shnum; i++)
+        if (sh[i].sh_type == SHT_RELA && sh[i].sh_info == sec
+            && sh[i].sh_entsize == sizeof(Elf64_Rela))
+            add_section(ri, bin, &sh[i]);
+    if (sort_entries(ri))
+    {
+        reloc_index_free(ri);
+        return -1;
+    }
+    return 0;
+}
+
+void reloc_index_free(struct reloc_index *ri)
+{
+    free(ri->off);
+    free(ri->type);
+    free(ri->addend);
+    free(ri->name);
+    memset(ri, 0, sizeof(*ri));
+}
+
+struct reloc_cursor reloc_seek(const struct reloc_index *ri, uint64_t off)
+{
+    size_t lo = 0;
+    size_t hi = ri->n;
+    while (lo < hi)
+    {
+        size_t mid = lo + (hi - lo) / 2;
+        if (ri->off[mid] < off)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    struct reloc_cursor c = { ri, lo };
+    return c;
+}
+
+void reloc_note(FILE *out, uint64_t rip, size_t len, void *cursor)
+{
+    struct reloc_cursor *c = cursor;
+    const struct reloc_index *ri = c->ri;
+
+    while (c->i < ri->n && ri->off[c->i] < rip)
+        c->i++;
+    for (; c->i < ri->n && ri->off[c->i] < rip + len; c->i++)
+    {
+        size_t k = c->i;
+        const char *type = reloc_type_name(ri->type[k]);
+        fprintf(out, "\t\t\t%" PRIx64 ": ", ri->off[k]);
+        if (type)
+            fputs(type, out);
+        else
+            fprintf(out, "R_X86_64_%" PRIu32, ri->type[k]);
+        int64_t a = ri->addend[k];
+        if (a)
+            fprintf(out, "\t%s%c0x%" PRIx64 "\n", ri->name[k],
+                    a < 0 ? '-' : '+', a < 0 ? -(uint64_t)a : (uint64_t)a);
+        else
+            fprintf(out, "\t%s\n", ri->name[k]);
+    }
+}
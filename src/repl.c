@@ -0,0 +1,386 @@
+#include "include/repl.h"
+#include "include/disas.h"
+#include "include/pretty_print.h"
+
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+struct u64_buf
+{
+    uint64_t *a;
+    size_t n;
+    size_t cap;
+};
+
+static int push_u64(struct u64_buf *b, uint64_t v)
+{
+    if (b->n == b->cap)
+    {
+        size_t cap = b->cap ? 2 * b->cap : 1024;
+        uint64_t *a = realloc(b->a, cap * sizeof(*a));
+        if (!a)
+            return -1;
+        b->a = a;
+        b->cap = cap;
+    }
+    b->a[b->n++] = v;
+    return 0;
+}
+
+// One decode pass over every function: instruction starts and references
+static int index_code(struct repl *r)
+{
+    const struct sym_list *lst = &r->bin->syms;
+    struct u64_buf ins = { 0 };
+    struct u64_buf to = { 0 };
+    struct u64_buf from = { 0 };
+    struct disas_iter it;
+    struct asm_ins in;
+    int err = 0;
+
+    for (size_t i = 0; i < r->idx.n && !err; i++)
+    {
+        const struct sym_info *s = &lst->items[r->idx.id[i]];
+        disas_iter_init(&it, s->bytes, s->size, s->addr);
+        while (!err && disas_next(&it, &in) > 0)
+        {
+            err = push_u64(&ins, it.ins_rip);
+            if (!err && (ins_has_rel(&in) || ins_rip_relative(&in)))
+                err = push_u64(&to, ins_target(&in, it.ins_rip, it.ins_len))
+                    || push_u64(&from, it.ins_rip);
+        }
+    }
+
+    uint64_t *tmp = malloc((ins.n + 1) * sizeof(*tmp));
+    uint32_t *vtmp = malloc((to.n + 1) * sizeof(*vtmp));
+    r->xref_id = malloc((to.n + 1) * sizeof(*r->xref_id));
+    if (err || !tmp || !vtmp || !r->xref_id || to.n > UINT32_MAX)
+    {
+        free(ins.a);
+        free(to.a);
+        free(from.a);
+        free(tmp);
+        free(vtmp);
+        return -1;
+    }
+
+    // Overlapping symbols decode the same bytes twice: keep one start
+    radix_sort_u64(ins.a, tmp, ins.n);
+    size_t n = 0;
+    for (size_t i = 0; i < ins.n; i++)
+        if (!n || ins.a[i] != ins.a[n - 1])
+            ins.a[n++] = ins.a[i];
+    r->ins = ins.a;
+    r->n_ins = n;
+
+    for (size_t i = 0; i < to.n; i++)
+        r->xref_id[i] = (uint32_t)i;
+    radix_sort_kv(to.a, r->xref_id, tmp, vtmp, to.n);
+    r->xref_to = to.a;
+    r->xref_from = from.a;
+    r->n_xref = to.n;
+
+    free(tmp);
+    free(vtmp);
+    return 0;
+}
+
+int repl_init(struct repl *r, struct elf_bin *bin)
+{
+    const struct sym_list *lst = &bin->syms;
+
+    memset(r, 0, sizeof(*r));
+    r->bin = bin;
+    if (symidx_build(&r->idx, lst))
+        return -1;
+    if (nameidx_build(&r->names, lst) || index_code(r))
+    {
+        repl_free(r);
+        return -1;
+    }
+    return 0;
+}
+
+void repl_free(struct repl *r)
+{
+    symidx_free(&r->idx);
+    nameidx_free(&r->names);
+    free(r->ins);
+    free(r->xref_to);
+    free(r->xref_id);
+    free(r->xref_from);
+    memset(r, 0, sizeof(*r));
+}
+
+static const struct sym_info *by_name(const struct repl *r, const char *name)
+{
+    uint32_t id = nameidx_find(&r->names, name);
+    return id == SYM_NONE ? NULL : &r->bin->syms.items[id];
+}
+
+// First index of a sorted array with a[i] >= key
+static size_t lower_u64(const uint64_t *a, size_t n, uint64_t key)
+{
+    size_t lo = 0;
+    while (n)
+    {
+        size_t half = n / 2;
+        if (a[lo + half] < key)
+        {
+            lo += half + 1;
+            n -= half + 1;
+        }
+        else
+            n = half;
+    }
+    return lo;
+}
+
+// Symbol or address argument
+static int resolve(const struct repl *r, const char *arg, uint64_t *addr)
+{
+    const struct sym_info *s = by_name(r, arg);
+    char *end;
+
+    if (s)
+    {
+        *addr = s->addr;
+        return 0;
+    }
+    *addr = strtoull(arg, &end, 16);
+    return *end || end == arg ? -1 : 0;
+}
+
+static const struct sym_info *containing(const struct repl *r, uint64_t addr)
+{
+    uint32_t id = symidx_lookup(&r->idx, addr);
+    return id == SYM_NONE ? NULL : &r->bin->syms.items[id];
+}
+
+static void print_loc(FILE *out, const struct repl *r, uint64_t addr)
+{
+    const struct sym_info *s = containing(r, addr);
+    if (s)
+        fprintf(out, "%s+0x%" PRIx64, s->name, addr - (uint64_t)s->addr);
+    else
+        fputs("??", out);
+}
+
+// Decodes the single instruction starting at addr
+static int ins_at(const struct repl *r, uint64_t addr, struct asm_ins *in,
+                  const uint8_t **bytes, size_t *len)
+{
+    const struct sym_info *s = containing(r, addr);
+    if (!s)
+        return -1;
+    size_t off = (size_t)(addr - s->addr);
+    *bytes = s->bytes + off;
+    *len = decode64(*bytes, s->size - off, in);
+    return *len ? 0 : -1;
+}
+
+static void cmd_disas(FILE *out, const struct repl *r, const char *name)
+{
+    const struct sym_info *s = by_name(r, name);
+    struct disas_iter it;
+    struct asm_ins in;
+
+    if (!s)
+    {
+        fprintf(out, "[-] No .text symbol named %s\n", name);
+        return;
+    }
+    fprintf(out, "x86 disassembly of symbol %s\n", s->name);
+    disas_iter_init(&it, s->bytes, s->size, s->addr);
+    while (disas_next(&it, &in) > 0)
+        print_asm_ins(out, it.ins_bytes, it.ins_len, &in, it.ins_rip);
+}
+
+static void cmd_around(FILE *out, const struct repl *r, const char *arg,
+                       const char *count)
+{
+    uint64_t addr;
+    size_t n = count ? strtoull(count, NULL, 0) : REPL_AROUND_DEFAULT;
+
+    if (resolve(r, arg, &addr))
+    {
+        fprintf(out, "[-] Not a symbol or hex address: %s\n", arg);
+        return;
+    }
+
+    // Instruction containing addr: last start at or before it
+    size_t i = lower_u64(r->ins, r->n_ins, addr + 1);
+    if (!i)
+    {
+        fprintf(out, "[-] 0x%" PRIx64 " is before any function\n", addr);
+        return;
+    }
+    i--;
+    size_t first = i > n ? i - n : 0;
+    size_t last = i + n + 1 < r->n_ins ? i + n + 1 : r->n_ins;
+
+    for (size_t k = first; k < last; k++)
+    {
+        struct asm_ins in;
+        const uint8_t *bytes;
+        size_t len;
+        if (ins_at(r, r->ins[k], &in, &bytes, &len))
+            continue;
+        fputs(k == i ? "> " : "  ", out);
+        print_loc(out, r, r->ins[k]);
+        putc('\t', out);
+        print_asm_ins(out, bytes, len, &in, r->ins[k]);
+    }
+}
+
+static void cmd_xrefs(FILE *out, const struct repl *r, const char *arg)
+{
+    const struct sym_info *s = by_name(r, arg);
+    uint64_t start;
+    uint64_t end;
+
+    if (s)
+    {
+        start = s->addr;
+        end = s->addr + (s->size ? s->size : 1);
+    }
+    else if (!resolve(r, arg, &start))
+        end = start + 1;
+    else
+    {
+        fprintf(out, "[-] Not a symbol or hex address: %s\n", arg);
+        return;
+    }
+
+    size_t k = lower_u64(r->xref_to, r->n_xref, start);
+    size_t n = 0;
+    for (; k < r->n_xref && r->xref_to[k] < end; k++, n++)
+    {
+        uint64_t from = r->xref_from[r->xref_id[k]];
+        char buf[INS_BUFSIZE] = "";
+        struct asm_ins in;
+        const uint8_t *bytes;
+        size_t len;
+
+        if (!ins_at(r, from, &in, &bytes, &len))
+            format_ins(buf, sizeof(buf), &in);
+        fprintf(out, "0x%" PRIx64 " ", from);
+        print_loc(out, r, from);
+        fprintf(out, "\t%s\t-> 0x%" PRIx64 "\n", buf, r->xref_to[k]);
+    }
+    fprintf(out, "%zu reference(s)\n", n);
+}
+
+static void cmd_find(FILE *out, const struct repl *r, const char *pattern)
+{
+    size_t n = 0;
+    for (size_t i = 0; i < r->bin->syms.count; i++)
+    {
+        const struct sym_info *s = &r->bin->syms.items[r->names.key[i].id];
+        if (!strstr(s->name, pattern))
+            continue;
+        fprintf(out, "0x%016" PRIx64 " %8zu %s\n", (uint64_t)s->addr, s->size,
+                s->name);
+        n++;
+    }
+    fprintf(out, "%zu match(es)\n", n);
+}
+
+static void cmd_sections(FILE *out, const struct repl *r)
+{
+    const Elf64_Ehdr *ehdr = r->bin->ehdr;
+    for (Elf64_Half i = 0; i < ehdr->e_shnum; i++)
+    {
+        const Elf64_Shdr *sh = &r->bin->shdrs[i];
+        const char *name = elf_section_name(r->bin, sh);
+        fprintf(out, "%2u 0x%016" PRIx64 " %10" PRIu64 " %s\n", i,
+                (uint64_t)sh->sh_addr, (uint64_t)sh->sh_size,
+                name ? name : "?");
+    }
+}
+
+static void cmd_help(FILE *out)
+{
+    fputs("d SYM              disassemble a function\n"
+          "x SYM              hex dump of a function\n"
+          "around ADDR|SYM [N] N instructions before and after\n"
+          "xrefs ADDR|SYM     direct branches / RIP references to it\n"
+          "find TEXT          functions whose name contains TEXT\n"
+          "s                  sections\n"
+          "q                  quit\n",
+          out);
+}
+
+int repl_exec(FILE *out, struct repl *r, char *line)
+{
+    char *argv[3] = { NULL, NULL, NULL };
+    int argc = 0;
+
+    for (char *p = line; *p && argc < 3;)
+    {
+        while (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')
+            *p++ = '\0';
+        if (!*p)
+            break;
+        argv[argc++] = p;
+        while (*p && *p != ' ' && *p != '\t' && *p != '\n' && *p != '\r')
+            p++;
+    }
+    if (!argc)
+        return 0;
+
+    const char *cmd = argv[0];
+    if (strcmp(cmd, "q") == 0 || strcmp(cmd, "quit") == 0)
+        return 1;
+    if (strcmp(cmd, "s") == 0)
+        cmd_sections(out, r);
+    else if (strcmp(cmd, "help") == 0 || strcmp(cmd, "?") == 0)
+        cmd_help(out);
+    else if (argc < 2
+             && (strcmp(cmd, "d") == 0 || strcmp(cmd, "x") == 0
+                 || strcmp(cmd, "around") == 0 || strcmp(cmd, "xrefs") == 0
+                 || strcmp(cmd, "find") == 0))
+        fprintf(out, "[-] %s: missing argument (try help)\n", cmd);
+    else if (argc < 2)
+        fprintf(out, "[-] Unknown command %s (try help)\n", cmd);
+    else if (strcmp(cmd, "d") == 0)
+        cmd_disas(out, r, argv[1]);
+    else if (strcmp(cmd, "x") == 0)
+    {
+        const struct sym_info *s = by_name(r, argv[1]);
+        if (!s)
+            fprintf(out, "[-] No .text symbol named %s\n", argv[1]);
+        else
+            fhexdump(out, s->bytes, s->size);
+    }
+    else if (strcmp(cmd, "around") == 0)
+        cmd_around(out, r, argv[1], argv[2]);
+    else if (strcmp(cmd, "xrefs") == 0)
+        cmd_xrefs(out, r, argv[1]);
+    else if (strcmp(cmd, "find") == 0)
+        cmd_find(out, r, argv[1]);
+    else
+        fprintf(out, "[-] Unknown command %s (try help)\n", cmd);
+    return 0;
+}
+
+int repl_run(struct repl *r, FILE *in, FILE *out)
+{
+    char line[REPL_LINE_MAX];
+    int tty = in == stdin && isatty(STDIN_FILENO);
+
+    fprintf(out,
+            "[+] %zu functions, %zu instructions, %zu references indexed\n",
+            r->bin->syms.count, r->n_ins, r->n_xref);
+    for (;;)
+    {
+        if (tty)
+            fputs(REPL_PROMPT, out);
+        fflush(out);
+        if (!fgets(line, sizeof(line), in) || repl_exec(out, r, line))
+            break;
+    }
+    return 0;
+}
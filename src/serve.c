@@ -0,0 +1,458 @@
+#define _GNU_SOURCE // lstat, S_ISSOCK, struct ucred
+
+#include "include/serve.h"
+#include "include/disas.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+struct outbuf // Response payload
+{
+    char *data;
+    size_t len;
+    size_t cap;
+    int oom;
+};
+
+// Room for more than n bytes past len, 0 if out of memory
+static int out_reserve(struct outbuf *o, size_t n)
+{
+    if (o->oom)
+        return 0;
+    if (o->cap - o->len > n)
+        return 1;
+
+    size_t cap = o->cap ? 2 * o->cap : 4096;
+    while (cap - o->len <= n)
+        cap *= 2;
+    char *data = realloc(o->data, cap);
+    if (!data)
+    {
+        o->oom = 1;
+        return 0;
+    }
+    o->data = data;
+    o->cap = cap;
+    return 1;
+}
+
+static void out_printf(struct outbuf *o, const char *fmt, ...)
+{
+    va_list ap;
+
+    while (out_reserve(o, 0))
+    {
+        va_start(ap, fmt);
+        int n = vsnprintf(o->data + o->len, o->cap - o->len, fmt, ap);
+        va_end(ap);
+        if (n < 0)
+        {
+            o->oom = 1;
+            return;
+        }
+        if ((size_t)n < o->cap - o->len)
+        {
+            o->len += n;
+            return;
+        }
+        if (!out_reserve(o, (size_t)n))
+            return;
+    }
+}
+
+static void out_write(struct outbuf *o, const char *buf, size_t len)
+{
+    if (!out_reserve(o, len))
+        return;
+    memcpy(o->data + o->len, buf, len);
+    o->len += len;
+}
+
+static void slot_free(struct serve_bin *s)
+{
+    if (s->bin)
+    {
+        symidx_free(&s->idx);
+        nameidx_free(&s->names);
+        elf_free(&s->bin);
+    }
+    free(s->path);
+    memset(s, 0, sizeof(*s));
+}
+
+// Cached binary, reloaded when the file changed, LRU slot evicted on miss
+static struct serve_bin *cache_get(struct serve_cache *c, const char *path)
+{
+    struct stat st;
+    struct serve_bin *victim = NULL;
+
+    if (stat(path, &st) == -1)
+        return NULL;
+    c->clock++;
+    for (size_t i = 0; i < SERVE_CACHE_SIZE; i++)
+    {
+        struct serve_bin *s = &c->slot[i];
+        if (s->bin && strcmp(s->path, path) == 0)
+        {
+            if (s->dev == st.st_dev && s->ino == st.st_ino
+                && s->size == st.st_size && s->mtime == st.st_mtime)
+            {
+                c->hits++;
+                s->last_used = c->clock;
+                return s;
+            }
+            victim = s; // Stale, reload in place
+            break;
+        }
+        // Prefer a free slot, then the least recently used
+        if (!victim
+            || (victim->bin && (!s->bin || s->last_used < victim->last_used)))
+            victim = s;
+    }
+
+    c->misses++;
+    slot_free(victim);
+    if (!(victim->path = xstrdup(path)) || !(victim->bin = elf_load(path)))
+    {
+        free(victim->path);
+        victim->path = NULL;
+        return NULL;
+    }
+    if (symidx_build(&victim->idx, &victim->bin->syms)
+        || nameidx_build(&victim->names, &victim->bin->syms))
+    {
+        slot_free(victim);
+        return NULL;
+    }
+    victim->dev = st.st_dev;
+    victim->ino = st.st_ino;
+    victim->size = st.st_size;
+    victim->mtime = st.st_mtime;
+    victim->last_used = c->clock;
+    return victim;
+}
+
+static void dis_range(struct outbuf *o, const uint8_t *code, size_t size,
+                      uint64_t rip)
+{
+    struct disas_iter it;
+    struct asm_ins ins;
+    char buf[INS_BUFSIZE];
+
+    disas_iter_init(&it, code, size, rip);
+    while (disas_next(&it, &ins) > 0)
+    {
+        format_ins(buf, sizeof(buf), &ins);
+        out_printf(o, "0x%" PRIx64 "\t%s\n", it.ins_rip, buf);
+    }
+}
+
+// Fills o, returns an error message or NULL
+static const char *handle(struct serve_cache *c, int argc, char **argv,
+                          struct outbuf *o)
+{
+    if (strcmp(argv[0], "stats") == 0)
+    {
+        size_t used = 0;
+        for (size_t i = 0; i < SERVE_CACHE_SIZE; i++)
+            used += c->slot[i].bin != NULL;
+        out_printf(o, "hits %zu misses %zu cached %zu/%d\n", c->hits,
+                   c->misses, used, SERVE_CACHE_SIZE);
+        return NULL;
+    }
+    if (argc < 2)
+        return "bad request";
+
+    struct serve_bin *s = cache_get(c, argv[1]);
+    if (!s)
+        return "cannot load binary";
+    const struct sym_list *lst = &s->bin->syms;
+
+    if (strcmp(argv[0], "syms") == 0 && argc == 2)
+    {
+        for (size_t i = 0; i < s->idx.n; i++)
+        {
+            const struct sym_info *sym = &lst->items[s->idx.id[i]];
+            out_printf(o, "0x%" PRIx64 " %zu %s\n", (uint64_t)sym->addr,
+                       sym->size, sym->name);
+        }
+        return NULL;
+    }
+    if (strcmp(argv[0], "sym") == 0 && argc == 3)
+    {
+        uint64_t addr = strtoull(argv[2], NULL, 16);
+        uint32_t id = symidx_lookup(&s->idx, addr);
+        if (id == SYM_NONE)
+            out_printf(o, "??\n");
+        else
+            out_printf(o, "%s+0x%" PRIx64 "\n", lst->items[id].name,
+                       addr - (uint64_t)lst->items[id].addr);
+        return NULL;
+    }
+    if ((strcmp(argv[0], "find") == 0 || strcmp(argv[0], "dis") == 0)
+        && argc == 3)
+    {
+        uint32_t id = nameidx_find(&s->names, argv[2]);
+        if (id == SYM_NONE)
+            return "no such symbol";
+        const struct sym_info *sym = &lst->items[id];
+        if (argv[0][0] == 'f')
+            out_printf(o, "0x%" PRIx64 " %zu\n", (uint64_t)sym->addr,
+                       sym->size);
+        else
+            dis_range(o, sym->bytes, sym->size, sym->addr);
+        return NULL;
+    }
+    if (strcmp(argv[0], "slice") == 0 && argc == 4)
+    {
+        const Elf64_Shdr *text = s->bin->impsec->text;
+        const uint8_t *data = elf_section_data(s->bin, text);
+        uint64_t addr = strtoull(argv[2], NULL, 16);
+        uint64_t len = strtoull(argv[3], NULL, 0);
+        if (!data || addr < text->sh_addr
+            || addr - text->sh_addr > text->sh_size
+            || len > text->sh_size - (addr - text->sh_addr))
+            return "slice outside .text";
+        dis_range(o, data + (addr - text->sh_addr), len, addr);
+        return NULL;
+    }
+    return "bad request";
+}
+
+struct client // Connection with its partial request line and its replies
+{
+    int fd;
+    int closing; // Drop once out is flushed
+    int owner; // Peer runs as the server's uid, may send quit
+    size_t len;
+    char line[SERVE_LINE_MAX];
+    struct outbuf out; // Queued replies, sent from out.data + sent
+    size_t sent;
+};
+
+// Sends what the socket takes without blocking, -1 to drop the client
+static int client_flush(struct client *cl)
+{
+    if (cl->out.oom)
+        return -1;
+    while (cl->sent < cl->out.len)
+    {
+        ssize_t n = send(cl->fd, cl->out.data + cl->sent,
+                         cl->out.len - cl->sent, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            return 0;
+        if (n <= 0)
+            return -1;
+        cl->sent += n;
+    }
+    cl->out.len = 0;
+    cl->sent = 0;
+    return cl->closing ? -1 : 0;
+}
+
+static void client_free(struct client *cl)
+{
+    close(cl->fd);
+    free(cl->out.data);
+    free(cl);
+}
+
+// Queues the answers to the complete lines buffered for a client, 1 on quit
+static int serve_lines(struct serve_cache *c, struct client *cl,
+                       struct outbuf *o)
+{
+    char *eol;
+    while ((eol = memchr(cl->line, '\n', cl->len)))
+    {
+        *eol = '\0';
+        char *argv[SERVE_MAX_ARGS];
+        int argc = 0;
+        for (char *p = cl->line; *p && argc < SERVE_MAX_ARGS;)
+        {
+            while (*p == ' ' || *p == '\t' || *p == '\r')
+                *p++ = '\0';
+            if (!*p)
+                break;
+            argv[argc++] = p;
+            while (*p && *p != ' ' && *p != '\t' && *p != '\r')
+                p++;
+        }
+
+        const char *err = NULL;
+        o->len = 0;
+        o->oom = 0;
+        if (!argc)
+            err = "empty request";
+        else if (strcmp(argv[0], "quit") == 0 && !cl->owner)
+            err = "quit is reserved to the server's user";
+        else if (strcmp(argv[0], "quit") == 0)
+        {
+            out_write(&cl->out, "OK 0\n", 5);
+            return 1;
+        }
+        else
+            err = handle(c, argc, argv, o);
+        if (!err && o->oom)
+            err = "out of memory";
+
+        char hdr[64];
+        int n = err ? snprintf(hdr, sizeof(hdr), "ERR %s\n", err)
+                    : snprintf(hdr, sizeof(hdr), "OK %zu\n", o->len);
+        out_write(&cl->out, hdr, n);
+        if (!err)
+            out_write(&cl->out, o->data, o->len);
+
+        size_t used = (size_t)(eol + 1 - cl->line);
+        memmove(cl->line, eol + 1, cl->len - used);
+        cl->len -= used;
+    }
+    if (cl->len == sizeof(cl->line))
+    {
+        out_write(&cl->out, "ERR line too long\n", 18);
+        cl->closing = 1;
+    }
+    return 0;
+}
+
+// One recv, then the requests it completed, 1 on quit, -1 to drop the client
+static int serve_client(struct serve_cache *c, struct client *cl,
+                        struct outbuf *o)
+{
+    ssize_t n = recv(cl->fd, cl->line + cl->len, sizeof(cl->line) - cl->len,
+                     0);
+    if (n < 0 && errno == EINTR)
+        return 0;
+    if (n <= 0)
+        return -1;
+    cl->len += n;
+    return serve_lines(c, cl, o);
+}
+
+int serve(const char *sock_path)
+{
+    struct sockaddr_un addr = { 0 };
+    struct serve_cache cache = { 0 };
+
+    if (strlen(sock_path) >= sizeof(addr.sun_path))
+    {
+        fprintf(stderr, "[-] Socket path too long: %s\n", sock_path);
+        return -1;
+    }
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, sock_path);
+
+    // Only a stale socket of a previous run may be replaced
+    struct stat st;
+    int stale = lstat(sock_path, &st) == 0;
+    if (stale && !S_ISSOCK(st.st_mode))
+    {
+        fprintf(stderr, "[-] %s exists and is not a socket\n", sock_path);
+        return -1;
+    }
+
+    int sfd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (sfd == -1)
+    {
+        perror("Cannot create the socket");
+        return -1;
+    }
+    if (stale)
+        unlink(sock_path);
+    if (bind(sfd, (struct sockaddr *)&addr, sizeof(addr)) == -1
+        || listen(sfd, SERVE_BACKLOG) == -1)
+    {
+        perror("Cannot listen on the socket");
+        close(sfd);
+        return -1;
+    }
+    printf("[+] Serving on %s\n", sock_path);
+    fflush(stdout);
+
+    // Every client is polled and never blocks the loop: one that keeps its
+    // connection open between requests, or stops reading its replies, does
+    // not hold the others back. Its requests wait until its replies are out
+    struct client *cl[SERVE_MAX_CLIENTS];
+    struct pollfd pfd[SERVE_MAX_CLIENTS + 1];
+    size_t n_cl = 0;
+    struct outbuf o = { 0 };
+    int quit = 0;
+    int err = 0;
+    while (!quit && !err)
+    {
+        pfd[0] = (struct pollfd){ sfd, n_cl < SERVE_MAX_CLIENTS ? POLLIN : 0,
+                                  0 };
+        for (size_t i = 0; i < n_cl; i++)
+            pfd[i + 1] = (struct pollfd){ cl[i]->fd,
+                                          cl[i]->out.len ? POLLOUT : POLLIN,
+                                          0 };
+        if (poll(pfd, n_cl + 1, -1) == -1)
+        {
+            if (errno == EINTR)
+                continue;
+            perror("poll");
+            err = 1;
+            break;
+        }
+
+        // Backwards: a dropped client takes the last one, already served
+        for (size_t i = n_cl; i-- > 0 && !quit;)
+        {
+            if (!pfd[i + 1].revents)
+                continue;
+            int r = 0;
+            if (!cl[i]->out.len)
+                r = serve_client(&cache, cl[i], &o);
+            quit = r == 1;
+            if (r != -1 && client_flush(cl[i]))
+                r = -1;
+            if (r)
+            {
+                client_free(cl[i]);
+                cl[i] = cl[--n_cl];
+            }
+        }
+        if (quit || !(pfd[0].revents & POLLIN))
+            continue;
+        int cfd = accept(sfd, NULL, NULL);
+        if (cfd == -1)
+        {
+            if (errno == EINTR || errno == ECONNABORTED)
+                continue;
+            perror("accept");
+            err = 1;
+            break;
+        }
+        if (fcntl(cfd, F_SETFL, fcntl(cfd, F_GETFL) | O_NONBLOCK) == -1
+            || !(cl[n_cl] = calloc(1, sizeof(*cl[n_cl]))))
+        {
+            close(cfd);
+            continue;
+        }
+        struct ucred cred;
+        socklen_t cred_len = sizeof(cred);
+        int peer = getsockopt(cfd, SOL_SOCKET, SO_PEERCRED, &cred, &cred_len);
+        cl[n_cl]->owner = peer == 0 && cred.uid == geteuid();
+        cl[n_cl++]->fd = cfd;
+    }
+
+    for (size_t i = 0; i < n_cl; i++)
+        client_free(cl[i]);
+    free(o.data);
+    for (size_t i = 0; i < SERVE_CACHE_SIZE; i++)
+        slot_free(&cache.slot[i]);
+    close(sfd);
+    unlink(sock_path);
+    return quit ? 0 : -1;
+}
@@ -0,0 +1,171 @@
+#include "include/stream.h"
+#include "include/disas.h"
+#include "include/parse_elf.h"
+
+#include <elf.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct in_stream
+{
+    FILE *in;
+    uint64_t pos; // Bytes consumed so far
+    uint8_t *buf; // STREAM_WINDOW
+};
+
+static size_t take(struct in_stream *s, void *dst, size_t len)
+{
+    size_t n = fread(dst, 1, len, s->in);
+    s->pos += n;
+    return n;
+}
+
+// Read and drop up to off, 0 if the stream got there
+static int skip_to(struct in_stream *s, uint64_t off)
+{
+    while (s->pos < off)
+    {
+        uint64_t len = off - s->pos;
+        if (len > STREAM_WINDOW)
+            len = STREAM_WINDOW;
+        if (!take(s, s->buf, len))
+            return -1;
+    }
+    return 0;
+}
+
+static int cmp_offset(const void *a, const void *b)
+{
+    const Elf64_Phdr *x = a;
+    const Elf64_Phdr *y = b;
+    return (x->p_offset > y->p_offset) - (x->p_offset < y->p_offset);
+}
+
+// Decode [start, end) of the stream, never holding more than the window
+static uint64_t decode_segment(FILE *out, struct in_stream *s, uint64_t end,
+                               uint64_t rip)
+{
+    uint64_t left = end - s->pos;
+    uint64_t decoded = 0;
+    size_t have = 0;
+
+    for (;;)
+    {
+        size_t want = STREAM_WINDOW - have;
+        if (want > left)
+            want = left;
+        size_t got = take(s, s->buf + have, want);
+        left = got < want ? 0 : left - got; // Short read: input ended
+        have += got;
+
+        int last = left == 0;
+        struct disas_iter it;
+        struct asm_ins ins;
+        size_t used = 0;
+        int ret = 1;
+        disas_iter_init(&it, s->buf, have, rip);
+        while (last ? used < have : have - used >= STREAM_MAX_INS)
+        {
+            if ((ret = disas_next(&it, &ins)) <= 0)
+                break;
+            fputs("Bytes parsed:", out);
+            for (size_t i = 0; i < it.ins_len; i++)
+                fprintf(out, " 0x%02X", it.ins_bytes[i]);
+            putc('\n', out);
+            print_asm_ins(out, it.ins_bytes, it.ins_len, &ins, it.ins_rip);
+            used += it.ins_len;
+        }
+        decoded += used;
+        if (ret < 0)
+        {
+            fputs("Decoding error\n", out);
+            return decoded; // Rest of the segment is skipped by the caller
+        }
+        if (last)
+            return decoded;
+        rip += used;
+        memmove(s->buf, s->buf + used, have - used);
+        have -= used;
+    }
+}
+
+int stream_disas(FILE *out, FILE *in, struct stream_stats *st)
+{
+    struct in_stream s = { in, 0, malloc(STREAM_WINDOW) };
+    Elf64_Ehdr h;
+    Elf64_Phdr *ph = NULL;
+    int ret = -1;
+
+    memset(st, 0, sizeof(*st));
+    if (!s.buf)
+    {
+        perror("malloc");
+        return -1;
+    }
+    struct file f = { -1, sizeof(h), "-", &h, 0, NULL };
+    if (take(&s, &h, sizeof(h)) != sizeof(h) || !is_elf(&f)
+        || h.e_ident[EI_CLASS] != ELFCLASS64)
+    {
+        fprintf(stderr, "[-] Input is not an ELF64\n");
+        goto end;
+    }
+    if (h.e_phentsize != sizeof(Elf64_Phdr) || h.e_phoff < sizeof(h)
+        || !h.e_phnum)
+    {
+        fprintf(stderr, "[-] No program headers to find code with\n");
+        goto end;
+    }
+
+    size_t ph_len = (size_t)h.e_phnum * sizeof(*ph);
+    if (!(ph = malloc(ph_len)))
+    {
+        perror("malloc");
+        goto end;
+    }
+    if (skip_to(&s, h.e_phoff) || take(&s, ph, ph_len) != ph_len)
+    {
+        fprintf(stderr, "[-] Input ends inside the program headers\n");
+        goto end;
+    }
+
+    // Executable segments first, in the order their bytes come by
+    size_t n = 0;
+    for (size_t i = 0; i < h.e_phnum; i++)
+        if (ph[i].p_type == PT_LOAD && (ph[i].p_flags & PF_X)
+            && ph[i].p_filesz)
+            ph[n++] = ph[i];
+    qsort(ph, n, sizeof(*ph), cmp_offset);
+
+    for (size_t i = 0; i < n; i++)
+    {
+        uint64_t start = ph[i].p_offset;
+        uint64_t end = start + ph[i].p_filesz;
+        if (end <= s.pos)
+            continue; // Already went by inside an earlier one
+        if (start < s.pos)
+            start = s.pos;
+        if (skip_to(&s, start))
+        {
+            fprintf(stderr, "[-] Input ends before segment %zu\n", i);
+            break;
+        }
+        uint64_t rip = ph[i].p_vaddr + (start - ph[i].p_offset);
+        fprintf(out, "x86 disassembly of segment %zu [0x%" PRIx64 ", 0x%" PRIx64
+                     ")\n",
+                i, rip, ph[i].p_vaddr + ph[i].p_filesz);
+        st->code += decode_segment(out, &s, end, rip);
+        st->segments++;
+    }
+
+    // Let the writer finish instead of dying on EPIPE
+    while (take(&s, s.buf, STREAM_WINDOW))
+        ;
+    ret = 0;
+
+end:
+    st->bytes = s.pos;
+    free(ph);
+    free(s.buf);
+    return ret;
+}
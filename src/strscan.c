@@ -0,0 +1,371 @@
+#include "include/strscan.h"
+#include "include/disas.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#include <elf.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define STRSCAN_BLOCK 64 // Bytes per mask word, 4 SSE2 loads
+
+struct run // Open run of marked bytes, carried across words
+{
+    int open;
+    size_t start;
+};
+
+struct scan // One str_scan call
+{
+    struct str_list *lst;
+    uint64_t addr;
+    uint16_t sec;
+    size_t min_len;
+    struct run ascii;
+    struct run wide;
+};
+
+static int printable(uint8_t c)
+{
+    return (c >= 0x20 && c <= 0x7E) || c == '\t' || c == '\n';
+}
+
+static int emit(struct scan *s, size_t start, size_t end, int wide)
+{
+    size_t size = end - start;
+    if ((wide ? size / 2 : size) < s->min_len)
+        return 0;
+    struct str_list *lst = s->lst;
+    if (lst->n == lst->cap)
+    {
+        size_t cap = lst->cap ? 2 * lst->cap : 256;
+        struct str_hit *items = realloc(lst->items, cap * sizeof(*items));
+        if (!items)
+            return -1;
+        lst->items = items;
+        lst->cap = cap;
+    }
+    lst->items[lst->n++] =
+        (struct str_hit){ s->addr + start, size, s->sec, wide };
+    return 0;
+}
+
+/*
+ * Binary data is full of short printable runs: clear those lying inside the
+ * word without visiting them. AND k shifted copies (log k steps) to keep
+ * the starts of k long windows, OR them back over k bytes. Runs touching
+ * either end of the word are kept, the carried state decides for them.
+ */
+static uint64_t long_runs(uint64_t m, unsigned k, int open)
+{
+    uint64_t w = m;
+    uint64_t r;
+    unsigned len, sh;
+
+    for (len = 1; len < k; len += sh)
+    {
+        sh = 2 * len <= k ? len : k - len;
+        w &= w >> sh | ~(~0ULL >> sh); // Past the word counts as printable
+    }
+    r = w;
+    for (len = 1; len < k; len += sh)
+    {
+        sh = 2 * len <= k ? len : k - len;
+        r |= r << sh;
+    }
+    if (open && (m & 1))
+        r |= (m ^ (m + 1)) >> 1; // Run going on from the previous word
+    return r;
+}
+
+// Open and close runs on the 0/1 transitions of a word mask (bit = byte)
+static int feed(struct scan *s, struct run *r, uint64_t mask, size_t base,
+                int wide)
+{
+    if (mask == ~0ULL) // Common cases: inside text, inside binary data
+    {
+        if (!r->open)
+        {
+            r->open = 1;
+            r->start = base;
+        }
+        return 0;
+    }
+    if (!mask && !r->open)
+        return 0;
+    size_t k = wide ? 2 * s->min_len : s->min_len;
+    mask = long_runs(mask, k < STRSCAN_BLOCK ? k : STRSCAN_BLOCK, r->open);
+    if (!mask && !r->open)
+        return 0;
+
+    unsigned pos = 0;
+    while (pos < STRSCAN_BLOCK)
+    {
+        uint64_t rest = ~0ULL << pos;
+        uint64_t edge = r->open ? ~mask & rest : mask & rest;
+        if (!edge)
+            break;
+        pos = __builtin_ctzll(edge);
+        if (r->open && emit(s, r->start, base + pos, wide))
+            return -1;
+        r->open = !r->open;
+        r->start = base + pos;
+    }
+    return 0;
+}
+
+// Printable bytes, and bytes of UTF-16LE units (printable, then 0)
+static void word_masks(const uint8_t *p, size_t n, uint64_t *ascii,
+                       uint64_t *wide)
+{
+    uint64_t m = 0;
+    uint64_t z = 0;
+#ifdef __SSE2__
+    if (n == STRSCAN_BLOCK)
+        for (size_t i = 0; i < STRSCAN_BLOCK; i += 16)
+        {
+            __m128i c = _mm_loadu_si128((const __m128i *)(p + i));
+            // Signed compares: bytes >= 0x80 are negative and never match
+            __m128i in =
+                _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8(0x1F)),
+                              _mm_cmplt_epi8(c, _mm_set1_epi8(0x7F)));
+            in = _mm_or_si128(in, _mm_cmpeq_epi8(c, _mm_set1_epi8('\t')));
+            in = _mm_or_si128(in, _mm_cmpeq_epi8(c, _mm_set1_epi8('\n')));
+            m |= (uint64_t)_mm_movemask_epi8(in) << i;
+            z |= (uint64_t)_mm_movemask_epi8(
+                     _mm_cmpeq_epi8(c, _mm_setzero_si128()))
+                << i;
+        }
+    else
+#endif
+        for (size_t i = 0; i < n; i++)
+        {
+            m |= (uint64_t)printable(p[i]) << i;
+            z |= (uint64_t)(p[i] == 0) << i;
+        }
+
+    // Even byte printable, odd byte zero
+    uint64_t units = m & (z >> 1) & 0x5555555555555555ULL;
+    *ascii = m;
+    *wide = units | units << 1;
+}
+
+int str_scan(struct str_list *lst, const uint8_t *p, size_t size,
+             uint64_t addr, uint16_t sec, size_t min_len)
+{
+    struct scan s = { lst, addr, sec, min_len ? min_len : 1, { 0, 0 },
+                      { 0, 0 } };
+    for (size_t i = 0; i < size; i += STRSCAN_BLOCK)
+    {
+        size_t n = size - i < STRSCAN_BLOCK ? size - i : STRSCAN_BLOCK;
+        uint64_t ascii, wide;
+        word_masks(p + i, n, &ascii, &wide);
+        if (n < STRSCAN_BLOCK) // Bytes past the end close the runs
+        {
+            ascii &= (1ULL << n) - 1;
+            wide &= (1ULL << n) - 1;
+        }
+        if (feed(&s, &s.ascii, ascii, i, 0) || feed(&s, &s.wide, wide, i, 1))
+            return -1;
+    }
+    if ((s.ascii.open && emit(&s, s.ascii.start, size, 0))
+        || (s.wide.open && emit(&s, s.wide.start, size, 1)))
+        return -1;
+    return 0;
+}
+
+void str_list_free(struct str_list *lst)
+{
+    free(lst->items);
+    memset(lst, 0, sizeof(*lst));
+}
+
+static void print_escaped(FILE *out, const uint8_t *p, size_t size, int wide)
+{
+    fputs(wide ? "L\"" : "\"", out);
+    for (size_t i = 0; i < size; i += wide ? 2 : 1)
+    {
+        if (p[i] == '\n')
+            fputs("\\n", out);
+        else if (p[i] == '\t')
+            fputs("\\t", out);
+        else
+        {
+            if (p[i] == '"' || p[i] == '\\')
+                putc('\\', out);
+            putc(p[i], out);
+        }
+    }
+    fputs("\"\n", out);
+}
+
+struct xrefs // Instructions pointing into each string, grouped by string
+{
+    uint64_t *hit; // Hit index, sorted
+    uint32_t *ref; // Index in rip
+    uint64_t *rip;
+    size_t n;
+    size_t cap;
+};
+
+// Last hit starting at or before addr, if addr is inside it
+static size_t hit_at(const struct str_list *lst, uint64_t addr)
+{
+    size_t lo = 0;
+    size_t hi = lst->n;
+    while (lo < hi)
+    {
+        size_t mid = lo + (hi - lo) / 2;
+        if (lst->items[mid].addr <= addr)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    // ASCII runs hold no 0 byte, UTF-16 ones one in two: they never overlap
+    if (lo && addr < lst->items[lo - 1].addr + lst->items[lo - 1].size)
+        return lo - 1;
+    return SIZE_MAX;
+}
+
+static int collect_xrefs(struct xrefs *x, const struct elf_bin *bin,
+                         const struct str_list *lst)
+{
+    struct disas_iter it;
+    struct asm_ins ins;
+    for (size_t i = 0; i < bin->syms.count; i++)
+    {
+        const struct sym_info *s = &bin->syms.items[i];
+        disas_iter_init(&it, s->bytes, s->size, s->addr);
+        while (disas_next(&it, &ins) > 0)
+        {
+            if (!ins_rip_relative(&ins))
+                continue;
+            size_t h = hit_at(lst, ins_target(&ins, it.ins_rip, it.ins_len));
+            if (h == SIZE_MAX)
+                continue;
+            if (x->n == x->cap)
+            {
+                size_t cap = x->cap ? 2 * x->cap : 256;
+                uint64_t *hit = realloc(x->hit, cap * sizeof(*hit));
+                if (!hit)
+                    return -1;
+                x->hit = hit;
+                uint64_t *rip = realloc(x->rip, cap * sizeof(*rip));
+                if (!rip)
+                    return -1;
+                x->rip = rip;
+                x->cap = cap;
+            }
+            x->hit[x->n] = h;
+            x->rip[x->n++] = it.ins_rip;
+        }
+    }
+
+    uint64_t *ktmp = malloc((x->n + 1) * sizeof(*ktmp));
+    uint32_t *vtmp = malloc((x->n + 1) * sizeof(*vtmp));
+    x->ref = malloc((x->n + 1) * sizeof(*x->ref));
+    if (!ktmp || !vtmp || !x->ref)
+    {
+        free(ktmp);
+        free(vtmp);
+        return -1;
+    }
+    for (size_t i = 0; i < x->n; i++)
+        x->ref[i] = i;
+    radix_sort_kv(x->hit, x->ref, ktmp, vtmp, x->n); // Stable: rip order kept
+    free(ktmp);
+    free(vtmp);
+    return 0;
+}
+
+static int scan_sections(struct str_list *lst, const struct elf_bin *bin,
+                         size_t min_len)
+{
+    const Elf64_Shdr *sh = bin->shdrs;
+    for (size_t i = 0; i < bin->ehdr->e_shnum; i++)
+    {
+        if (!(sh[i].sh_flags & SHF_ALLOC) || (sh[i].sh_flags & SHF_EXECINSTR)
+            || sh[i].sh_type == SHT_NOBITS || !sh[i].sh_size)
+            continue;
+        const uint8_t *data = elf_section_data(bin, &sh[i]);
+        if (data
+            && str_scan(lst, data, sh[i].sh_size, sh[i].sh_addr, i, min_len))
+            return -1;
+    }
+    return 0;
+}
+
+static void sort_hits(struct str_list *lst, uint64_t *key, uint32_t *perm,
+                      uint64_t *ktmp, uint32_t *vtmp, struct str_hit *tmp)
+{
+    for (size_t i = 0; i < lst->n; i++)
+    {
+        key[i] = lst->items[i].addr;
+        perm[i] = i;
+    }
+    radix_sort_kv(key, perm, ktmp, vtmp, lst->n);
+    for (size_t i = 0; i < lst->n; i++)
+        tmp[i] = lst->items[perm[i]];
+    memcpy(lst->items, tmp, lst->n * sizeof(*tmp));
+}
+
+int strings_print(FILE *out, const struct elf_bin *bin, size_t min_len,
+                  int xrefs, const struct data_index *names)
+{
+    struct str_list lst = { NULL, 0, 0 };
+    struct xrefs x = { NULL, NULL, NULL, 0, 0 };
+    int err = scan_sections(&lst, bin, min_len);
+
+    // Sections come in header order, ASCII and UTF-16 hits interleave
+    size_t n = lst.n + 1;
+    uint64_t *key = err ? NULL : malloc(n * sizeof(*key));
+    uint64_t *ktmp = err ? NULL : malloc(n * sizeof(*ktmp));
+    uint32_t *perm = err ? NULL : malloc(n * sizeof(*perm));
+    uint32_t *vtmp = err ? NULL : malloc(n * sizeof(*vtmp));
+    struct str_hit *tmp = err ? NULL : malloc(n * sizeof(*tmp));
+    err = err || !key || !ktmp || !perm || !vtmp || !tmp;
+    if (!err)
+        sort_hits(&lst, key, perm, ktmp, vtmp, tmp);
+    free(key);
+    free(ktmp);
+    free(perm);
+    free(vtmp);
+    free(tmp);
+    if (!err && xrefs)
+        err = collect_xrefs(&x, bin, &lst);
+
+    size_t wide = 0;
+    for (size_t i = 0, r = 0; i < lst.n && !err; i++)
+    {
+        const struct str_hit *h = &lst.items[i];
+        const char *sec = elf_section_name(bin, &bin->shdrs[h->sec]);
+        const uint8_t *data = elf_section_data(bin, &bin->shdrs[h->sec]);
+        fprintf(out, "%016" PRIx64 " %-14s ", h->addr, sec ? sec : "?");
+        print_escaped(out, data + (h->addr - bin->shdrs[h->sec].sh_addr),
+                      h->size, h->wide);
+        wide += h->wide;
+        for (; r < x.n && x.hit[r] == i; r++)
+        {
+            uint64_t rip = x.rip[x.ref[r]];
+            char label[INS_BUFSIZE];
+            fprintf(out, "\t<- %" PRIx64, rip);
+            if (names && dataidx_label(names, rip, label, sizeof(label)))
+                fprintf(out, " %s", label);
+            putc('\n', out);
+        }
+    }
+    if (err)
+        fprintf(stderr, "[-] Out of memory collecting strings\n");
+    else if (xrefs)
+        fprintf(stderr, "[+] %zu strings (%zu UTF-16), %zu references\n",
+                lst.n, wide, x.n);
+    else
+        fprintf(stderr, "[+] %zu strings (%zu UTF-16)\n", lst.n, wide);
+    free(x.hit);
+    free(x.ref);
+    free(x.rip);
+    str_list_free(&lst);
+    return err ? -1 : 0;
+}
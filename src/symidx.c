@@ -0,0 +1,130 @@
+#include "include/symidx.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+struct sym_key
+{
+    uint64_t addr;
+    uint32_t id;
+};
+
+static int cmp_name_key(const void *a, const void *b)
+{
+    const struct name_key *x = a;
+    const struct name_key *y = b;
+    int c = strcmp(x->name, y->name);
+    return c ? c : (x->id > y->id) - (x->id < y->id);
+}
+
+static int cmp_sym_key(const void *a, const void *b)
+{
+    const struct sym_key *x = a;
+    const struct sym_key *y = b;
+    if (x->addr != y->addr)
+        return x->addr < y->addr ? -1 : 1;
+    return (x->id > y->id) - (x->id < y->id);
+}
+
+int symidx_build(struct sym_index *idx, const struct sym_list *lst)
+{
+    size_t n = lst->count;
+    struct sym_key *keys = malloc((n + 1) * sizeof(*keys));
+
+    memset(idx, 0, sizeof(*idx));
+    idx->start = malloc((n + 1) * sizeof(*idx->start));
+    idx->end = malloc((n + 1) * sizeof(*idx->end));
+    idx->id = malloc((n + 1) * sizeof(*idx->id));
+    if (!keys || !idx->start || !idx->end || !idx->id)
+    {
+        free(keys);
+        symidx_free(idx);
+        return -1;
+    }
+
+    for (size_t i = 0; i < n; i++)
+        keys[i] = (struct sym_key){ lst->items[i].addr, (uint32_t)i };
+    qsort(keys, n, sizeof(*keys), cmp_sym_key);
+
+    for (size_t i = 0; i < n; i++)
+    {
+        const struct sym_info *s = &lst->items[keys[i].id];
+        idx->start[i] = s->addr;
+        idx->end[i] = s->addr + (s->size ? s->size : 1);
+        idx->id[i] = keys[i].id;
+    }
+    idx->n = n;
+
+    free(keys);
+    return 0;
+}
+
+void symidx_free(struct sym_index *idx)
+{
+    free(idx->start);
+    free(idx->end);
+    free(idx->id);
+    memset(idx, 0, sizeof(*idx));
+}
+
+uint32_t symidx_lookup(const struct sym_index *idx, uint64_t addr)
+{
+    // Last function starting at or before addr
+    size_t lo = 0;
+    size_t hi = idx->n;
+    while (lo < hi)
+    {
+        size_t mid = lo + (hi - lo) / 2;
+        if (idx->start[mid] <= addr)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    if (!lo || addr >= idx->end[lo - 1])
+        return SYM_NONE;
+    return idx->id[lo - 1];
+}
+
+uint32_t symidx_find(const struct sym_list *lst, const char *name)
+{
+    for (size_t i = 0; i < lst->count; i++)
+        if (strcmp(lst->items[i].name, name) == 0)
+            return (uint32_t)i;
+    return SYM_NONE;
+}
+
+int nameidx_build(struct name_index *ni, const struct sym_list *lst)
+{
+    if (!(ni->key = malloc((lst->count + 1) * sizeof(*ni->key))))
+        return -1;
+    for (size_t i = 0; i < lst->count; i++)
+        ni->key[i] = (struct name_key){ lst->items[i].name, (uint32_t)i };
+    qsort(ni->key, lst->count, sizeof(*ni->key), cmp_name_key);
+    ni->n = lst->count;
+    return 0;
+}
+
+void nameidx_free(struct name_index *ni)
+{
+    free(ni->key);
+    memset(ni, 0, sizeof(*ni));
+}
+
+uint32_t nameidx_find(const struct name_index *ni, const char *name)
+{
+    // First key not below name: equal names are ordered by id
+    size_t lo = 0;
+    size_t hi = ni->n;
+    while (lo < hi)
+    {
+        size_t mid = lo + (hi - lo) / 2;
+        if (strcmp(ni->key[mid].name, name) < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    if (lo == ni->n || strcmp(ni->key[lo].name, name))
+        return SYM_NONE;
+    return ni->key[lo].id;
+}
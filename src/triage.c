@@ -0,0 +1,356 @@
+#define _DEFAULT_SOURCE // pread
+
+#include "include/triage.h"
+#include "include/parse_elf.h"
+
+#include <elf.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+struct scratch // Grown on demand, reused across files
+{
+    uint8_t *buf;
+    size_t cap;
+};
+
+struct triage_ctx
+{
+    FILE *out;
+    struct triage_stats *st;
+    uint8_t page[TRIAGE_PAGE];
+    size_t got; // Bytes of page actually read
+    struct scratch tab; // Program headers, dynamic section, section headers
+    struct scratch names; // .shstrtab
+    int oom;
+};
+
+struct triage_info // Header level facts about one file
+{
+    int is64;
+    int pie; // DF_1_PIE in DT_FLAGS_1
+    int relro;
+    int nx; // PT_GNU_STACK without PF_X, no PT_GNU_STACK: executable
+    int wx;
+    int symtab;
+    const char *debug;
+};
+
+static const char *machine_name(unsigned m, char *tmp, size_t len)
+{
+    switch (m)
+    {
+    case EM_X86_64:
+        return "x86-64";
+    case EM_386:
+        return "i386";
+    case EM_AARCH64:
+        return "aarch64";
+    case EM_ARM:
+        return "arm";
+    case EM_RISCV:
+        return "riscv";
+    case EM_PPC64:
+        return "ppc64";
+    case EM_S390:
+        return "s390";
+    case EM_MIPS:
+        return "mips";
+    default:
+        snprintf(tmp, len, "em%u", m);
+        return tmp;
+    }
+}
+
+// len bytes at off, from the first page when it covers them, NULL if short
+static const uint8_t *fetch(struct triage_ctx *c, struct scratch *s, int fd,
+                            uint64_t off, size_t len)
+{
+    if (off + len >= off && off + len <= c->got)
+        return c->page + off;
+    if (len > s->cap)
+    {
+        uint8_t *tmp = realloc(s->buf, len);
+        if (!tmp)
+        {
+            c->oom = 1;
+            return NULL;
+        }
+        s->buf = tmp;
+        s->cap = len;
+    }
+    size_t done = 0;
+    while (done < len)
+    {
+        ssize_t r = pread(fd, s->buf + done, len - done, off + done);
+        if (r <= 0)
+            return NULL;
+        done += r;
+    }
+    return s->buf;
+}
+
+// Only the fields triage needs, from either class
+static void phdr_at(const uint8_t *tab, size_t i, int is64, Elf64_Phdr *out)
+{
+    if (is64)
+    {
+        memcpy(out, tab + i * sizeof(*out), sizeof(*out));
+        return;
+    }
+    Elf32_Phdr p;
+    memcpy(&p, tab + i * sizeof(p), sizeof(p));
+    out->p_type = p.p_type;
+    out->p_flags = p.p_flags;
+    out->p_offset = p.p_offset;
+    out->p_filesz = p.p_filesz;
+}
+
+// DT_FLAGS_1 of PT_DYNAMIC: DF_1_PIE tells a PIE (static-pie included)
+// from a shared library, PT_INTERP does not
+static int scan_dynamic(struct triage_ctx *c, int fd, const Elf64_Phdr *dyn,
+                        struct triage_info *ti)
+{
+    size_t ent = ti->is64 ? sizeof(Elf64_Dyn) : sizeof(Elf32_Dyn);
+    size_t n = dyn->p_filesz < TRIAGE_MAX_DYN ? dyn->p_filesz / ent
+                                              : TRIAGE_MAX_DYN / ent;
+    const uint8_t *tab = fetch(c, &c->tab, fd, dyn->p_offset, n * ent);
+    if (!tab)
+        return -1;
+
+    for (size_t i = 0; i < n; i++)
+    {
+        Elf64_Dyn d;
+        if (ti->is64)
+            memcpy(&d, tab + i * ent, ent);
+        else
+        {
+            Elf32_Dyn d32;
+            memcpy(&d32, tab + i * ent, ent);
+            d.d_tag = d32.d_tag;
+            d.d_un.d_val = d32.d_un.d_val;
+        }
+        if (d.d_tag == DT_NULL)
+            break;
+        if (d.d_tag == DT_FLAGS_1)
+            ti->pie = (d.d_un.d_val & DF_1_PIE) != 0;
+    }
+    return 0;
+}
+
+static void shdr_at(const uint8_t *tab, size_t i, int is64, Elf64_Shdr *out)
+{
+    if (is64)
+    {
+        memcpy(out, tab + i * sizeof(*out), sizeof(*out));
+        return;
+    }
+    Elf32_Shdr s;
+    memcpy(&s, tab + i * sizeof(s), sizeof(s));
+    out->sh_name = s.sh_name;
+    out->sh_type = s.sh_type;
+    out->sh_offset = s.sh_offset;
+    out->sh_size = s.sh_size;
+}
+
+static int scan_phdrs(struct triage_ctx *c, int fd, const Elf64_Ehdr *h,
+                      struct triage_info *ti)
+{
+    size_t ent = ti->is64 ? sizeof(Elf64_Phdr) : sizeof(Elf32_Phdr);
+    if (h->e_phnum == 0)
+        return 0;
+    if (h->e_phentsize != ent)
+        return -1;
+    const uint8_t *tab = fetch(c, &c->tab, fd, h->e_phoff, h->e_phnum * ent);
+    if (!tab)
+        return -1;
+
+    Elf64_Phdr dyn = { .p_type = PT_NULL };
+    for (size_t i = 0; i < h->e_phnum; i++)
+    {
+        Elf64_Phdr p;
+        phdr_at(tab, i, ti->is64, &p);
+        if (p.p_type == PT_DYNAMIC)
+            dyn = p;
+        else if (p.p_type == PT_GNU_RELRO)
+            ti->relro = 1;
+        else if (p.p_type == PT_GNU_STACK)
+            ti->nx = !(p.p_flags & PF_X);
+        else if (p.p_type == PT_LOAD && (p.p_flags & PF_W)
+                 && (p.p_flags & PF_X))
+            ti->wx++;
+    }
+    // tab is dead from here, the dynamic section may reuse its buffer
+    if (h->e_type == ET_DYN && dyn.p_type == PT_DYNAMIC)
+        return scan_dynamic(c, fd, &dyn, ti);
+    return 0;
+}
+
+static int scan_shdrs(struct triage_ctx *c, int fd, const Elf64_Ehdr *h,
+                      struct triage_info *ti)
+{
+    size_t ent = ti->is64 ? sizeof(Elf64_Shdr) : sizeof(Elf32_Shdr);
+    ti->debug = "no";
+    if (h->e_shnum == 0) // Fully stripped or extended numbering: nothing to say
+        return 0;
+    if (h->e_shentsize != ent)
+        return -1;
+    const uint8_t *tab = fetch(c, &c->tab, fd, h->e_shoff, h->e_shnum * ent);
+    if (!tab)
+        return -1;
+
+    const char *names = NULL;
+    size_t names_len = 0;
+    if (h->e_shstrndx != SHN_UNDEF && h->e_shstrndx < h->e_shnum)
+    {
+        Elf64_Shdr str;
+        shdr_at(tab, h->e_shstrndx, ti->is64, &str);
+        if (str.sh_type == SHT_STRTAB && str.sh_size <= TRIAGE_MAX_SHSTR)
+        {
+            // The first page may hold tab, names must not evict it
+            names = (const char *)fetch(c, &c->names, fd, str.sh_offset,
+                                        str.sh_size);
+            names_len = names ? str.sh_size : 0;
+        }
+    }
+
+    for (size_t i = 0; i < h->e_shnum; i++)
+    {
+        Elf64_Shdr s;
+        shdr_at(tab, i, ti->is64, &s);
+        if (s.sh_type == SHT_SYMTAB)
+            ti->symtab = 1;
+        if (!names || s.sh_name >= names_len
+            || !memchr(names + s.sh_name, '\0', names_len - s.sh_name))
+            continue;
+        const char *n = names + s.sh_name;
+        if (strncmp(n, ".debug_", 7) == 0 || strncmp(n, ".zdebug_", 8) == 0)
+            ti->debug = "yes";
+        else if (strcmp(n, ".gnu_debuglink") == 0 && strcmp(ti->debug, "yes"))
+            ti->debug = "link"; // Split out to a separate file
+    }
+    return 0;
+}
+
+static const char *type_name(unsigned type, const struct triage_info *ti)
+{
+    switch (type)
+    {
+    case ET_REL:
+        return "REL";
+    case ET_EXEC:
+        return "EXEC";
+    case ET_DYN:
+        return ti->pie ? "PIE" : "DSO";
+    case ET_CORE:
+        return "CORE";
+    default:
+        return "?";
+    }
+}
+
+static const char *yes_no(int v)
+{
+    return v ? "yes" : "no";
+}
+
+static int triage_file(const char *path, void *data)
+{
+    struct triage_ctx *c = data;
+    int fd = open(path, O_RDONLY);
+    if (fd == -1)
+    {
+        perror(path);
+        return 0;
+    }
+    c->st->files++;
+
+    ssize_t r = pread(fd, c->page, sizeof(c->page), 0);
+    c->got = r > 0 ? r : 0;
+    struct file f = { fd, c->got, (char *)path, c->page, 0, NULL };
+    if (c->got < EI_NIDENT || !is_elf(&f))
+    {
+        close(fd);
+        return 0;
+    }
+    c->st->elfs++;
+
+    struct triage_info ti = { 0 };
+    Elf64_Ehdr h;
+    int ok = c->page[EI_CLASS] == ELFCLASS64;
+    ok = ok || c->page[EI_CLASS] == ELFCLASS32;
+    ok = ok && c->page[EI_DATA] == ELFDATA2LSB; // Fields are read natively
+    ti.is64 = c->page[EI_CLASS] == ELFCLASS64;
+    if (ok && ti.is64 && c->got >= sizeof(Elf64_Ehdr))
+        memcpy(&h, c->page, sizeof(h));
+    else if (ok && !ti.is64 && c->got >= sizeof(Elf32_Ehdr))
+    {
+        Elf32_Ehdr h32;
+        memcpy(&h32, c->page, sizeof(h32));
+        memcpy(h.e_ident, h32.e_ident, EI_NIDENT);
+        h.e_type = h32.e_type;
+        h.e_machine = h32.e_machine;
+        h.e_phoff = h32.e_phoff;
+        h.e_shoff = h32.e_shoff;
+        h.e_phentsize = h32.e_phentsize;
+        h.e_phnum = h32.e_phnum;
+        h.e_shentsize = h32.e_shentsize;
+        h.e_shnum = h32.e_shnum;
+        h.e_shstrndx = h32.e_shstrndx;
+    }
+    else
+        ok = 0;
+    ok = ok && scan_phdrs(c, fd, &h, &ti) == 0;
+    ok = ok && scan_shdrs(c, fd, &h, &ti) == 0;
+    close(fd);
+
+    if (!ok)
+    {
+        c->st->bad++;
+        fprintf(c->out, "%-5s %-8s %-4s %s (malformed)\n", "?", "?", "?",
+                path);
+        return c->oom ? -1 : 0;
+    }
+
+    char em[16];
+    int loaded = h.e_type == ET_EXEC || h.e_type == ET_DYN;
+    c->st->wx += ti.wx != 0;
+    c->st->no_nx += loaded && !ti.nx;
+    c->st->no_relro += loaded && !ti.relro;
+    fprintf(c->out, "%-5s %-8s %-4s %-5s %-3s %-6s %-5s %-3zu %s\n",
+            ti.is64 ? "ELF64" : "ELF32",
+            machine_name(h.e_machine, em, sizeof(em)), type_name(h.e_type, &ti),
+            loaded ? yes_no(ti.relro) : "-", loaded ? yes_no(ti.nx) : "-",
+            yes_no(ti.symtab), ti.debug, (size_t)ti.wx, path);
+    return 0;
+}
+
+int triage(FILE *out, char **paths, size_t n_paths,
+           struct triage_stats *stats)
+{
+    struct triage_ctx *c = calloc(1, sizeof(*c));
+    if (!c)
+    {
+        perror("calloc");
+        return -1;
+    }
+    memset(stats, 0, sizeof(*stats));
+    c->out = out;
+    c->st = stats;
+
+    fprintf(out, "%-5s %-8s %-4s %-5s %-3s %-6s %-5s %-3s %s\n", "class",
+            "machine", "type", "relro", "nx", "symtab", "debug", "w+x",
+            "path");
+    int ret = 0;
+    for (size_t i = 0; i < n_paths && !ret; i++)
+        ret = walk_files(paths[i], triage_file, c);
+    if (ret)
+        fprintf(stderr, "[-] Out of memory reading headers\n");
+
+    free(c->tab.buf);
+    free(c->names.buf);
+    free(c);
+    return ret ? -1 : (int)stats->bad;
+}
@@ -1,7 +1,13 @@
+#define _DEFAULT_SOURCE // lstat, dirent
+
 #include "include/utils.h"
+#include "include/io.h"
 #include "include/parse_elf.h"
 
-#include <fcntl.h>
+#include <dirent.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -11,66 +17,18 @@
 
 struct file *file_map(const char *filename)
 {
-    struct stat s = { 0 };
-    struct file *new = malloc(sizeof(struct file));
-
-    if (new == NULL)
-    {
-        perror("Cannot malloc a struct file");
-        goto error_malloc;
-    }
-
-    if ((new->name = malloc(strlen(filename) + 1)) == NULL)
-    {
-        perror("Cannot malloc a string of strlen(filename)");
-        goto error_name;
-    }
-    new->name = strcpy(new->name, filename);
-
-    if ((new->fd = open(new->name, O_RDONLY)) == -1)
-    {
-        perror("Cannot open(filename) in read-only");
-        goto error_open;
-    }
-
-    if ((stat(new->name, &s)) == -1)
-    {
-        perror("Cannot stat(filename)");
-        goto error_stat;
-    }
-    new->size = s.st_size;
-
-    if ((new->content =
-             mmap(NULL, new->size, PROT_READ, MAP_PRIVATE, new->fd, 0))
-        == MAP_FAILED)
-    {
-        perror("Cannot mmap for the file size");
-        goto error_mmap;
-    }
-
-    if (!is_elf(new))
-        goto error_format;
-
-    return new;
-
-error_format:
-    puts("[-] Binary is not an ELF");
-error_mmap:
-error_stat:
-    close(new->fd);
-error_open:
-    free(new->name);
-error_name:
-    free(new);
-error_malloc:
-    return NULL;
+    return file_open(filename, IO_MMAP);
 }
 
 void file_unmap(struct file **f)
 {
     free((*f)->name);
     close((*f)->fd);
-    munmap((*f)->content, (*f)->size);
+    if ((*f)->mapped)
+        munmap((*f)->content, (*f)->size);
+    else
+        free((*f)->content);
+    free((*f)->maps);
     free(*f);
     *f = NULL;
 }
@@ -90,3 +48,222 @@ char *xstrdup(const char *s) // -std=c99 flag
         memcpy(p, s, n);
     return p;
 }
+
+// LSD radix sort, one byte per pass, tmp must hold n elements
+void radix_sort_u64(uint64_t *a, uint64_t *tmp, size_t n)
+{
+    size_t count[256];
+
+    if (n < 2)
+        return;
+
+    for (unsigned shift = 0; shift < 64; shift += 8)
+    {
+        memset(count, 0, sizeof(count));
+        for (size_t i = 0; i < n; i++)
+            count[(a[i] >> shift) & 0xFF]++;
+        if (count[(a[0] >> shift) & 0xFF] == n)
+            continue; // All keys share this digit
+
+        size_t sum = 0;
+        for (size_t d = 0; d < 256; d++)
+        {
+            size_t c = count[d];
+            count[d] = sum;
+            sum += c;
+        }
+        for (size_t i = 0; i < n; i++)
+            tmp[count[(a[i] >> shift) & 0xFF]++] = a[i];
+        memcpy(a, tmp, n * sizeof(*a));
+    }
+}
+
+void radix_sort_kv(uint64_t *key, uint32_t *val, uint64_t *ktmp,
+                   uint32_t *vtmp, size_t n)
+{
+    size_t count[256];
+
+    if (n < 2)
+        return;
+
+    for (unsigned shift = 0; shift < 64; shift += 8)
+    {
+        memset(count, 0, sizeof(count));
+        for (size_t i = 0; i < n; i++)
+            count[(key[i] >> shift) & 0xFF]++;
+        if (count[(key[0] >> shift) & 0xFF] == n)
+            continue;
+
+        size_t sum = 0;
+        for (size_t d = 0; d < 256; d++)
+        {
+            size_t c = count[d];
+            count[d] = sum;
+            sum += c;
+        }
+        for (size_t i = 0; i < n; i++)
+        {
+            size_t dst = count[(key[i] >> shift) & 0xFF]++;
+            ktmp[dst] = key[i];
+            vtmp[dst] = val[i];
+        }
+        memcpy(key, ktmp, n * sizeof(*key));
+        memcpy(val, vtmp, n * sizeof(*val));
+    }
+}
+
+static int hexval(char c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    return -1;
+}
+
+int parse_hex_u64(const char **p, const char *end, uint64_t *val)
+{
+    const char *s = *p;
+    uint64_t v = 0;
+    int d;
+
+    if (end - s > 2 && s[0] == '0' && (s[1] == 'x' || s[1] == 'X'))
+        s += 2;
+    const char *digits = s;
+    for (; s < end && (d = hexval(*s)) >= 0; s++)
+        v = (v << 4) | (uint64_t)d;
+    if (s == digits)
+        return -1;
+    *p = s;
+    *val = v;
+    return 0;
+}
+
+// Appends a nibble, emits a byte every second one
+static void put_nibble(uint8_t nib, uint8_t *out, size_t *n, int *half)
+{
+    if (*half >= 0)
+    {
+        out[(*n)++] = (uint8_t)(*half << 4 | nib);
+        *half = -1;
+    }
+    else
+        *half = nib;
+}
+
+// A '0' that only prefixes "0x": not data
+static int is_prefix_zero(const char *in, size_t i, size_t len)
+{
+    return in[i] == '0' && i + 1 < len && (in[i + 1] | 0x20) == 'x';
+}
+
+size_t hex_decode(const char *in, size_t len, uint8_t *out)
+{
+    size_t n = 0;
+    size_t i = 0;
+    int half = -1;
+
+#ifdef __SSE2__
+    const __m128i lower = _mm_set1_epi8(0x20);
+    for (; i + 16 <= len; i += 16)
+    {
+        __m128i c = _mm_loadu_si128((const __m128i *)(in + i));
+        __m128i lc = _mm_or_si128(c, lower);
+        // Signed compares: bytes >= 0x80 are negative and never match
+        __m128i digit =
+            _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8('0' - 1)),
+                          _mm_cmplt_epi8(c, _mm_set1_epi8('9' + 1)));
+        __m128i alpha =
+            _mm_and_si128(_mm_cmpgt_epi8(lc, _mm_set1_epi8('a' - 1)),
+                          _mm_cmplt_epi8(lc, _mm_set1_epi8('f' + 1)));
+        __m128i val = _mm_or_si128(
+            _mm_and_si128(digit, _mm_sub_epi8(c, _mm_set1_epi8('0'))),
+            _mm_and_si128(alpha, _mm_sub_epi8(lc, _mm_set1_epi8('a' - 10))));
+
+        unsigned hex = _mm_movemask_epi8(_mm_or_si128(digit, alpha));
+        unsigned x = _mm_movemask_epi8(_mm_cmpeq_epi8(lc, _mm_set1_epi8('x')));
+        unsigned zero =
+            _mm_movemask_epi8(_mm_cmpeq_epi8(c, _mm_set1_epi8('0')));
+        x = x >> 1 | (i + 16 < len && (in[i + 16] | 0x20) == 'x') << 15;
+        hex &= ~(x & zero);
+
+        if (hex == 0xFFFF && half < 0)
+        {
+            // 16 digits: (even << 4 | odd) per 16 bit lane, packed to 8 bytes
+            __m128i hi =
+                _mm_slli_epi16(_mm_and_si128(val, _mm_set1_epi16(0xFF)), 4);
+            __m128i b = _mm_or_si128(hi, _mm_srli_epi16(val, 8));
+            _mm_storel_epi64((__m128i *)(out + n),
+                             _mm_packus_epi16(b, _mm_setzero_si128()));
+            n += 8;
+            continue;
+        }
+        uint8_t nib[16];
+        _mm_storeu_si128((__m128i *)nib, val);
+        for (; hex; hex &= hex - 1)
+            put_nibble(nib[__builtin_ctz(hex)], out, &n, &half);
+    }
+#endif
+    for (; i < len; i++)
+    {
+        int d = hexval(in[i]);
+        if (d >= 0 && !is_prefix_zero(in, i, len))
+            put_nibble((uint8_t)d, out, &n, &half);
+    }
+    return n;
+}
+
+// Arguments are followed like any command would, entries found while
+// recursing are not: no symlink loops, no tree walked twice
+static int walk(const char *path, walk_fn fn, void *data, int top)
+{
+    struct stat st;
+    if ((top ? stat(path, &st) : lstat(path, &st)) == -1)
+    {
+        perror(path);
+        return 0;
+    }
+    if (S_ISREG(st.st_mode))
+        return fn(path, data);
+    if (!S_ISDIR(st.st_mode))
+    {
+        if (top)
+            fprintf(stderr, "[-] %s: not a file or directory, skipped\n",
+                    path);
+        return 0;
+    }
+
+    DIR *d = opendir(path);
+    if (!d)
+    {
+        perror(path);
+        return 0;
+    }
+    int err = 0;
+    size_t len = strlen(path);
+    struct dirent *e;
+    while (!err && (e = readdir(d)))
+    {
+        if (strcmp(e->d_name, ".") == 0 || strcmp(e->d_name, "..") == 0)
+            continue;
+        char *sub = malloc(len + strlen(e->d_name) + 2);
+        if (!sub)
+        {
+            err = -1;
+            break;
+        }
+        sprintf(sub, "%s%s%s", path, len && path[len - 1] == '/' ? "" : "/",
+                e->d_name);
+        err = walk(sub, fn, data, 0);
+        free(sub);
+    }
+    closedir(d);
+    return err;
+}
+
+int walk_files(const char *path, walk_fn fn, void *data)
+{
+    return walk(path, fn, data, 1);
+}
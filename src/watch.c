@@ -0,0 +1,176 @@
+#include "include/watch.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+static void snapshot_free(struct watch_snapshot *s)
+{
+    free_symlist(s->syms);
+    free(s->blob);
+    fn_hashes_free(&s->fns);
+    s->syms.items = NULL;
+    s->syms.count = 0;
+    s->blob = NULL;
+}
+
+// Copies names and bytes so the old build survives its file being replaced.
+// Takes fns, hashes of lst, moved over to the copy
+static int snapshot_take(struct watch_snapshot *s, const struct sym_list *lst,
+                         struct fn_hashes *fns)
+{
+    size_t total = 0;
+    for (size_t i = 0; i < lst->count; i++)
+        total += lst->items[i].size;
+
+    struct sym_info *items = calloc(lst->count + 1, sizeof(*items));
+    unsigned char *blob = malloc(total + 1);
+    if (!items || !blob)
+    {
+        free(items);
+        free(blob);
+        return -1;
+    }
+
+    size_t off = 0;
+    size_t n = 0;
+    for (; n < lst->count; n++)
+    {
+        const struct sym_info *src = &lst->items[n];
+        if (!(items[n].name = xstrdup(src->name)))
+            break;
+        items[n].addr = src->addr;
+        items[n].size = src->size;
+        items[n].bytes = blob + off;
+        memcpy(blob + off, src->bytes, src->size);
+        off += src->size;
+    }
+
+    struct sym_list copy = { items, n };
+    if (n < lst->count)
+    {
+        free_symlist(copy);
+        free(blob);
+        return -1;
+    }
+    for (size_t i = 0; i < fns->n; i++)
+        fns->ref[i].sym = &items[fns->ref[i].sym - lst->items];
+    snapshot_free(s);
+    s->syms = copy;
+    s->blob = blob;
+    s->fns = *fns;
+    fns->ref = NULL;
+    fns->n = 0;
+    s->generation++;
+    return 0;
+}
+
+// Load path and diff it against the snapshot, which then moves forward.
+// Only the new build is hashed, -1 if no diff was made
+static int rebuild(FILE *out, const char *path, struct watch_snapshot *s)
+{
+    struct elf_bin *bin = elf_load(path);
+    if (!bin)
+    {
+        fprintf(stderr, "[-] %s: %s, waiting for the next write\n", path,
+                elf_strerror(errno));
+        return -1;
+    }
+
+    struct fn_hashes fns = { NULL, 0 };
+    int err = fn_hashes_build(&fns, &bin->syms);
+    if (!err)
+    {
+        fprintf(out, "\n=== %s build %zu -> %zu\n", path, s->generation,
+                s->generation + 1);
+        err = hashed_diff(out, &s->fns, &fns)
+            || snapshot_take(s, &bin->syms, &fns);
+    }
+    if (err)
+        fprintf(stderr, "[-] Out of memory diffing %s\n", path);
+    fflush(out);
+    fn_hashes_free(&fns);
+    elf_free(&bin);
+    return err ? -1 : 0;
+}
+
+int watch(FILE *out, const char *path, size_t max_builds)
+{
+    struct watch_snapshot snap = { { NULL, 0 }, NULL, { NULL, 0 }, 0 };
+    struct fn_hashes fns = { NULL, 0 };
+    const char *slash = strrchr(path, '/');
+    const char *base = slash ? slash + 1 : path;
+    char *dir = xstrdup(slash ? path : ".");
+
+    if (!dir)
+        return -1;
+    if (slash)
+        dir[slash == path ? 1 : slash - path] = '\0';
+
+    struct elf_bin *bin = elf_load(path);
+    if (!bin)
+        fprintf(stderr, "[-] %s: %s\n", path, elf_strerror(errno));
+    if (!bin || fn_hashes_build(&fns, &bin->syms)
+        || snapshot_take(&snap, &bin->syms, &fns))
+    {
+        fn_hashes_free(&fns);
+        elf_free(&bin);
+        free(dir);
+        return -1;
+    }
+    elf_free(&bin);
+
+    // Watch the directory: linkers usually replace the file, which a
+    // watch on the old inode would never see
+    int fd = inotify_init();
+    if (fd == -1
+        || inotify_add_watch(fd, dir, IN_CLOSE_WRITE | IN_MOVED_TO) == -1)
+    {
+        perror("Cannot watch the binary");
+        if (fd != -1)
+            close(fd);
+        snapshot_free(&snap);
+        free(dir);
+        return -1;
+    }
+    fprintf(out, "[+] Watching %s (%zu functions)\n", path, snap.syms.count);
+    fflush(out);
+
+    uint64_t events[WATCH_EVENT_BUF / sizeof(uint64_t)]; // Aligned buffer
+    char *buf = (char *)events;
+    size_t builds = 0;
+    int ret = 0;
+    while (!max_builds || builds < max_builds)
+    {
+        ssize_t len = read(fd, buf, sizeof(events));
+        if (len < 0 && errno == EINTR)
+            continue;
+        if (len <= 0)
+        {
+            perror("Cannot read inotify events");
+            ret = -1;
+            break;
+        }
+
+        // One rebuild per batch of events, however many touched the file
+        int hit = 0;
+        for (char *p = buf; p < buf + len;)
+        {
+            const struct inotify_event *ev = (const struct inotify_event *)p;
+            if (ev->len && strcmp(ev->name, base) == 0)
+                hit = 1;
+            p += sizeof(*ev) + ev->len;
+        }
+        if (!hit)
+            continue;
+        if (rebuild(out, path, &snap) == 0)
+            builds++; // Failed loads do not use up max_builds
+    }
+
+    close(fd);
+    snapshot_free(&snap);
+    free(dir);
+    return ret;
+}
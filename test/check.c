@@ -0,0 +1,211 @@
+#include "../src/include/strscan.h"
+#include "../src/include/utils.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ROUNDS 20000
+#define MAX_LEN 300
+
+static uint64_t rng = 0x9E3779B97F4A7C15ULL;
+static int failures;
+
+static uint64_t next(void) // xorshift64: same inputs on every run
+{
+    rng ^= rng << 13;
+    rng ^= rng >> 7;
+    rng ^= rng << 17;
+    return rng;
+}
+
+static int ref_hexval(char c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if ((c | 0x20) >= 'a' && (c | 0x20) <= 'f')
+        return (c | 0x20) - 'a' + 10;
+    return -1;
+}
+
+// One character at a time: digits pair into bytes, "0x" prefixes skipped
+static size_t ref_hex_decode(const char *in, size_t len, uint8_t *out)
+{
+    size_t n = 0;
+    int half = -1;
+    for (size_t i = 0; i < len; i++)
+    {
+        int d = ref_hexval(in[i]);
+        if (d < 0
+            || (in[i] == '0' && i + 1 < len && (in[i + 1] | 0x20) == 'x'))
+            continue;
+        if (half < 0)
+            half = d;
+        else
+        {
+            out[n++] = (uint8_t)(half << 4 | d);
+            half = -1;
+        }
+    }
+    return n;
+}
+
+// Mostly digits, so that whole 16 byte blocks take the fast path
+static void hex_input(char *in, size_t len)
+{
+    static const char other[] = "0xX \n,\t\\gG\x80\xff";
+    static const char digits[] = "0123456789abcdefABCDEF";
+    unsigned noise = next() % 4; // 0: digits only
+    for (size_t i = 0; i < len; i++)
+    {
+        if (noise && next() % (8 * noise) == 0)
+            in[i] = other[next() % (sizeof(other) - 1)];
+        else
+            in[i] = digits[next() % (sizeof(digits) - 1)];
+    }
+}
+
+static void check_hex_decode(void)
+{
+    char in[MAX_LEN];
+    uint8_t out[MAX_LEN];
+    uint8_t ref[MAX_LEN];
+    for (int r = 0; r < ROUNDS; r++)
+    {
+        size_t len = next() % MAX_LEN;
+        hex_input(in, len);
+        size_t n = hex_decode(in, len, out);
+        size_t m = ref_hex_decode(in, len, ref);
+        if (n != m || memcmp(out, ref, n))
+        {
+            fprintf(stderr, "[-] hex_decode: %zu bytes, %zu expected: %.*s\n",
+                    n, m, (int)len, in);
+            failures++;
+            return;
+        }
+    }
+}
+
+static int ref_printable(uint8_t c)
+{
+    return (c >= 0x20 && c <= 0x7E) || c == '\t' || c == '\n';
+}
+
+static void ref_add(struct str_list *lst, uint64_t addr, uint32_t size,
+                    int wide)
+{
+    if (lst->n == lst->cap)
+    {
+        lst->cap = lst->cap ? 2 * lst->cap : 64;
+        lst->items = realloc(lst->items, lst->cap * sizeof(*lst->items));
+        if (!lst->items)
+            abort();
+    }
+    lst->items[lst->n++] = (struct str_hit){ addr, size, 0, wide };
+}
+
+// Byte by byte: maximal ASCII runs, maximal runs of units at even offsets
+static void ref_str_scan(struct str_list *lst, const uint8_t *p,
+                         size_t size, uint64_t addr, size_t min_len)
+{
+    size_t start = 0;
+    for (size_t i = 0; i <= size; i++)
+    {
+        if (i < size && ref_printable(p[i]))
+            continue;
+        if (i - start >= min_len)
+            ref_add(lst, addr + start, i - start, 0);
+        start = i + 1;
+    }
+    start = 0;
+    for (size_t i = 0; i < size + 2; i += 2) // Odd sizes end at size + 1
+    {
+        if (i + 1 < size && ref_printable(p[i]) && !p[i + 1])
+            continue;
+        if ((i - start) / 2 >= min_len)
+            ref_add(lst, addr + start, i - start, 1);
+        start = i + 2;
+    }
+}
+
+static int hit_cmp(const void *a, const void *b)
+{
+    const struct str_hit *x = a;
+    const struct str_hit *y = b;
+    if (x->wide != y->wide)
+        return x->wide - y->wide;
+    return (x->addr > y->addr) - (x->addr < y->addr);
+}
+
+// Text, UTF-16 text and binary runs of random lengths
+static void str_input(uint8_t *p, size_t size)
+{
+    size_t i = 0;
+    while (i < size)
+    {
+        size_t run = next() % 80;
+        unsigned kind = next() % 4;
+        for (; run && i < size; run--, i++)
+        {
+            if (kind == 0)
+                p[i] = 0x20 + next() % 0x5F;
+            else if (kind == 1)
+                p[i] = i & 1 ? 0 : 0x20 + next() % 0x5F;
+            else if (kind == 2)
+                p[i] = next() % 8 ? 0 : '\n';
+            else
+                p[i] = (uint8_t)next();
+        }
+    }
+}
+
+static void check_str_scan(void)
+{
+    static const size_t min_lens[] = { 1, 2, 3, 4, 7, 16, 31, 32, 33, 64 };
+    uint8_t p[4 * MAX_LEN];
+    for (int r = 0; r < ROUNDS; r++)
+    {
+        struct str_list got = { NULL, 0, 0 };
+        struct str_list ref = { NULL, 0, 0 };
+        size_t size = next() % sizeof(p);
+        size_t min_len = min_lens[next() % (sizeof(min_lens) / sizeof(size_t))];
+        str_input(p, size);
+        if (str_scan(&got, p, size, 0x1000, 0, min_len))
+        {
+            fprintf(stderr, "[-] str_scan failed\n");
+            failures++;
+            return;
+        }
+        ref_str_scan(&ref, p, size, 0x1000, min_len);
+        qsort(got.items, got.n, sizeof(*got.items), hit_cmp);
+        qsort(ref.items, ref.n, sizeof(*ref.items), hit_cmp);
+        int same = got.n == ref.n;
+        for (size_t i = 0; same && i < got.n; i++)
+            same = got.items[i].addr == ref.items[i].addr
+                   && got.items[i].size == ref.items[i].size
+                   && got.items[i].wide == ref.items[i].wide;
+        if (!same)
+            fprintf(stderr,
+                    "[-] str_scan: %zu hits, %zu expected (size %zu, "
+                    "min_len %zu)\n",
+                    got.n, ref.n, size, min_len);
+        str_list_free(&got);
+        str_list_free(&ref);
+        if (!same)
+        {
+            failures++;
+            return;
+        }
+    }
+}
+
+int main(void)
+{
+    check_hex_decode();
+    check_str_scan();
+    if (failures)
+        return 1;
+    printf("[+] hex_decode, str_scan: %d rounds each\n", ROUNDS);
+    return 0;
+}
@@ -0,0 +1,32 @@
+#!/bin/sh
+# Every .rela.text entry of test/reloc.o must be printed by -d under its
+# instruction, as "offset: type<TAB>symbol[addend]"
+
+BIN=${1:-bin/gandelf}
+OBJ=${2:-test/reloc.o}
+
+out=$("$BIN" "$OBJ" -d) || exit 1
+# readelf prints the entries of a section up to the next empty line
+rela=$(readelf -rW "$OBJ" | sed -n '/.rela.text/,/^$/p' | grep '^[0-9a-f]')
+status=0
+
+for type in R_X86_64_PLT32 R_X86_64_PC32 R_X86_64_32S; do
+    if ! printf '%s\n' "$rela" | grep -q " $type "; then
+        echo "[-] $OBJ: no $type relocation in .text" >&2
+        status=1
+    fi
+done
+
+tab=$(printf '\t')
+while read -r off info type value name rest; do
+    want="$tab$(printf '%x' "0x$off"): $type$tab$name"
+    if ! printf '%s\n' "$out" | grep -qF "$want"; then
+        echo "[-] $OBJ: no \"$(printf '%x' "0x$off"): $type $name\"" >&2
+        status=1
+    fi
+done <<EOT
+$rela
+EOT
+
+[ $status -eq 0 ] && echo "[+] $OBJ: .rela.text annotated"
+exit $status
@@ -0,0 +1,20 @@
+// Built with gcc -c -fno-pic: a call, a rip relative load and an absolute
+// index, relocated through R_X86_64_PLT32, R_X86_64_PC32 and R_X86_64_32S
+extern int ext_fn(int);
+extern int ext_var;
+extern int ext_tab[];
+
+int rel_call(int x)
+{
+    return ext_fn(x) + 1;
+}
+
+int rel_load(void)
+{
+    return ext_var;
+}
+
+int rel_index(long i)
+{
+    return ext_tab[i];
+}